@@ -0,0 +1,92 @@
+#include "AllocationCounter.h"
+
+#ifndef NDEBUG
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+namespace {
+	std::atomic<uint64_t> totalCount{ 0 };
+	thread_local uint64_t threadCount = 0;
+
+	void* countedAlloc(size_t size, size_t alignment) {
+		threadCount++;
+		totalCount.fetch_add(1, std::memory_order_relaxed);
+		size = size == 0 ? 1 : size;
+#ifdef _WIN32
+		return alignment > alignof(std::max_align_t) ? _aligned_malloc(size, alignment) : std::malloc(size);
+#else
+		// aligned_alloc wants a size that is a multiple of the alignment
+		return alignment > alignof(std::max_align_t) ? std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment) : std::malloc(size);
+#endif
+	}
+
+	void* countedNew(size_t size, size_t alignment) {
+		void* p = countedAlloc(size, alignment);
+		if (p == nullptr) {
+			throw std::bad_alloc();
+		}
+		return p;
+	}
+
+	void countedFree(void* p, size_t alignment) {
+#ifdef _WIN32
+		if (alignment > alignof(std::max_align_t)) {
+			_aligned_free(p);
+			return;
+		}
+#else
+		(void)alignment;
+#endif
+		std::free(p);
+	}
+}
+
+
+// The array, nothrow and sized forms all forward to these by default
+void* operator new(size_t size) {
+	return countedNew(size, alignof(std::max_align_t));
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+	return countedNew(size, size_t(alignment));
+}
+
+void operator delete(void* p) noexcept {
+	countedFree(p, alignof(std::max_align_t));
+}
+
+void operator delete(void* p, std::align_val_t alignment) noexcept {
+	countedFree(p, size_t(alignment));
+}
+
+
+bool AllocationCounter::isEnabled() {
+	return true;
+}
+
+uint64_t AllocationCounter::total() {
+	return totalCount.load(std::memory_order_relaxed);
+}
+
+uint64_t AllocationCounter::thisThread() {
+	return threadCount;
+}
+
+#else
+
+bool AllocationCounter::isEnabled() {
+	return false;
+}
+
+uint64_t AllocationCounter::total() {
+	return 0;
+}
+
+uint64_t AllocationCounter::thisThread() {
+	return 0;
+}
+
+#endif
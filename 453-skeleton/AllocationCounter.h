@@ -0,0 +1,26 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// This file contains a count of heap allocations made through operator new,
+// used to check that steady-state frames don't allocate.
+//
+// Debug builds (no NDEBUG) replace the global operator new to count; release
+// builds keep the standard one and every count reads 0. Memory that libraries
+// get from malloc directly (ImGui, the GL driver) isn't seen.
+// Only the application is built with it; the tools and benchmarks link
+// solar-core alone and keep the standard allocator.
+//------------------------------------------------------------------------------
+
+#include <cstdint>
+
+
+namespace AllocationCounter {
+	// True when operator new is being counted
+	bool isEnabled();
+
+	// Allocations by every thread since startup
+	uint64_t total();
+
+	// Allocations by the calling thread since it started
+	uint64_t thisThread();
+}
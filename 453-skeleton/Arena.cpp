@@ -0,0 +1,60 @@
+#include "Arena.h"
+
+#include <algorithm>
+#include <cstdint>
+
+
+Arena::Arena(size_t blockSize)
+	: blockSize(blockSize)
+{}
+
+
+void* Arena::allocate(size_t size, size_t alignment) {
+	size = std::max<size_t>(size, 1);
+	for (;; current++, offset = 0) {
+		if (current == blocks.size()) {
+			// worst case padding is alignment - 1
+			blocks.push_back({ nullptr, std::max(blockSize, size + alignment) });
+			blocks.back().data.reset(new std::byte[blocks.back().size]);
+			blocks.back().memory.set(MemoryCategory::Arenas, "", blocks.back().size);
+		}
+
+		Block& block = blocks[current];
+		uintptr_t base = reinterpret_cast<uintptr_t>(block.data.get());
+		size_t aligned = size_t((base + offset + alignment - 1) / alignment * alignment - base);
+		if (aligned <= block.size && size <= block.size - aligned) {
+			offset = aligned + size;
+			return block.data.get() + aligned;
+		}
+	}
+}
+
+
+void Arena::rewind(Marker marker) {
+	current = marker.block;
+	offset = marker.offset;
+}
+
+
+size_t Arena::getUsedBytes() const {
+	size_t used = offset;
+	for (size_t i = 0; i < current && i < blocks.size(); i++) {
+		used += blocks[i].size;
+	}
+	return used;
+}
+
+
+size_t Arena::getCapacity() const {
+	size_t capacity = 0;
+	for (const Block& block : blocks) {
+		capacity += block.size;
+	}
+	return capacity;
+}
+
+
+Arena& scratchArena() {
+	static thread_local Arena arena(256 << 10);
+	return arena;
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// This file contains a linear (bump) allocator for data that lives no longer
+// than one frame or one function call.
+//
+// Allocating is a pointer bump and freeing individual allocations does
+// nothing; the whole arena is rewound at once. Blocks are kept across
+// rewinds, so after the first few frames an arena stops touching the heap.
+//
+// Two kinds are used:
+//	- an Arena owned by whatever defines the lifetime, e.g. the renderer's
+//	  per-frame arena, reset at the start of every frame
+//	- scratchArena(), one per thread, for temporaries inside a function;
+//	  a ScratchScope rewinds it when the function returns
+//------------------------------------------------------------------------------
+
+#include "MemoryAccounting.h"
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+
+class Arena {
+
+public:
+	// Position to rewind to, from mark()
+	struct Marker {
+		size_t block = 0;
+		size_t offset = 0;
+	};
+
+	explicit Arena(size_t blockSize = 1 << 20);
+
+	Arena(const Arena&) = delete;
+	Arena& operator=(const Arena&) = delete;
+
+	// Public interface
+	// Never returns null. Requests larger than the block size get a block of
+	// their own.
+	void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+	template<class T>
+	T* allocateArray(size_t count) {
+		return static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+	}
+
+	// Everything allocated after mark() is released by rewind(). Destructors
+	// are not run, so only trivially destructible data (or containers using
+	// ArenaAllocator, which are destroyed first) should live here.
+	Marker mark() const { return { current, offset }; }
+	void rewind(Marker marker);
+	void reset() { rewind(Marker()); }
+
+	size_t getUsedBytes() const;
+	size_t getCapacity() const;
+
+private:
+	struct Block {
+		std::unique_ptr<std::byte[]> data;
+		size_t size;
+		MemoryRecord memory;
+	};
+
+	std::vector<Block> blocks;
+	size_t current = 0; // block being bumped
+	size_t offset = 0;  // within blocks[current]
+	size_t blockSize;
+};
+
+
+// This thread's scratch arena
+Arena& scratchArena();
+
+
+// Rewinds the scratch arena to where it was on construction
+class ScratchScope {
+
+public:
+	ScratchScope() : arena(scratchArena()), marker(arena.mark()) {}
+	~ScratchScope() { arena.rewind(marker); }
+
+	ScratchScope(const ScratchScope&) = delete;
+	ScratchScope& operator=(const ScratchScope&) = delete;
+
+	Arena& getArena() { return arena; }
+
+private:
+	Arena& arena;
+	Arena::Marker marker;
+};
+
+
+// Standard allocator over an arena, so standard containers can live in one.
+// Default constructed, it uses this thread's scratch arena. Growing a vector
+// leaves the old storage in the arena until it is rewound, so reserve() up
+// front where the size is known.
+template<class T>
+class ArenaAllocator {
+
+public:
+	using value_type = T;
+
+	ArenaAllocator() : arena(&scratchArena()) {}
+	ArenaAllocator(Arena& arena) : arena(&arena) {}
+
+	template<class U>
+	ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.getArena()) {}
+
+	T* allocate(size_t count) { return arena->allocateArray<T>(count); }
+	void deallocate(T*, size_t) {}
+
+	Arena* getArena() const { return arena; }
+
+	template<class U>
+	bool operator==(const ArenaAllocator<U>& other) const { return arena == other.getArena(); }
+	template<class U>
+	bool operator!=(const ArenaAllocator<U>& other) const { return arena != other.getArena(); }
+
+private:
+	Arena* arena;
+};
+
+
+template<class T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
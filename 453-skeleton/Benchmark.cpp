@@ -0,0 +1,71 @@
+#include "Benchmark.h"
+
+#include "Log.h"
+
+#include <argh.h>
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+
+
+BenchmarkOptions parseBenchmarkOptions(int argc, char* argv[]) {
+	argh::parser cmdl;
+	cmdl.add_params({ "--frames", "--warmup", "--width", "--height", "--step" });
+	cmdl.parse(argc, argv);
+
+	BenchmarkOptions options;
+	options.enabled = cmdl["--benchmark"];
+	cmdl("--frames", options.frames) >> options.frames;
+	cmdl("--warmup", options.warmup) >> options.warmup;
+	cmdl("--width", options.width) >> options.width;
+	cmdl("--height", options.height) >> options.height;
+	cmdl("--step", options.timeStep) >> options.timeStep;
+
+	if (options.frames <= 0 || options.warmup < 0 || options.width <= 0 || options.height <= 0 || !(options.timeStep >= 0.0)) {
+		Log::error("BENCHMARK invalid options: frames {} warmup {} size {}x{} step {}",
+			options.frames, options.warmup, options.width, options.height, options.timeStep);
+		throw std::runtime_error("Invalid benchmark options");
+	}
+	return options;
+}
+
+
+BenchmarkCamera benchmarkCamera(int frame, int frames) {
+	const float twoPi = 6.28318530718f;
+	float t = float(frame) / float(std::max(1, frames));
+	return {
+		0.35f * std::sin(2.0f * twoPi * t),       // elevation, kept away from the poles
+		twoPi * t,                                // azimuth
+		3.0f + 1.5f * std::cos(twoPi * t)         // distance
+	};
+}
+
+
+double FrameTimings::percentile(double p) const {
+	if (samples.empty()) {
+		return 0.0;
+	}
+	std::vector<double> sorted = samples;
+	std::sort(sorted.begin(), sorted.end());
+	size_t rank = size_t(std::ceil(p / 100.0 * double(sorted.size())));
+	return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+}
+
+
+double FrameTimings::mean() const {
+	if (samples.empty()) {
+		return 0.0;
+	}
+	return std::accumulate(samples.begin(), samples.end(), 0.0) / double(samples.size());
+}
+
+
+void FrameTimings::printSummary(const std::string& title) const {
+	double average = mean();
+	Log::info("{}: {} frames", title, samples.size());
+	Log::info("  mean {:.3f} ms  min {:.3f}  p50 {:.3f}  p90 {:.3f}  p99 {:.3f}  max {:.3f}",
+		average, percentile(0.0), percentile(50.0), percentile(90.0), percentile(99.0), percentile(100.0));
+	Log::info("  {:.1f} frames per second", average > 0.0 ? 1000.0 / average : 0.0);
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// This file contains the headless benchmark mode.
+//
+//	453-skeleton --benchmark [--frames N] [--warmup N] [--width W] [--height H]
+//	             [--step SECONDS]
+//
+// Renders into an offscreen target from an invisible window, moves the camera
+// along a fixed path, advances the simulation by a fixed time step per frame
+// and prints a frame time summary at exit. Together that makes runs
+// comparable between builds, including on machines without a GPU or display
+// (configure GLFW with -DGLFW_USE_OSMESA=ON to use Mesa's software renderer).
+//------------------------------------------------------------------------------
+
+#include <string>
+#include <vector>
+
+
+struct BenchmarkOptions {
+	bool enabled = false;
+	int frames = 600;      // measured frames
+	int warmup = 30;       // frames rendered before measuring
+	int width = 800;
+	int height = 800;
+	double timeStep = 1.0 / 60.0; // simulated seconds per frame
+};
+
+// Parses the command line. Logs and throws std::runtime_error on bad values.
+BenchmarkOptions parseBenchmarkOptions(int argc, char* argv[]);
+
+
+// Camera placement on the benchmark path: one full orbit around the sun over
+// the run, bobbing in elevation and zooming in and out
+struct BenchmarkCamera {
+	float theta;
+	float phi;
+	float radius;
+};
+BenchmarkCamera benchmarkCamera(int frame, int frames);
+
+
+// Collects per-frame times and summarizes them
+class FrameTimings {
+
+public:
+	// Public interface
+	void add(double milliseconds) { samples.push_back(milliseconds); }
+	void clear() { samples.clear(); }
+	size_t size() const { return samples.size(); }
+
+	// Nearest-rank percentile, p in [0, 100]
+	double percentile(double p) const;
+	double mean() const;
+
+	// Prints count, mean, min, median, p90, p99, max and frames per second
+	void printSummary(const std::string& title) const;
+
+private:
+	std::vector<double> samples;
+};
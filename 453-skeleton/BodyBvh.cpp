@@ -0,0 +1,216 @@
+#include "BodyBvh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+namespace {
+	constexpr uint32_t leafSize = 4;
+
+	// Subtrees smaller than this are not worth a thread
+	constexpr uint32_t parallelThreshold = 1 << 15;
+
+	// Distance along the ray to where it enters the box, or infinity on a miss
+	float rayBox(glm::vec3 origin, glm::vec3 inverseDirection, glm::vec3 min, glm::vec3 max, float limit) {
+		glm::vec3 t0 = (min - origin) * inverseDirection;
+		glm::vec3 t1 = (max - origin) * inverseDirection;
+		glm::vec3 near = glm::min(t0, t1);
+		glm::vec3 far = glm::max(t0, t1);
+		float enter = std::max(std::max(near.x, near.y), std::max(near.z, 0.0f));
+		float exit = std::min(std::min(far.x, far.y), std::min(far.z, limit));
+		return enter <= exit ? enter : std::numeric_limits<float>::infinity();
+	}
+}
+
+
+void BodyBvh::build(const BodyStore& bodies, unsigned threads) {
+	const uint32_t n = uint32_t(bodies.size());
+	indices.resize(n);
+	for (uint32_t i = 0; i < n; i++) {
+		indices[i] = i;
+	}
+	leafOf.assign(n, 0);
+	nodes.clear();
+	parents.clear();
+	if (n == 0) {
+		return;
+	}
+
+	// Median splits leave every leaf at least half full, which bounds the
+	// node count, so nodes are allocated up front and subtrees built on
+	// different threads never reallocate under each other
+	nodes.resize(std::max<size_t>(1, 4 * size_t(n) / leafSize + 1));
+	parents.resize(nodes.size());
+	nodeCount = 1;
+	parents[0] = 0;
+
+	if (threads == 0) {
+		threads = std::max(1u, std::thread::hardware_concurrency());
+	}
+	int parallelDepth = 0;
+	while ((1u << parallelDepth) < threads) {
+		parallelDepth++;
+	}
+	buildNode(bodies, 0, 0, n, parallelDepth);
+
+	nodes.resize(nodeCount);
+	parents.resize(nodeCount);
+}
+
+
+void BodyBvh::buildNode(const BodyStore& bodies, uint32_t node, uint32_t first, uint32_t count, int parallelDepth) {
+	Node& current = nodes[node];
+	current.offset = first;
+	current.count = count;
+	fitLeaf(bodies, current);
+	if (count <= leafSize) {
+		for (uint32_t i = first; i < first + count; i++) {
+			leafOf[indices[i]] = node;
+		}
+		return;
+	}
+
+	// split the centers at the median of their longest axis
+	glm::vec3 low(std::numeric_limits<float>::max());
+	glm::vec3 high(-std::numeric_limits<float>::max());
+	for (uint32_t i = first; i < first + count; i++) {
+		glm::vec3 p = bodies.getPosition(indices[i]);
+		low = glm::min(low, p);
+		high = glm::max(high, p);
+	}
+	glm::vec3 extent = high - low;
+	int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+	const BodyVector<float>& key = axis == 0 ? bodies.x : axis == 1 ? bodies.y : bodies.z;
+
+	uint32_t half = count / 2;
+	std::nth_element(indices.begin() + first, indices.begin() + first + half, indices.begin() + first + count,
+		[&key](uint32_t a, uint32_t b) { return key[a] < key[b]; });
+
+	uint32_t left = nodeCount.fetch_add(2);
+	current.offset = left;
+	current.count = 0;
+	parents[left] = node;
+	parents[left + 1] = node;
+
+	if (parallelDepth > 0 && count >= parallelThreshold) {
+		std::thread worker([&]() { buildNode(bodies, left, first, half, parallelDepth - 1); });
+		buildNode(bodies, left + 1, first + half, count - half, parallelDepth - 1);
+		worker.join();
+	}
+	else {
+		buildNode(bodies, left, first, half, 0);
+		buildNode(bodies, left + 1, first + half, count - half, 0);
+	}
+	current.min = glm::min(nodes[left].min, nodes[left + 1].min);
+	current.max = glm::max(nodes[left].max, nodes[left + 1].max);
+}
+
+
+void BodyBvh::fitLeaf(const BodyStore& bodies, Node& node) const {
+	node.min = glm::vec3(std::numeric_limits<float>::max());
+	node.max = glm::vec3(-std::numeric_limits<float>::max());
+	for (uint32_t i = node.offset; i < node.offset + node.count; i++) {
+		uint32_t body = indices[i];
+		glm::vec3 p = bodies.getPosition(body);
+		glm::vec3 r(bodies.radius[body]);
+		node.min = glm::min(node.min, p - r);
+		node.max = glm::max(node.max, p + r);
+	}
+}
+
+
+void BodyBvh::refit(const BodyStore& bodies, const std::vector<size_t>& moved) {
+	for (size_t body : moved) {
+		uint32_t node = leafOf[body];
+		fitLeaf(bodies, nodes[node]);
+
+		// walk up until a box comes out the same, the rest of the path was
+		// already fit around it
+		while (node != 0) {
+			node = parents[node];
+			Node& inner = nodes[node];
+			glm::vec3 min = glm::min(nodes[inner.offset].min, nodes[inner.offset + 1].min);
+			glm::vec3 max = glm::max(nodes[inner.offset].max, nodes[inner.offset + 1].max);
+			if (min == inner.min && max == inner.max) {
+				break;
+			}
+			inner.min = min;
+			inner.max = max;
+		}
+	}
+}
+
+
+size_t BodyBvh::intersect(const BodyStore& bodies, glm::vec3 origin, glm::vec3 direction, float spread, float& distance) const {
+	if (nodes.empty()) {
+		return none;
+	}
+	direction = glm::normalize(direction);
+	const glm::vec3 inverseDirection = 1.0f / direction;
+	const float slope = std::tan(spread);
+
+	// A cone is covered by the ray against boxes grown by the cone's width
+	// at their far corner
+	auto grow = [&](const Node& node) {
+		glm::vec3 far = glm::max(glm::abs(node.min - origin), glm::abs(node.max - origin));
+		return glm::vec3(slope * glm::length(far));
+	};
+
+	size_t best = none;
+	float bestDistance = std::numeric_limits<float>::infinity();
+
+	uint32_t stack[64];
+	int top = 0;
+	stack[top++] = 0;
+	while (top > 0) {
+		const Node& node = nodes[stack[--top]];
+		glm::vec3 margin = grow(node);
+		if (rayBox(origin, inverseDirection, node.min - margin, node.max + margin, bestDistance) == std::numeric_limits<float>::infinity()) {
+			continue;
+		}
+
+		if (node.count > 0) {
+			for (uint32_t i = node.offset; i < node.offset + node.count; i++) {
+				uint32_t body = indices[i];
+				glm::vec3 toCenter = bodies.getPosition(body) - origin;
+				float along = glm::dot(toCenter, direction);
+				if (along <= 0.0f) {
+					continue;
+				}
+				float r = bodies.radius[body] + slope * along;
+				glm::vec3 miss = toCenter - along * direction;
+				float missSquared = glm::dot(miss, miss);
+				if (missSquared > r * r) {
+					continue;
+				}
+				// entry point of the (widened) sphere
+				float t = std::max(0.0f, along - std::sqrt(r * r - missSquared));
+				if (t < bestDistance) {
+					bestDistance = t;
+					best = body;
+				}
+			}
+			continue;
+		}
+
+		// visit the nearer child first, so the far one is usually pruned
+		const Node& a = nodes[node.offset];
+		const Node& b = nodes[node.offset + 1];
+		float ta = rayBox(origin, inverseDirection, a.min - grow(a), a.max + grow(a), bestDistance);
+		float tb = rayBox(origin, inverseDirection, b.min - grow(b), b.max + grow(b), bestDistance);
+		uint32_t first = node.offset, second = node.offset + 1;
+		if (tb < ta) {
+			std::swap(first, second);
+			std::swap(ta, tb);
+		}
+		if (tb != std::numeric_limits<float>::infinity()) {
+			stack[top++] = second;
+		}
+		if (ta != std::numeric_limits<float>::infinity()) {
+			stack[top++] = first;
+		}
+	}
+
+	distance = bestDistance;
+	return best;
+}
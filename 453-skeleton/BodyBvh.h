@@ -0,0 +1,65 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// This file contains a bounding volume hierarchy over the bounding spheres of
+// a BodyStore, used to pick bodies with rays in O(log n).
+//
+// Nodes hold axis-aligned boxes around the spheres below them and are kept in
+// one flat array, siblings next to each other. build() splits at the median
+// of the longest axis and builds large subtrees on separate threads. When
+// only a few bodies move, refit() grows or shrinks just the boxes on their
+// paths to the root, so a frame with three moving planets does not touch a
+// million static asteroids. Call build() again when bodies are added or
+// removed.
+//------------------------------------------------------------------------------
+
+#include "BodyStore.h"
+#include "MemoryAccounting.h"
+
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+
+class BodyBvh {
+
+public:
+	static constexpr size_t none = std::numeric_limits<size_t>::max();
+
+	// Public interface
+	// Builds over every body of bodies. threads of 0 uses one per core.
+	void build(const BodyStore& bodies, unsigned threads = 0);
+
+	// Updates the boxes around moved bodies, which are indices into the
+	// store the tree was built over
+	void refit(const BodyStore& bodies, const std::vector<size_t>& moved);
+
+	// Nearest body hit by the ray, or none. spread (radians) widens the ray
+	// into a cone, so bodies too small to hit exactly can still be picked
+	// within a few pixels. distance is set to the hit's distance along the
+	// ray.
+	size_t intersect(const BodyStore& bodies, glm::vec3 origin, glm::vec3 direction, float spread, float& distance) const;
+
+	size_t size() const { return leafOf.size(); }
+	size_t getNodeCount() const { return nodes.size(); }
+
+private:
+	struct Node {
+		glm::vec3 min;
+		glm::vec3 max;
+		uint32_t offset; // first child for inner nodes, first index for leaves
+		uint32_t count;  // 0 for inner nodes
+	};
+
+	TrackedVector<Node, MemoryCategory::PickingTree> nodes;
+	TrackedVector<uint32_t, MemoryCategory::PickingTree> indices; // bodies, grouped by leaf
+	TrackedVector<uint32_t, MemoryCategory::PickingTree> parents; // parent of every node, the root's is itself
+	TrackedVector<uint32_t, MemoryCategory::PickingTree> leafOf;  // leaf node of every body
+	std::atomic<uint32_t> nodeCount{ 0 }; // nodes handed out during build()
+
+	void buildNode(const BodyStore& bodies, uint32_t node, uint32_t first, uint32_t count, int parallelDepth);
+	void fitLeaf(const BodyStore& bodies, Node& node) const;
+};
@@ -0,0 +1,227 @@
+#include "BodyCatalog.h"
+
+#include "Log.h"
+
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace {
+	constexpr uint32_t magic = 0x31544342; // "BCT1"
+	constexpr uint64_t columnAlignment = 64;
+	constexpr int columnCount = 10;
+
+	struct FileHeader {
+		uint32_t magic;
+		uint32_t textureCount;
+		uint64_t bodyCount;
+		uint64_t columnOffsets[columnCount];
+		uint64_t namesOffset;
+		uint64_t namesSize;
+	};
+
+	uint64_t alignUp(uint64_t value) {
+		return (value + columnAlignment - 1) / columnAlignment * columnAlignment;
+	}
+
+	// Position on the orbit in the orbit's reference frame, y up
+	void orbitPosition(float a, float e, float inclination, float node, float periapsis, double meanAnomaly,
+		float& x, float& y, float& z) {
+		const double twoPi = 6.283185307179586;
+		double M = std::fmod(meanAnomaly, twoPi);
+
+		// Kepler's equation M = E - e sin E by Newton's method; starting
+		// from pi keeps it converging for eccentric orbits
+		double E = e < 0.8f ? M : 3.141592653589793;
+		for (int i = 0; i < 8; i++) {
+			double delta = (E - e * std::sin(E) - M) / (1.0 - e * std::cos(E));
+			E -= delta;
+			if (std::abs(delta) < 1e-7) {
+				break;
+			}
+		}
+
+		// in the orbital plane, periapsis along +x
+		double px = a * (std::cos(E) - e);
+		double py = a * std::sqrt(1.0 - double(e) * e) * std::sin(E);
+
+		double cosNode = std::cos(node), sinNode = std::sin(node);
+		double cosPeri = std::cos(periapsis), sinPeri = std::sin(periapsis);
+		double cosInc = std::cos(inclination), sinInc = std::sin(inclination);
+
+		double ex = (cosNode * cosPeri - sinNode * sinPeri * cosInc) * px + (-cosNode * sinPeri - sinNode * cosPeri * cosInc) * py;
+		double ey = (sinNode * cosPeri + cosNode * sinPeri * cosInc) * px + (-sinNode * sinPeri + cosNode * cosPeri * cosInc) * py;
+		double ez = (sinPeri * sinInc) * px + (cosPeri * sinInc) * py;
+
+		// the reference plane is the scene's xz plane with north along +y.
+		// The scene is right-handed with y up, so the ecliptic's y axis
+		// points along -z, and orbits turn counterclockwise seen from above.
+		x = float(ex);
+		y = float(ez);
+		z = float(-ey);
+	}
+}
+
+
+bool BodyCatalog::open(const std::string& path) {
+	count = 0;
+	textureNames.clear();
+	if (!file.open(path)) {
+		return false;
+	}
+
+	// Offsets and indices are checked up front, so a corrupt file is
+	// rejected here instead of read out of bounds later
+	FileHeader header{};
+	if (file.size() < sizeof(header)) {
+		Log::error("BODY_CATALOG {} is truncated", path);
+		return false;
+	}
+	std::memcpy(&header, file.data(), sizeof(header));
+	if (header.magic != magic) {
+		Log::error("BODY_CATALOG {} is not a body catalog", path);
+		return false;
+	}
+
+	const uint64_t columnSize = header.bodyCount * 4;
+	if (header.bodyCount > file.size() / 4) {
+		Log::error("BODY_CATALOG {} is truncated", path);
+		return false;
+	}
+	for (int i = 0; i < columnCount; i++) {
+		uint64_t offset = header.columnOffsets[i];
+		if (offset % 4 != 0 || offset > file.size() || columnSize > file.size() - offset) {
+			Log::error("BODY_CATALOG {} column {} is corrupt", path, i);
+			return false;
+		}
+		columns[i] = file.data() + offset;
+	}
+	if (header.namesOffset > file.size() || header.namesSize > file.size() - header.namesOffset) {
+		Log::error("BODY_CATALOG {} texture names are corrupt", path);
+		return false;
+	}
+
+	const char* names = reinterpret_cast<const char*>(file.data() + header.namesOffset);
+	size_t position = 0;
+	for (uint32_t i = 0; i < header.textureCount; i++) {
+		const void* end = std::memchr(names + position, '\0', size_t(header.namesSize - position));
+		if (end == nullptr) {
+			Log::error("BODY_CATALOG {} texture names are corrupt", path);
+			textureNames.clear();
+			return false;
+		}
+		size_t length = size_t(static_cast<const char*>(end) - (names + position));
+		textureNames.emplace_back(names + position, length);
+		position += length + 1;
+	}
+
+	const float* eccentricity = floatColumn(1);
+	const uint32_t* texture = reinterpret_cast<const uint32_t*>(columns[8]);
+	const int32_t* parent = reinterpret_cast<const int32_t*>(columns[9]);
+	for (uint64_t i = 0; i < header.bodyCount; i++) {
+		// parents first, so positions() can resolve them in one pass, and
+		// only closed orbits, which Kepler's equation converges for
+		if (parent[i] < -1 || parent[i] >= int64_t(i) || (texture[i] != noTexture && texture[i] >= header.textureCount)
+			|| !(eccentricity[i] >= 0.0f && eccentricity[i] < 1.0f)) {
+			Log::error("BODY_CATALOG {} body {} is corrupt", path, i);
+			textureNames.clear();
+			return false;
+		}
+	}
+
+	count = size_t(header.bodyCount);
+	return true;
+}
+
+
+void BodyCatalog::positions(double time, float scale, float* x, float* y, float* z) const {
+	const float* a = getSemiMajorAxis();
+	const float* e = getEccentricity();
+	const float* inclination = getInclination();
+	const float* node = getAscendingNode();
+	const float* periapsis = getArgumentOfPeriapsis();
+	const float* meanAnomaly = getMeanAnomaly();
+	const float* meanMotion = getMeanMotion();
+	const int32_t* parent = getParent();
+
+	for (size_t i = 0; i < count; i++) {
+		float px, py, pz;
+		orbitPosition(a[i], e[i], inclination[i], node[i], periapsis[i], meanAnomaly[i] + double(meanMotion[i]) * time, px, py, pz);
+		x[i] = px * scale;
+		y[i] = py * scale;
+		z[i] = pz * scale;
+		if (parent[i] >= 0) {
+			x[i] += x[parent[i]];
+			y[i] += y[parent[i]];
+			z[i] += z[parent[i]];
+		}
+	}
+}
+
+
+bool writeBodyCatalog(const std::string& path, const BodyCatalogData& data) {
+	const size_t n = data.size();
+	const void* columns[columnCount] = {
+		data.semiMajorAxis.data(), data.eccentricity.data(), data.inclination.data(), data.ascendingNode.data(),
+		data.argumentOfPeriapsis.data(), data.meanAnomaly.data(), data.meanMotion.data(), data.radius.data(),
+		data.texture.data(), data.parent.data()
+	};
+	const size_t sizes[columnCount] = {
+		data.semiMajorAxis.size(), data.eccentricity.size(), data.inclination.size(), data.ascendingNode.size(),
+		data.argumentOfPeriapsis.size(), data.meanAnomaly.size(), data.meanMotion.size(), data.radius.size(),
+		data.texture.size(), data.parent.size()
+	};
+	for (size_t size : sizes) {
+		if (size != n) {
+			Log::error("BODY_CATALOG columns for {} differ in length", path);
+			return false;
+		}
+	}
+
+	std::string names;
+	for (const std::string& name : data.textureNames) {
+		names += name;
+		names.push_back('\0');
+	}
+
+	FileHeader header{};
+	header.magic = magic;
+	header.textureCount = uint32_t(data.textureNames.size());
+	header.bodyCount = n;
+	uint64_t offset = alignUp(sizeof(header));
+	for (int i = 0; i < columnCount; i++) {
+		header.columnOffsets[i] = offset;
+		offset = alignUp(offset + n * 4);
+	}
+	header.namesOffset = offset;
+	header.namesSize = names.size();
+
+	// write to a temporary and rename, so a crash never leaves a half-written file
+	std::filesystem::path temporary = path;
+	temporary += ".tmp";
+	{
+		std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		const char padding[columnAlignment] = {};
+		for (int i = 0; i < columnCount; i++) {
+			// zero padding up to the column's offset
+			out.write(padding, std::streamsize(header.columnOffsets[i] - uint64_t(out.tellp())));
+			out.write(static_cast<const char*>(columns[i]), std::streamsize(n * 4));
+		}
+		out.write(padding, std::streamsize(header.namesOffset - uint64_t(out.tellp())));
+		out.write(names.data(), std::streamsize(names.size()));
+		if (!out) {
+			Log::error("BODY_CATALOG could not write {}", temporary.string());
+			return false;
+		}
+	}
+
+	std::error_code ec;
+	std::filesystem::rename(temporary, path, ec);
+	if (ec) {
+		Log::error("BODY_CATALOG could not write {}: {}", path, ec.message());
+		return false;
+	}
+	return true;
+}
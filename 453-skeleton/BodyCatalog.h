@@ -0,0 +1,91 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// A binary catalog of bodies too numerous for a text scene (asteroid belts,
+// moons of every planet, ...), stored column by column.
+//
+// Every field is one packed array in the file, so the catalog is memory
+// mapped and used in place: nothing is parsed per body, and bulk passes like
+// BodyStore::append() stream through only the columns they read. Orbits are
+// Keplerian elements relative to the body's parent, for closed orbits only
+// (eccentricity in [0, 1)). The catalog's reference plane is the scene's xz
+// plane: ecliptic x, y and north map to scene x, -z and y.
+//
+// Layout (little endian):
+//
+//	FileHeader               counts and the offset of every column
+//	columns                  bodyCount 4-byte values each, 64-byte aligned
+//	texture names            textureCount NUL terminated strings
+//------------------------------------------------------------------------------
+
+#include "MappedFile.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+// Owning, writable form of a catalog. Every vector has one entry per body.
+struct BodyCatalogData {
+	std::vector<float> semiMajorAxis;       // km
+	std::vector<float> eccentricity;        // 0 circle, below 1
+	std::vector<float> inclination;         // radians
+	std::vector<float> ascendingNode;       // longitude of the ascending node, radians
+	std::vector<float> argumentOfPeriapsis; // radians
+	std::vector<float> meanAnomaly;         // at the epoch, radians
+	std::vector<float> meanMotion;          // radians per second
+	std::vector<float> radius;              // km
+	std::vector<uint32_t> texture;          // index into textureNames, or BodyCatalog::noTexture
+	std::vector<int32_t> parent;            // index of an earlier body, -1 for the origin
+	std::vector<std::string> textureNames;
+
+	size_t size() const { return radius.size(); }
+};
+
+
+class BodyCatalog {
+
+public:
+	// File extension catalogs are written with
+	static constexpr const char* extension = ".bcat";
+	static constexpr uint32_t noTexture = 0xFFFFFFFF;
+
+	// Public interface
+	// Maps and validates the file. Logs and returns false on failure.
+	bool open(const std::string& path);
+
+	size_t size() const { return count; }
+
+	// Point into the mapping, valid while the catalog is alive
+	const float* getSemiMajorAxis() const { return floatColumn(0); }
+	const float* getEccentricity() const { return floatColumn(1); }
+	const float* getInclination() const { return floatColumn(2); }
+	const float* getAscendingNode() const { return floatColumn(3); }
+	const float* getArgumentOfPeriapsis() const { return floatColumn(4); }
+	const float* getMeanAnomaly() const { return floatColumn(5); }
+	const float* getMeanMotion() const { return floatColumn(6); }
+	const float* getRadius() const { return floatColumn(7); }
+	const uint32_t* getTexture() const { return reinterpret_cast<const uint32_t*>(columns[8]); }
+	const int32_t* getParent() const { return reinterpret_cast<const int32_t*>(columns[9]); }
+
+	const std::vector<std::string_view>& getTextureNames() const { return textureNames; }
+
+	// Writes every body's position at time seconds after the epoch, in km
+	// times scale. Bodies orbit their parent's position at that time.
+	void positions(double time, float scale, float* x, float* y, float* z) const;
+
+private:
+	static constexpr int columnCount = 10;
+
+	MappedFile file;
+	size_t count = 0;
+	const uint8_t* columns[columnCount] = {};
+	std::vector<std::string_view> textureNames;
+
+	const float* floatColumn(int i) const { return reinterpret_cast<const float*>(columns[i]); }
+};
+
+
+// Writes data to a catalog at path
+bool writeBodyCatalog(const std::string& path, const BodyCatalogData& data);
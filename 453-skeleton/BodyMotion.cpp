@@ -0,0 +1,80 @@
+#include "BodyMotion.h"
+
+#include <glm/gtc/constants.hpp>
+#include <glm/gtx/transform.hpp>
+
+#include <cmath>
+
+
+namespace {
+	const glm::vec3 xAxisOfRotation = glm::vec3(1.0f, 0.0f, 0.0f);
+	const glm::vec4 yAxisMatrix = glm::vec4(0.0f, 1.0f, 0.0f, 0.0f);
+}
+
+
+BodyMotion::BodyMotion(float rotationSpeed, float orbitalSpeed, float orbitalInclination, float axialTilt,
+	const BodyMotion* parent, float distanceFromParent)
+	: rotationSpeed(rotationSpeed)
+	, orbitalSpeed(orbitalSpeed)
+	, orbitalInclination(orbitalInclination)
+	, axialTilt(axialTilt)
+	, parent(parent)
+	, distanceFromParent(distanceFromParent)
+	, orbitalAngle(0.0f)
+	, axialAngle(0.0f)
+	, position(0.0f)
+	, rotationAxis(0.0f)
+	, translationMatrix(1.0f)
+	, axialRotationMatrix(1.0f)
+	, negAxialRotationMatrix(1.0f)
+{
+	resetOrientation();
+	updateLocation();
+	updateTranslationMatrix();
+}
+
+
+void BodyMotion::resetOrientation() {
+	orbitalAngle = glm::half_pi<float>();
+	axialAngle = glm::half_pi<float>();
+
+	float initAxialAngle = orbitalInclination + axialAngle + axialTilt;
+	axialRotationMatrix = glm::rotate(glm::mat4(1.0f), initAxialAngle, xAxisOfRotation);
+	negAxialRotationMatrix = glm::mat4(1.0f);
+	rotationAxis = glm::vec3(axialRotationMatrix * yAxisMatrix);
+}
+
+
+void BodyMotion::advance(float elapsed, float speed) {
+	axialAngle += rotationSpeed * speed * elapsed;
+	axialRotationMatrix = glm::rotate(glm::mat4(1.0f), axialAngle, rotationAxis);
+	negAxialRotationMatrix = glm::rotate(glm::mat4(1.0f), -axialAngle, rotationAxis);
+
+	orbitalAngle += orbitalSpeed * speed * elapsed;
+	updateLocation();
+	updateTranslationMatrix();
+}
+
+
+void BodyMotion::updateLocation() {
+	if (parent == nullptr) {
+		position = glm::vec3(0.0f);
+	}
+	else {
+		glm::vec3 relativePositionFromParent = distanceFromParent * glm::vec3(
+			std::sin(orbitalAngle),
+			std::sin(orbitalAngle) * std::sin(orbitalInclination),
+			std::cos(orbitalAngle));
+		position = parent->getPosition() + relativePositionFromParent;
+	}
+}
+
+
+void BodyMotion::updateTranslationMatrix() {
+	if (parent == nullptr) {
+		translationMatrix = glm::mat4(1.0f);
+	}
+	else {
+		translationMatrix = glm::translate(glm::mat4(1.0f), position);
+	}
+}
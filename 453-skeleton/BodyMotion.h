@@ -0,0 +1,57 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// This file contains the motion of a single celestial body: its spin about
+// its own axis and its orbit around a parent body, and the model matrices
+// that follow from them. Nothing in here touches OpenGL, so it can be stepped
+// and measured without a context.
+//
+// Axial rotation is the rotation of the body about its axis, independent of
+// other bodies. Orbital rotation is the rotation of the entire body about its
+// parent (in orbit).
+//------------------------------------------------------------------------------
+
+#include <glm/glm.hpp>
+
+
+class BodyMotion {
+
+public:
+	// Speeds are in radians per second at animation speed 1, angles in
+	// radians. A body without a parent sits at the origin.
+	BodyMotion(float rotationSpeed, float orbitalSpeed, float orbitalInclination, float axialTilt,
+		const BodyMotion* parent = nullptr, float distanceFromParent = 0.0f);
+
+	// Public interface
+	void resetOrientation();
+
+	// Steps by elapsed seconds, scaled by speed. The parent has to be
+	// advanced first.
+	void advance(float elapsed, float speed);
+
+	glm::vec3 getPosition() const { return position; }
+	const glm::mat4& getTranslation() const { return translationMatrix; }
+	const glm::mat4& getRotation() const { return axialRotationMatrix; }
+	const glm::mat4& getNegRotation() const { return negAxialRotationMatrix; }
+
+private:
+	const float rotationSpeed;
+	const float orbitalSpeed;
+	const float orbitalInclination;
+	const float axialTilt;
+	const BodyMotion* parent;
+	const float distanceFromParent;
+
+	float orbitalAngle;
+	float axialAngle;
+
+	glm::vec3 position;
+	glm::vec3 rotationAxis;
+
+	glm::mat4 translationMatrix;
+	glm::mat4 axialRotationMatrix;
+	glm::mat4 negAxialRotationMatrix;
+
+	void updateLocation();
+	void updateTranslationMatrix();
+};
@@ -0,0 +1,39 @@
+#include "BodyStore.h"
+
+
+size_t BodyStore::add(glm::vec3 position, float r, bool testOcclusion) {
+	x.push_back(position.x);
+	y.push_back(position.y);
+	z.push_back(position.z);
+	radius.push_back(r);
+	occlusionTest.push_back(testOcclusion ? 1 : 0);
+	visible.push_back(1);
+	return x.size() - 1;
+}
+
+
+void BodyStore::setBounds(size_t i, glm::vec3 position, float r) {
+	x[i] = position.x;
+	y[i] = position.y;
+	z[i] = position.z;
+	radius[i] = r;
+}
+
+
+size_t BodyStore::append(const BodyCatalog& catalog, double time, float scale) {
+	const size_t first = size();
+	const size_t n = catalog.size();
+	x.resize(first + n);
+	y.resize(first + n);
+	z.resize(first + n);
+	radius.resize(first + n);
+	occlusionTest.resize(first + n, 0);
+	visible.resize(first + n, 1);
+
+	catalog.positions(time, scale, x.data() + first, y.data() + first, z.data() + first);
+	const float* r = catalog.getRadius();
+	for (size_t i = 0; i < n; i++) {
+		radius[first + i] = r[i] * scale;
+	}
+	return first;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// This file contains structure-of-arrays storage for per-body data that is
+// processed in bulk every frame (culling, and later picking and simulation).
+//
+// Each attribute lives in its own tightly packed array so loops over one or
+// two attributes touch only the memory they need and vectorize cleanly.
+//------------------------------------------------------------------------------
+
+#include "BodyCatalog.h"
+#include "MemoryAccounting.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+
+// Accounted as heap memory of the bodies, the part that scales with catalogs
+template<class T>
+using BodyVector = TrackedVector<T, MemoryCategory::Bodies>;
+
+
+struct BodyStore {
+	// bounding sphere in world space
+	BodyVector<float> x;
+	BodyVector<float> y;
+	BodyVector<float> z;
+	BodyVector<float> radius;
+
+	// 1 if the body should be tested with an occlusion query
+	BodyVector<uint8_t> occlusionTest;
+
+	// output of the culling stage, 1 if the body may be visible
+	BodyVector<uint8_t> visible;
+
+	size_t add(glm::vec3 position, float r, bool testOcclusion = false);
+
+	// Appends every body of catalog where it is at time (seconds after the
+	// catalog's epoch), with km scaled by scale. Each array grows once and
+	// is filled in place. Returns the index of the first body appended.
+	size_t append(const BodyCatalog& catalog, double time, float scale);
+
+	void setBounds(size_t i, glm::vec3 position, float r);
+
+	glm::vec3 getPosition(size_t i) const { return glm::vec3(x[i], y[i], z[i]); }
+	size_t size() const { return x.size(); }
+};
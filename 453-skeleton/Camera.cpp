@@ -11,15 +11,15 @@ Camera::Camera(float t, float p, float r) : theta(t), phi(p), radius(r) {
 }
 
 glm::mat4 Camera::getView() {
-	glm::vec3 eye = radius * glm::vec3(std::cos(theta) * std::sin(phi), std::sin(theta), std::cos(theta) * std::cos(phi));
-	glm::vec3 at = glm::vec3(0.0f, 0.0f, 0.0f);
+	glm::vec3 eye = getPos();
+	glm::vec3 at = target;
 	glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f);
 
 	return glm::lookAt(eye, at, up);
 }
 
 glm::vec3 Camera::getPos() {
-	return radius * glm::vec3(std::cos(theta) * std::sin(phi), std::sin(theta), std::cos(theta) * std::cos(phi));
+	return target + radius * glm::vec3(std::cos(theta) * std::sin(phi), std::sin(theta), std::cos(theta) * std::cos(phi));
 }
 
 void Camera::incrementTheta(float dt) {
@@ -40,3 +40,17 @@ void Camera::incrementPhi(float dp) {
 void Camera::incrementR(float dr) {
 	radius -= dr;
 }
+
+void Camera::set(float t, float p, float r) {
+	theta = t;
+	phi = p;
+	radius = r;
+}
+
+void Camera::setRadius(float r) {
+	radius = r;
+}
+
+void Camera::setTarget(glm::vec3 t) {
+	target = t;
+}
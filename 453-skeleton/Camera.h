@@ -1,7 +1,8 @@
 #pragma once
 
 //------------------------------------------------------------------------------
-// This file contains an implementation of a spherical camera
+// This file contains an implementation of a spherical camera, orbiting a
+// target point (the origin unless set)
 //------------------------------------------------------------------------------
 
 #include <GL/glew.h>
@@ -17,10 +18,15 @@ public:
 	void incrementTheta(float dt);
 	void incrementPhi(float dp);
 	void incrementR(float dr);
+	void set(float t, float p, float r);
+	void setRadius(float r);
+	void setTarget(glm::vec3 t);
+	glm::vec3 getTarget() const { return target; }
 
 private:
 
 	float theta;
 	float phi;
 	float radius;
+	glm::vec3 target = glm::vec3(0.0f);
 };
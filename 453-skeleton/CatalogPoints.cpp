@@ -0,0 +1,39 @@
+#include "CatalogPoints.h"
+
+#include <vector>
+
+
+CatalogPoints::CatalogPoints(ShaderCache& shaders)
+	: vao()
+	, positions(0, 3, GL_FLOAT, "catalog points")
+	, program(shaders.get("shaders/points.vert", "shaders/points.frag"))
+	, count(0)
+{
+	// points.vert sets the size
+	glEnable(GL_PROGRAM_POINT_SIZE);
+}
+
+
+void CatalogPoints::upload(const BodyStore& store, size_t first, size_t n) {
+	std::vector<glm::vec3> verts(n);
+	for (size_t i = 0; i < n; i++) {
+		verts[i] = store.getPosition(first + i);
+	}
+	vao.bind();
+	positions.uploadData(GLsizeiptr(sizeof(glm::vec3) * n), verts.data(), GL_STATIC_DRAW);
+	count = n;
+}
+
+
+void CatalogPoints::submit(RenderQueue& queue) const {
+	if (count == 0) {
+		return;
+	}
+	DrawPacket packet;
+	packet.program = program;
+	packet.vao = vao;
+	packet.mode = GL_POINTS;
+	packet.count = GLsizei(count);
+
+	queue.submit(RenderQueue::makeKey(RenderPass::Opaque, packet.program, packet.texture, packet.vao, 1.0f), packet);
+}
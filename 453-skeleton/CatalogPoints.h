@@ -0,0 +1,39 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// This file contains the renderer for catalog bodies, which are far too many
+// and too small to tessellate. Every body is one point in a static vertex
+// buffer, and all of them go out in a single draw.
+//------------------------------------------------------------------------------
+
+#include "BodyStore.h"
+#include "RenderQueue.h"
+#include "ShaderCache.h"
+#include "ShaderProgram.h"
+#include "VertexArray.h"
+#include "VertexBuffer.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+
+
+class CatalogPoints {
+
+public:
+	CatalogPoints(ShaderCache& shaders);
+
+	// Public interface
+	// Replaces the points with bodies [first, first + count) of store
+	void upload(const BodyStore& store, size_t first, size_t count);
+
+	void submit(RenderQueue& queue) const;
+
+	size_t size() const { return count; }
+
+private:
+	VertexArray vao;
+	VertexBuffer positions;
+	ShaderProgram& program;
+	size_t count;
+};
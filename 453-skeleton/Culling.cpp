@@ -0,0 +1,135 @@
+#include "Culling.h"
+
+#include "GLStats.h"
+
+#include <cmath>
+
+
+Frustum Frustum::fromMatrix(const glm::mat4& PV) {
+	// glm is column-major, so row i is (m[0][i], m[1][i], m[2][i], m[3][i])
+	auto row = [&](int i) { return glm::vec4(PV[0][i], PV[1][i], PV[2][i], PV[3][i]); };
+	glm::vec4 r0 = row(0), r1 = row(1), r2 = row(2), r3 = row(3);
+
+	Frustum f;
+	f.planes[0] = r3 + r0;
+	f.planes[1] = r3 - r0;
+	f.planes[2] = r3 + r1;
+	f.planes[3] = r3 - r1;
+	f.planes[4] = r3 + r2;
+	f.planes[5] = r3 - r2;
+	for (glm::vec4& p : f.planes) {
+		p /= glm::length(glm::vec3(p));
+	}
+	return f;
+}
+
+
+size_t cullBodies(const Frustum& frustum, BodyStore& bodies) {
+	const size_t n = bodies.size();
+	const float* x = bodies.x.data();
+	const float* y = bodies.y.data();
+	const float* z = bodies.z.data();
+	const float* r = bodies.radius.data();
+	uint8_t* visible = bodies.visible.data();
+
+	for (size_t i = 0; i < n; i++) {
+		visible[i] = 1;
+	}
+
+	// One plane at a time over the whole array: the inner loop is branch-free
+	// over contiguous floats, which compilers turn into SIMD code.
+	for (const glm::vec4& p : frustum.planes) {
+		const float a = p.x, b = p.y, c = p.z, d = p.w;
+		for (size_t i = 0; i < n; i++) {
+			float distance = a * x[i] + b * y[i] + c * z[i] + d;
+			visible[i] &= uint8_t(distance >= -r[i]);
+		}
+	}
+
+	size_t count = 0;
+	for (size_t i = 0; i < n; i++) {
+		count += visible[i];
+	}
+	return count;
+}
+
+
+//------------------------------------------------------------------------------
+
+
+namespace {
+	// unit cube as 12 triangles
+	const glm::vec3 cubeVerts[] = {
+		{-1,-1, 1}, { 1,-1, 1}, { 1, 1, 1}, {-1,-1, 1}, { 1, 1, 1}, {-1, 1, 1},
+		{ 1,-1,-1}, {-1,-1,-1}, {-1, 1,-1}, { 1,-1,-1}, {-1, 1,-1}, { 1, 1,-1},
+		{-1,-1,-1}, {-1,-1, 1}, {-1, 1, 1}, {-1,-1,-1}, {-1, 1, 1}, {-1, 1,-1},
+		{ 1,-1, 1}, { 1,-1,-1}, { 1, 1,-1}, { 1,-1, 1}, { 1, 1,-1}, { 1, 1, 1},
+		{-1, 1, 1}, { 1, 1, 1}, { 1, 1,-1}, {-1, 1, 1}, { 1, 1,-1}, {-1, 1,-1},
+		{-1,-1,-1}, { 1,-1,-1}, { 1,-1, 1}, {-1,-1,-1}, { 1,-1, 1}, {-1,-1, 1},
+	};
+}
+
+
+OcclusionQueries::OcclusionQueries(ShaderCache& shaders)
+	: program(shaders.get("shaders/occlusion.vert", "shaders/occlusion.frag"))
+	, vao()
+	, cubeBuffer(0, 3, GL_FLOAT, "occlusion boxes")
+	, enabled(true)
+{
+	cubeBuffer.uploadData(sizeof(cubeVerts), cubeVerts, GL_STATIC_DRAW);
+}
+
+
+GLuint OcclusionQueries::getCondition(size_t i) const {
+	if (!enabled || i >= queries.size() || !issued[i]) {
+		return 0;
+	}
+	return queries[i];
+}
+
+
+void OcclusionQueries::issue(const BodyStore& bodies, const glm::mat4& V, const glm::mat4& P, glm::vec3 cameraPos) {
+	const size_t n = bodies.size();
+	if (queries.size() < n) {
+		queries.resize(n);
+		issued.resize(n, 0);
+	}
+	if (!enabled) {
+		return;
+	}
+
+	program.use();
+	vao.bind();
+	GLStats::uniform(glGetUniformLocation(program, "V"), V);
+	GLStats::uniform(glGetUniformLocation(program, "P"), P);
+	GLint sphereLocation = glGetUniformLocation(program, "sphere");
+
+	// test only, never write
+	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+	glDepthMask(GL_FALSE);
+
+	for (size_t i = 0; i < n; i++) {
+		issued[i] = 0;
+		if (!bodies.occlusionTest[i] || !bodies.visible[i]) {
+			continue;
+		}
+
+		// If the camera is inside (or nearly inside) the proxy box, its front
+		// faces get clipped and the query would wrongly report it hidden
+		glm::vec3 center = bodies.getPosition(i);
+		float r = bodies.radius[i];
+		if (glm::length(cameraPos - center) < r * 1.75f + 0.1f) {
+			continue;
+		}
+
+		GLStats::uniform(sphereLocation, glm::vec4(center, r));
+		glBeginQuery(GL_ANY_SAMPLES_PASSED, queries[i]);
+		glDrawArrays(GL_TRIANGLES, 0, GLsizei(sizeof(cubeVerts) / sizeof(cubeVerts[0])));
+		glEndQuery(GL_ANY_SAMPLES_PASSED);
+		GLStats::record(GLCall::Draw);
+		issued[i] = 1;
+	}
+
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+	glDepthMask(GL_TRUE);
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// This file contains the visibility stage run before bodies submit draws.
+//
+// cullBodies() tests every bounding sphere in a BodyStore against the view
+// frustum. OcclusionQueries then refines that with hardware occlusion queries:
+// after the frame is drawn, a cheap box around each candidate body is
+// rasterized against the finished depth buffer, and the next frame renders the
+// body under glBeginConditionalRender with that query. Bodies hidden behind a
+// large occluder (e.g. eclipsed by the sun) are then discarded on the GPU
+// without the CPU ever waiting for the result.
+//------------------------------------------------------------------------------
+
+#include "BodyStore.h"
+#include "GLHandles.h"
+#include "ShaderCache.h"
+#include "ShaderProgram.h"
+#include "VertexArray.h"
+#include "VertexBuffer.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+
+struct Frustum {
+	// left, right, bottom, top, near, far; normalized, pointing inwards
+	glm::vec4 planes[6];
+
+	// Gribb/Hartmann plane extraction from a combined P * V matrix
+	static Frustum fromMatrix(const glm::mat4& PV);
+};
+
+
+// Writes BodyStore::visible for every body. Returns the number of visible bodies.
+size_t cullBodies(const Frustum& frustum, BodyStore& bodies);
+
+
+class OcclusionQueries {
+
+public:
+	OcclusionQueries(ShaderCache& shaders);
+
+	// Public interface
+
+	// Query to pass as DrawPacket::condition for body i this frame, or 0 if the
+	// body should be drawn unconditionally
+	GLuint getCondition(size_t i) const;
+
+	// Rasterizes proxies for visible bodies flagged for occlusion testing.
+	// Call after the opaque pass so the depth buffer holds the occluders.
+	void issue(const BodyStore& bodies, const glm::mat4& V, const glm::mat4& P, glm::vec3 cameraPos);
+
+	void setEnabled(bool e) { enabled = e; }
+	bool isEnabled() const { return enabled; }
+
+private:
+	ShaderProgram& program;
+	VertexArray vao; // must be initialized before the buffer
+	VertexBuffer cubeBuffer;
+
+	std::vector<QueryHandle> queries;
+	std::vector<uint8_t> issued; // 1 if queries[i] holds a result from last frame
+
+	bool enabled;
+};
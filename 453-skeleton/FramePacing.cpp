@@ -0,0 +1,85 @@
+#include "FramePacing.h"
+
+#include "Log.h"
+
+#include <GLFW/glfw3.h>
+#include <argh.h>
+
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+
+FramePacingOptions parseFramePacingOptions(int argc, char* argv[]) {
+	argh::parser cmdl;
+	cmdl.add_params({ "--vsync", "--max-fps" });
+	cmdl.parse(argc, argv);
+
+	FramePacingOptions options;
+	std::string vsync = "on";
+	cmdl("--vsync", vsync) >> vsync;
+	cmdl("--max-fps", options.maxFps) >> options.maxFps;
+	options.onDemand = !cmdl["--continuous"];
+
+	if (vsync == "off") options.vsync = VsyncMode::Off;
+	else if (vsync == "adaptive") options.vsync = VsyncMode::Adaptive;
+	else if (vsync != "on" || !(options.maxFps >= 0.0)) {
+		Log::error("FRAME_PACING invalid options: vsync {} max-fps {}", vsync, options.maxFps);
+		throw std::runtime_error("Invalid frame pacing options");
+	}
+	return options;
+}
+
+
+void applyVsync(VsyncMode mode) {
+	int interval = mode == VsyncMode::Off ? 0 : 1;
+	if (mode == VsyncMode::Adaptive) {
+		if (glfwExtensionSupported("WGL_EXT_swap_control_tear") || glfwExtensionSupported("GLX_EXT_swap_control_tear")) {
+			interval = -1;
+		}
+		else {
+			Log::warning("FRAME_PACING adaptive vsync not supported, using vsync");
+		}
+	}
+	glfwSwapInterval(interval);
+}
+
+
+FrameLimiter::FrameLimiter(double maxFps)
+	: interval(maxFps > 0.0
+		? std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / maxFps))
+		: std::chrono::steady_clock::duration::zero())
+	, next(std::chrono::steady_clock::now())
+{}
+
+
+void FrameLimiter::wait() {
+	if (interval == std::chrono::steady_clock::duration::zero()) {
+		return;
+	}
+	auto now = std::chrono::steady_clock::now();
+	if (now < next) {
+		std::this_thread::sleep_until(next);
+		now = next;
+	}
+	// a late frame starts the next interval instead of bunching up the
+	// ones after it
+	next = now + interval;
+}
+
+
+void RedrawSignal::notify() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		pending = true;
+	}
+	condition.notify_one();
+}
+
+
+bool RedrawSignal::waitFor(std::chrono::milliseconds timeout) {
+	std::unique_lock<std::mutex> lock(mutex);
+	bool notified = condition.wait_for(lock, timeout, [this]() { return pending; });
+	pending = false;
+	return notified;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// This file contains how often frames are drawn and presented.
+//
+//	453-skeleton [--vsync on|off|adaptive] [--max-fps N] [--continuous]
+//
+// By default frames are drawn on demand: the main thread only publishes a
+// snapshot when something changed (input, animation, resize), and the
+// renderer sleeps on a RedrawSignal until one arrives or its own streaming
+// work needs another frame. A paused, untouched window then costs close to
+// nothing. --continuous redraws every step like before. The swap interval
+// and an optional frame cap bound the rate while something does change.
+//------------------------------------------------------------------------------
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+
+enum class VsyncMode {
+	Off,
+	On,
+	Adaptive // tears instead of waiting a whole interval when a frame is late
+};
+
+
+struct FramePacingOptions {
+	VsyncMode vsync = VsyncMode::On;
+	double maxFps = 0.0;  // 0 for no cap beyond vsync
+	bool onDemand = true; // false redraws every step
+};
+
+// Parses the command line. Logs and throws std::runtime_error on bad values.
+FramePacingOptions parseFramePacingOptions(int argc, char* argv[]);
+
+// Sets the swap interval of the current context. Adaptive falls back to On
+// without the swap_control_tear extension.
+void applyVsync(VsyncMode mode);
+
+
+// Sleeps so consecutive wait() calls return at most maxFps times a second
+class FrameLimiter {
+
+public:
+	explicit FrameLimiter(double maxFps);
+
+	// Public interface
+	void wait();
+
+private:
+	std::chrono::steady_clock::duration interval;
+	std::chrono::steady_clock::time_point next;
+};
+
+
+// Wakes the renderer when the main thread published something to draw
+class RedrawSignal {
+
+public:
+	// Public interface
+	void notify();
+
+	// Blocks until notify() or the timeout. Returns true if notified.
+	bool waitFor(std::chrono::milliseconds timeout);
+
+private:
+	std::mutex mutex;
+	std::condition_variable condition;
+	bool pending = false;
+};
@@ -1,81 +1,239 @@
 #include "GLDebug.h"
 #include "Log.h"
 
-#include <regex>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+	// New (not repeated) messages logged per second; more are only counted
+	constexpr int newMessagesPerSecond = 20;
+
+	struct Message {
+		GLenum source = 0;
+		GLenum type = 0;
+		GLenum severity = 0;
+		GLuint id = 0;
+		std::string text;
+		uint64_t count = 0;
+		bool logged = false;
+	};
+
+	// Shared by every context; with asynchronous output the driver may call
+	// in from its own threads
+	std::mutex mutex;
+	std::unordered_map<uint64_t, Message> messages;
+	std::chrono::steady_clock::time_point windowStart;
+	int newInWindow = 0;
+
+	uint64_t messageKey(GLenum source, GLenum type, GLuint id) {
+		return (uint64_t(source & 0xFFFF) << 48) | (uint64_t(type & 0xFFFF) << 32) | id;
+	}
+
+	bool allowNewMessage() {
+		auto now = std::chrono::steady_clock::now();
+		if (now - windowStart >= std::chrono::seconds(1)) {
+			windowStart = now;
+			newInWindow = 0;
+		}
+		return newInWindow++ < newMessagesPerSecond;
+	}
+
+	bool isPowerOfTen(uint64_t n) {
+		while (n >= 10 && n % 10 == 0) {
+			n /= 10;
+		}
+		return n == 1;
+	}
+
+	std::string_view trim(const GLchar* message, GLsizei length) {
+		std::string_view text(message, length >= 0 ? size_t(length) : std::strlen(message));
+		const char* whitespace = " \t\r\n";
+		size_t first = text.find_first_not_of(whitespace);
+		if (first == std::string_view::npos) {
+			return {};
+		}
+		return text.substr(first, text.find_last_not_of(whitespace) - first + 1);
+	}
+
+	const char* sourceName(GLenum source) {
+		switch (source)
+		{
+			case GL_DEBUG_SOURCE_API:             return "API";
+			case GL_DEBUG_SOURCE_WINDOW_SYSTEM:   return "Window System";
+			case GL_DEBUG_SOURCE_SHADER_COMPILER: return "Shader Compiler";
+			case GL_DEBUG_SOURCE_THIRD_PARTY:     return "Third Party";
+			case GL_DEBUG_SOURCE_APPLICATION:     return "Application";
+			case GL_DEBUG_SOURCE_OTHER:           return "Other";
+		}
+		return "";
+	}
+
+	const char* typeName(GLenum type) {
+		switch (type)
+		{
+			case GL_DEBUG_TYPE_ERROR:               return "Error";
+			case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR: return "Deprecated Behaviour";
+			case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR:  return "Undefined Behaviour";
+			case GL_DEBUG_TYPE_PORTABILITY:         return "Portability";
+			case GL_DEBUG_TYPE_PERFORMANCE:         return "Performance";
+			case GL_DEBUG_TYPE_MARKER:              return "Marker";
+			case GL_DEBUG_TYPE_PUSH_GROUP:          return "Push Group";
+			case GL_DEBUG_TYPE_POP_GROUP:           return "Pop Group";
+			case GL_DEBUG_TYPE_OTHER:               return "Other";
+		}
+		return "";
+	}
+
+	const char* severityName(GLenum severity) {
+		switch (severity)
+		{
+			case GL_DEBUG_SEVERITY_HIGH:         return "high";
+			case GL_DEBUG_SEVERITY_MEDIUM:       return "medium";
+			case GL_DEBUG_SEVERITY_LOW:          return "low";
+			case GL_DEBUG_SEVERITY_NOTIFICATION: return "notification";
+		}
+		return "";
+	}
+
+	int severityRank(GLenum severity) {
+		switch (severity)
+		{
+			case GL_DEBUG_SEVERITY_HIGH:   return 3;
+			case GL_DEBUG_SEVERITY_MEDIUM: return 2;
+			case GL_DEBUG_SEVERITY_LOW:    return 1;
+		}
+		return 0;
+	}
+
+	// Logs at the level matching the message's severity
+	template <typename S, typename... Args>
+	void report(GLenum severity, const S& format, const Args&... args) {
+		switch (severity)
+		{
+			case GL_DEBUG_SEVERITY_HIGH:   Log::error(format, args...); break;
+			case GL_DEBUG_SEVERITY_MEDIUM: Log::warn(format, args...); break;
+			case GL_DEBUG_SEVERITY_LOW:    Log::info(format, args...); break;
+			default:                       Log::debug(format, args...); break;
+		}
+	}
+}
+
 
 void GLDebug::debugOutputHandler(
 	GLenum source,
 	GLenum type,
 	GLuint id,
 	GLenum severity,
-	GLsizei,
+	GLsizei length,
 	const GLchar *message,
 	const void *
 ) {
-    // ignore non-significant error/warning codes
-    //if(id == 131169 || id == 131185 || id == 131218 || id == 131204) return;
-
-    std::string sourceStr, typeStr, severityStr;
-
-    switch (source)
-    {
-        case GL_DEBUG_SOURCE_API:             sourceStr = "API"; break;
-        case GL_DEBUG_SOURCE_WINDOW_SYSTEM:   sourceStr = "Window System"; break;
-        case GL_DEBUG_SOURCE_SHADER_COMPILER: sourceStr = "Shader Compiler"; break;
-        case GL_DEBUG_SOURCE_THIRD_PARTY:     sourceStr = "Third Party"; break;
-        case GL_DEBUG_SOURCE_APPLICATION:     sourceStr = "Application"; break;
-        case GL_DEBUG_SOURCE_OTHER:           sourceStr = "Other"; break;
-    }
-
-    switch (type)
-    {
-        case GL_DEBUG_TYPE_ERROR:               typeStr = "Error"; break;
-        case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR: typeStr = "Deprecated Behaviour"; break;
-        case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR:  typeStr = "Undefined Behaviour"; break;
-        case GL_DEBUG_TYPE_PORTABILITY:         typeStr = "Portability"; break;
-        case GL_DEBUG_TYPE_PERFORMANCE:         typeStr = "Performance"; break;
-        case GL_DEBUG_TYPE_MARKER:              typeStr = "Marker"; break;
-        case GL_DEBUG_TYPE_PUSH_GROUP:          typeStr = "Push Group"; break;
-        case GL_DEBUG_TYPE_POP_GROUP:           typeStr = "Pop Group"; break;
-        case GL_DEBUG_TYPE_OTHER:               typeStr = "Other"; break;
-    }
-
-    std::string format = "[OPENGL] [{}] {} #{} -- {}: {}";
-    std::string message_str = message;
-    message_str = std::regex_replace(message_str, std::regex("^\\s+|\\s+$"), "$1");
-    switch (severity)
-    {
-        case GL_DEBUG_SEVERITY_HIGH:
-            severityStr = "high";
-			Log::error(format.c_str(), sourceStr, severityStr, id, typeStr, message_str);
-            break;
-        case GL_DEBUG_SEVERITY_MEDIUM:
-            severityStr = "medium";
-			Log::warn(format.c_str(), sourceStr, severityStr, id, typeStr, message_str);
-            break;
-        case GL_DEBUG_SEVERITY_LOW:
-            severityStr = "low";
-			Log::info(format.c_str(), sourceStr, severityStr, id, typeStr, message_str);
-            break;
-        case GL_DEBUG_SEVERITY_NOTIFICATION:
-			Log::debug(format.c_str(), sourceStr, severityStr, id, typeStr, message_str);
-            break;
-    }
+	// Entries are never erased, so text stays valid once the lock is gone
+	const Message* entry;
+	uint64_t count;
+	bool logged;
+	bool firstReport = false;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		auto inserted = messages.try_emplace(messageKey(source, type, id));
+		Message& m = inserted.first->second;
+		if (inserted.second) {
+			m.source = source;
+			m.type = type;
+			m.severity = severity;
+			m.id = id;
+			m.text = trim(message, length);
+		}
+		// A message over the rate limit gets another chance on every repeat;
+		// high severity ones are never held back
+		if (!m.logged) {
+			m.logged = severity == GL_DEBUG_SEVERITY_HIGH || allowNewMessage();
+			firstReport = m.logged;
+		}
+		count = ++m.count;
+		logged = m.logged;
+		entry = &m;
+	}
+
+	if (!logged) {
+		return; // over the rate limit; only counted until it fits
+	}
+	if (firstReport && count == 1) {
+		report(severity, "[OPENGL] [{}] {} #{} -- {}: {}", sourceName(source), severityName(severity), id, typeName(type), entry->text);
+	}
+	else if (firstReport) {
+		report(severity, "[OPENGL] [{}] {} #{} -- {}: {} (seen {} times)", sourceName(source), severityName(severity), id, typeName(type), entry->text, count);
+	}
+	else if (isPowerOfTen(count)) {
+		report(severity, "[OPENGL] #{} repeated {} times -- {}", id, count, entry->text);
+	}
 }
 
-void GLDebug::enable() {
+void GLDebug::enable(Mode mode, GLenum minSeverity) {
 	GLint flags;
 	glGetIntegerv(GL_CONTEXT_FLAGS, &flags);
 	if (flags & GL_CONTEXT_FLAG_DEBUG_BIT)
 	{
 		// initialize debug output
 		glEnable(GL_DEBUG_OUTPUT);
-		glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+		if (mode == Mode::Synchronous) {
+			glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+		}
+		else {
+			glDisable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+		}
 		glDebugMessageCallback(GLDebug::debugOutputHandler, nullptr);
-		glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, nullptr, GL_TRUE);
-		Log::info("Enabling debug mode for opengl");
+
+		// the driver drops everything below minSeverity before it reaches us
+		glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, nullptr, GL_FALSE);
+		for (GLenum severity : { GL_DEBUG_SEVERITY_NOTIFICATION, GL_DEBUG_SEVERITY_LOW, GL_DEBUG_SEVERITY_MEDIUM, GL_DEBUG_SEVERITY_HIGH }) {
+			if (severityRank(severity) >= severityRank(minSeverity)) {
+				glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, severity, 0, nullptr, GL_TRUE);
+			}
+		}
+
+		// the profiler's debug groups are for capture tools, not the log
+		glDebugMessageControl(GL_DEBUG_SOURCE_APPLICATION, GL_DEBUG_TYPE_PUSH_GROUP, GL_DONT_CARE, 0, nullptr, GL_FALSE);
+		glDebugMessageControl(GL_DEBUG_SOURCE_APPLICATION, GL_DEBUG_TYPE_POP_GROUP, GL_DONT_CARE, 0, nullptr, GL_FALSE);
+
+		// NVIDIA chatter: buffer/framebuffer placement, texture state, recompiles
+		ignore(GL_DEBUG_SOURCE_API, GL_DEBUG_TYPE_OTHER, 131169);
+		ignore(GL_DEBUG_SOURCE_API, GL_DEBUG_TYPE_OTHER, 131185);
+		ignore(GL_DEBUG_SOURCE_API, GL_DEBUG_TYPE_OTHER, 131204);
+		ignore(GL_DEBUG_SOURCE_API, GL_DEBUG_TYPE_PERFORMANCE, 131218);
+
+		Log::info("Enabling {} debug mode for opengl", mode == Mode::Synchronous ? "synchronous" : "asynchronous");
 	} else {
 		Log::warn("Unable to enable debug mode for opengl");
 	}
 }
 
+void GLDebug::ignore(GLenum source, GLenum type, GLuint id) {
+	glDebugMessageControl(source, type, GL_DONT_CARE, 1, &id, GL_FALSE);
+}
+
+void GLDebug::printSummary() {
+	std::vector<Message> repeated;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for (const auto& entry : messages) {
+			if (entry.second.count > 1 || !entry.second.logged) {
+				repeated.push_back(entry.second);
+			}
+		}
+	}
+	std::sort(repeated.begin(), repeated.end(), [](const Message& a, const Message& b) {
+		return a.count > b.count;
+	});
+
+	for (const Message& m : repeated) {
+		Log::info("[OPENGL] {}x [{}] {} #{} -- {}: {}", m.count, sourceName(m.source), severityName(m.severity), m.id, typeName(m.type), m.text);
+	}
+}
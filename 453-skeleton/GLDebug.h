@@ -7,11 +7,35 @@
 //
 // We are going to use it (best we can) to give you advanced warning of when you
 // are doing something incorrectly.
+//
+// Severities below the minimum, and a few ids known to be driver chatter,
+// are filtered by the driver through glDebugMessageControl, so they never
+// reach us. Of the rest, each distinct message (by source, type and id) is
+// logged once. Repeats are only counted; the count is logged again at 10,
+// 100, 1000, ... repeats, and printSummary() lists them all. At most a few
+// new messages are logged per second; one over that limit is logged on a
+// later repeat that fits, and high severity messages are always logged.
+//
+// Synchronous mode delivers messages on the thread and inside the call that
+// caused them, which is what you want under a debugger. Asynchronous mode lets
+// the driver report them later, from any thread, so it costs the frame loop
+// nothing. Release (NDEBUG) builds default to asynchronous.
 //------------------------------------------------------------------------------
 
 
 namespace GLDebug {
 
+	enum class Mode {
+		Synchronous,
+		Asynchronous
+	};
+
+#ifdef NDEBUG
+	constexpr Mode defaultMode = Mode::Asynchronous;
+#else
+	constexpr Mode defaultMode = Mode::Synchronous;
+#endif
+
 	void debugOutputHandler(
 		GLenum source,
 		GLenum type,
@@ -22,5 +46,13 @@ namespace GLDebug {
 		const void *
 	);
 
-	void enable();
+	// For the context current on this thread. minSeverity is one of the
+	// GL_DEBUG_SEVERITY_* values; notifications are off by default.
+	void enable(Mode mode = defaultMode, GLenum minSeverity = GL_DEBUG_SEVERITY_LOW);
+
+	// Stops the driver from reporting one message in the current context
+	void ignore(GLenum source, GLenum type, GLuint id);
+
+	// Logs every message that was reported more than once, most frequent first
+	void printSummary();
 }
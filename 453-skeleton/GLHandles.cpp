@@ -46,6 +46,7 @@ ShaderProgramHandle::ShaderProgramHandle()
 
 ShaderProgramHandle::ShaderProgramHandle(ShaderProgramHandle&& other) noexcept
 	: programID(std::move(other.programID))
+	, memory(std::move(other.memory))
 {
 	other.programID = 0;
 }
@@ -53,6 +54,7 @@ ShaderProgramHandle::ShaderProgramHandle(ShaderProgramHandle&& other) noexcept
 
 ShaderProgramHandle& ShaderProgramHandle::operator=(ShaderProgramHandle&& other) noexcept {
 	std::swap(programID, other.programID);
+	std::swap(memory, other.memory);
 	return *this;
 }
 
@@ -120,6 +122,7 @@ VertexBufferHandle::VertexBufferHandle()
 
 VertexBufferHandle::VertexBufferHandle(VertexBufferHandle&& other) noexcept
 	: vboID(std::move(other.vboID))
+	, memory(std::move(other.memory))
 {
 	other.vboID = 0;
 }
@@ -127,6 +130,7 @@ VertexBufferHandle::VertexBufferHandle(VertexBufferHandle&& other) noexcept
 
 VertexBufferHandle& VertexBufferHandle::operator=(VertexBufferHandle&& other) noexcept {
 	std::swap(vboID, other.vboID);
+	std::swap(memory, other.memory);
 	return *this;
 }
 
@@ -157,12 +161,14 @@ TextureHandle::TextureHandle()
 
 TextureHandle::TextureHandle(TextureHandle&& other) noexcept
 	: textureID(std::move(other.textureID))
+	, memory(std::move(other.memory))
 {
 	other.textureID = 0;
 }
 
 TextureHandle& TextureHandle::operator=(TextureHandle&& other) noexcept {
 	std::swap(textureID, other.textureID);
+	std::swap(memory, other.memory);
 	return *this;
 }
 
@@ -180,3 +186,113 @@ TextureHandle::operator GLuint() const {
 GLuint TextureHandle::value() const {
 	return textureID;
 }
+
+
+//------------------------------------------------------------------------------
+
+QueryHandle::QueryHandle()
+	: queryID(0) // Due to OpenGL syntax, we can't initial directly here, like we want.
+{
+	glGenQueries(1, &queryID);
+}
+
+
+QueryHandle::QueryHandle(QueryHandle&& other) noexcept
+	: queryID(std::move(other.queryID))
+{
+	other.queryID = 0;
+}
+
+QueryHandle& QueryHandle::operator=(QueryHandle&& other) noexcept {
+	std::swap(queryID, other.queryID);
+	return *this;
+}
+
+
+QueryHandle::~QueryHandle() {
+	glDeleteQueries(1, &queryID);
+}
+
+
+QueryHandle::operator GLuint() const {
+	return queryID;
+}
+
+
+GLuint QueryHandle::value() const {
+	return queryID;
+}
+
+
+//------------------------------------------------------------------------------
+
+FramebufferHandle::FramebufferHandle()
+	: framebufferID(0) // Due to OpenGL syntax, we can't initial directly here, like we want.
+{
+	glGenFramebuffers(1, &framebufferID);
+}
+
+
+FramebufferHandle::FramebufferHandle(FramebufferHandle&& other) noexcept
+	: framebufferID(std::move(other.framebufferID))
+{
+	other.framebufferID = 0;
+}
+
+FramebufferHandle& FramebufferHandle::operator=(FramebufferHandle&& other) noexcept {
+	std::swap(framebufferID, other.framebufferID);
+	return *this;
+}
+
+
+FramebufferHandle::~FramebufferHandle() {
+	glDeleteFramebuffers(1, &framebufferID);
+}
+
+
+FramebufferHandle::operator GLuint() const {
+	return framebufferID;
+}
+
+
+GLuint FramebufferHandle::value() const {
+	return framebufferID;
+}
+
+
+//------------------------------------------------------------------------------
+
+RenderbufferHandle::RenderbufferHandle()
+	: renderbufferID(0) // Due to OpenGL syntax, we can't initial directly here, like we want.
+{
+	glGenRenderbuffers(1, &renderbufferID);
+}
+
+
+RenderbufferHandle::RenderbufferHandle(RenderbufferHandle&& other) noexcept
+	: renderbufferID(std::move(other.renderbufferID))
+	, memory(std::move(other.memory))
+{
+	other.renderbufferID = 0;
+}
+
+RenderbufferHandle& RenderbufferHandle::operator=(RenderbufferHandle&& other) noexcept {
+	std::swap(renderbufferID, other.renderbufferID);
+	std::swap(memory, other.memory);
+	return *this;
+}
+
+
+RenderbufferHandle::~RenderbufferHandle() {
+	glDeleteRenderbuffers(1, &renderbufferID);
+}
+
+
+RenderbufferHandle::operator GLuint() const {
+	return renderbufferID;
+}
+
+
+GLuint RenderbufferHandle::value() const {
+	return renderbufferID;
+}
@@ -1,7 +1,11 @@
 #pragma once
 
+#include "MemoryAccounting.h"
+
 #include <GL/glew.h>
 
+#include <string_view>
+
 
 // An RAII class for managing a Shader GLuint for OpenGL.
 //
@@ -93,8 +97,13 @@ public:
 	operator GLuint() const;
 	GLuint value() const;
 
+	// Accounts for the storage behind the handle, under tag, until the
+	// handle is deleted or tracked again
+	void track(MemoryCategory category, std::string_view tag, size_t bytes) { memory.set(category, tag, bytes); }
+
 private:
 	GLuint programID;
+	MemoryRecord memory;
 
 };
 
@@ -150,8 +159,11 @@ public:
 	operator GLuint() const;
 	GLuint value() const;
 
+	void track(MemoryCategory category, std::string_view tag, size_t bytes) { memory.set(category, tag, bytes); }
+
 private:
 	GLuint vboID;
+	MemoryRecord memory;
 
 };
 
@@ -178,7 +190,94 @@ public:
 	operator GLuint() const;
 	GLuint value() const;
 
+	void track(MemoryCategory category, std::string_view tag, size_t bytes) { memory.set(category, tag, bytes); }
+
 private:
 	GLuint textureID;
+	MemoryRecord memory;
+
+};
+
+// An RAII class for managing a Query GLuint for OpenGL.
+class QueryHandle {
+
+public:
+	QueryHandle();
+
+	// Disallow copying
+	QueryHandle(const QueryHandle&) = delete;
+	QueryHandle operator=(const QueryHandle&) = delete;
+
+	// Allow moving
+	QueryHandle(QueryHandle&& other) noexcept;
+	QueryHandle& operator=(QueryHandle&& other) noexcept;
+
+	// Clean up after ourselves.
+	~QueryHandle();
+
+	// Allow casting from this type into a GLuint
+	// This allows usage in situations where a function expects a GLuint
+	operator GLuint() const;
+	GLuint value() const;
+
+private:
+	GLuint queryID;
+
+};
+
+// An RAII class for managing a Framebuffer GLuint for OpenGL.
+class FramebufferHandle {
+
+public:
+	FramebufferHandle();
+
+	// Disallow copying
+	FramebufferHandle(const FramebufferHandle&) = delete;
+	FramebufferHandle operator=(const FramebufferHandle&) = delete;
+
+	// Allow moving
+	FramebufferHandle(FramebufferHandle&& other) noexcept;
+	FramebufferHandle& operator=(FramebufferHandle&& other) noexcept;
+
+	// Clean up after ourselves.
+	~FramebufferHandle();
+
+	// Allow casting from this type into a GLuint
+	// This allows usage in situations where a function expects a GLuint
+	operator GLuint() const;
+	GLuint value() const;
+
+private:
+	GLuint framebufferID;
+
+};
+
+// An RAII class for managing a Renderbuffer GLuint for OpenGL.
+class RenderbufferHandle {
+
+public:
+	RenderbufferHandle();
+
+	// Disallow copying
+	RenderbufferHandle(const RenderbufferHandle&) = delete;
+	RenderbufferHandle operator=(const RenderbufferHandle&) = delete;
+
+	// Allow moving
+	RenderbufferHandle(RenderbufferHandle&& other) noexcept;
+	RenderbufferHandle& operator=(RenderbufferHandle&& other) noexcept;
+
+	// Clean up after ourselves.
+	~RenderbufferHandle();
+
+	// Allow casting from this type into a GLuint
+	// This allows usage in situations where a function expects a GLuint
+	operator GLuint() const;
+	GLuint value() const;
+
+	void track(MemoryCategory category, std::string_view tag, size_t bytes) { memory.set(category, tag, bytes); }
+
+private:
+	GLuint renderbufferID;
+	MemoryRecord memory;
 
 };
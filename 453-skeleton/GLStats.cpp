@@ -0,0 +1,241 @@
+#include "GLStats.h"
+
+#include "Log.h"
+
+#include <argh.h>
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace {
+	constexpr size_t bucketCount = 65; // 0, then one per bit width of a 64-bit value
+	constexpr uint64_t loggedViolations = 10;
+
+	struct Histogram {
+		std::array<uint64_t, bucketCount> buckets{};
+		uint64_t total = 0;
+		uint64_t max = 0;
+
+		void add(uint64_t value) {
+			size_t bucket = 0;
+			for (uint64_t v = value; v != 0; v >>= 1) {
+				bucket++;
+			}
+			buckets[bucket]++;
+			total += value;
+			max = std::max(max, value);
+		}
+
+		// Upper end of the bucket holding the nearest-rank percentile p
+		uint64_t percentile(double p, uint64_t frames) const {
+			uint64_t rank = uint64_t(p / 100.0 * double(frames) + 0.999999);
+			uint64_t seen = 0;
+			for (size_t i = 0; i < bucketCount; i++) {
+				seen += buckets[i];
+				if (seen >= rank && seen > 0) {
+					return i == 0 ? 0 : std::min(max, (uint64_t(1) << (i - 1)) * 2 - 1);
+				}
+			}
+			return max;
+		}
+
+		// " lo-hi:frames" for every non-empty bucket
+		std::string describe() const {
+			std::string text;
+			for (size_t i = 0; i < bucketCount; i++) {
+				if (buckets[i] == 0) {
+					continue;
+				}
+				uint64_t lo = i == 0 ? 0 : uint64_t(1) << (i - 1);
+				uint64_t hi = i == 0 ? 0 : lo * 2 - 1;
+				text += lo == hi ? fmt::format(" {}:{}", lo, buckets[i]) : fmt::format(" {}-{}:{}", lo, hi, buckets[i]);
+			}
+			return text;
+		}
+	};
+
+	// Counts of the frame in progress, written from any thread
+	std::array<std::atomic<uint64_t>, GLStats::callCount> frameCalls;
+	std::array<std::atomic<uint64_t>, GLStats::callCount> frameBytes;
+
+	// Owned by the thread that ends frames
+	GLStats::Limits limits;
+	std::array<Histogram, GLStats::callCount> callHistograms;
+	std::array<Histogram, GLStats::callCount> byteHistograms;
+	uint64_t frames = 0;
+	uint64_t violations = 0;
+
+	bool parseCount(const std::string& text, uint64_t& value) {
+		char* end = nullptr;
+		value = std::strtoull(text.c_str(), &end, 10);
+		if (end == text.c_str()) {
+			return false;
+		}
+		std::string suffix(end);
+		if (suffix == "k") value <<= 10;
+		else if (suffix == "m") value <<= 20;
+		else if (suffix == "g") value <<= 30;
+		else if (!suffix.empty()) return false;
+		return true;
+	}
+
+	// One name=value of --gl-limits; names are the call names, with a
+	// "-bytes" suffix for bytes
+	bool parseLimit(const std::string& field, GLStats::Limits& result) {
+		size_t equals = field.find('=');
+		if (equals == std::string::npos) {
+			return false;
+		}
+		std::string name = field.substr(0, equals);
+		uint64_t value;
+		if (!parseCount(field.substr(equals + 1), value)) {
+			return false;
+		}
+		for (size_t i = 0; i < GLStats::callCount; i++) {
+			std::string call = getCallName(GLCall(i));
+			if (name == call) {
+				result.calls[i] = value;
+				return true;
+			}
+			if (name == call + "-bytes") {
+				result.bytes[i] = value;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// violations counts the earlier frames over a limit
+	void logViolation(const std::string& what, uint64_t value, uint64_t limit) {
+		if (violations < loggedViolations) {
+			Log::warn("GL_STATS frame {} made {} {}, over the limit of {}{}", frames, value, what, limit,
+				violations + 1 == loggedViolations ? " (later frames over a limit are only counted)" : "");
+		}
+	}
+}
+
+
+const char* getCallName(GLCall call) {
+	switch (call) {
+	case GLCall::Draw: return "draws";
+	case GLCall::ConditionalDraw: return "conditional-draws";
+	case GLCall::ProgramBind: return "program-binds";
+	case GLCall::TextureBind: return "texture-binds";
+	case GLCall::VertexArrayBind: return "vertex-array-binds";
+	case GLCall::Uniform: return "uniforms";
+	case GLCall::BufferUpload: return "buffer-uploads";
+	case GLCall::TextureUpload: return "texture-uploads";
+	case GLCall::Readback: return "readbacks";
+	case GLCall::Count: break;
+	}
+	return "unknown";
+}
+
+
+#ifdef GL_STATS
+void GLStats::record(GLCall call, size_t bytes) {
+	frameCalls[size_t(call)].fetch_add(1, std::memory_order_relaxed);
+	if (bytes > 0) {
+		frameBytes[size_t(call)].fetch_add(bytes, std::memory_order_relaxed);
+	}
+}
+#endif
+
+
+GLStats::Limits GLStats::parseLimits(int argc, char* argv[]) {
+	argh::parser cmdl;
+	cmdl.add_params({ "--gl-limits" });
+	cmdl.parse(argc, argv);
+
+	Limits result;
+	std::string text;
+	if (!(cmdl("--gl-limits") >> text)) {
+		return result;
+	}
+	if (!enabled) {
+		Log::error("GL_STATS --gl-limits needs a build configured with -DGL_STATS=ON");
+		throw std::runtime_error("GL call statistics are not compiled in");
+	}
+
+	std::istringstream fields(text);
+	std::string field;
+	while (std::getline(fields, field, ',')) {
+		if (!parseLimit(field, result)) {
+			Log::error("GL_STATS invalid limit '{}' in --gl-limits {}", field, text);
+			throw std::runtime_error("Invalid GL limits");
+		}
+	}
+	return result;
+}
+
+
+void GLStats::setLimits(const Limits& newLimits) {
+	limits = newLimits;
+}
+
+
+void GLStats::endFrame() {
+	if (!enabled) {
+		return;
+	}
+	frames++;
+	bool over = false;
+	for (size_t i = 0; i < callCount; i++) {
+		uint64_t calls = frameCalls[i].exchange(0, std::memory_order_relaxed);
+		uint64_t bytes = frameBytes[i].exchange(0, std::memory_order_relaxed);
+		callHistograms[i].add(calls);
+		byteHistograms[i].add(bytes);
+
+		if (limits.calls[i] > 0 && calls > limits.calls[i]) {
+			logViolation(getCallName(GLCall(i)), calls, limits.calls[i]);
+			over = true;
+		}
+		if (limits.bytes[i] > 0 && bytes > limits.bytes[i]) {
+			logViolation(fmt::format("bytes of {}", getCallName(GLCall(i))), bytes, limits.bytes[i]);
+			over = true;
+		}
+	}
+	violations += over ? 1 : 0;
+}
+
+
+void GLStats::reset() {
+	callHistograms = {};
+	byteHistograms = {};
+	frames = 0;
+	violations = 0;
+}
+
+
+uint64_t GLStats::getViolations() {
+	return violations;
+}
+
+
+void GLStats::printSummary() {
+	if (!enabled || frames == 0) {
+		return;
+	}
+	Log::info("GL_STATS {} frames, per frame p50 / p95 / max, then frames per power of two bucket", frames);
+	for (size_t i = 0; i < callCount; i++) {
+		const Histogram& calls = callHistograms[i];
+		const Histogram& bytes = byteHistograms[i];
+		if (calls.total == 0) {
+			continue;
+		}
+		Log::info("GL_STATS {:<22} {} / {} / {} |{}", getCallName(GLCall(i)),
+			calls.percentile(50.0, frames), calls.percentile(95.0, frames), calls.max, calls.describe());
+		if (bytes.total > 0) {
+			Log::info("GL_STATS {:<22} {} / {} / {} |{}", fmt::format("{}-bytes", getCallName(GLCall(i))),
+				bytes.percentile(50.0, frames), bytes.percentile(95.0, frames), bytes.max, bytes.describe());
+		}
+	}
+	if (violations > 0) {
+		Log::error("GL_STATS {} of {} frames went over a limit", violations, frames);
+	}
+}
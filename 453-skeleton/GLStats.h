@@ -0,0 +1,113 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// This file contains per-frame statistics of the GL calls the app makes:
+// draws, binds, uniform updates and the bytes uploaded and read back.
+//
+//	cmake -DGL_STATS=ON ...
+//	453-skeleton --benchmark [--gl-limits draws=40,texture-uploads-bytes=4m]
+//
+// Only builds configured with GL_STATS count anything; in the others record()
+// is an empty inline function. The count is taken at the project's wrappers
+// and draw sites (RenderQueue, VertexBuffer, Texture, the culling and
+// streaming code), not by hooking the driver, so ImGui's own draws are not
+// included. Texture binds and uniform updates go through bindTexture() and
+// uniform() below, which make the call and count it in one place.
+//
+// Every frame's counts go into a histogram per call type, bucketed by powers
+// of two. Limits cap a call type's count or bytes per frame; frames that go
+// over are logged and counted, and a benchmark run with any of them exits
+// with an error, so draw call and upload regressions fail the run.
+//------------------------------------------------------------------------------
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+
+enum class GLCall : uint8_t {
+	Draw,
+	ConditionalDraw,
+	ProgramBind,
+	TextureBind,
+	VertexArrayBind,
+	Uniform,
+	BufferUpload,
+	TextureUpload,
+	Readback,
+
+	Count
+};
+
+const char* getCallName(GLCall call);
+
+
+namespace GLStats {
+	constexpr size_t callCount = size_t(GLCall::Count);
+
+#ifdef GL_STATS
+	constexpr bool enabled = true;
+
+	// Thread safe; uploads from the loader count towards the frame they land in
+	void record(GLCall call, size_t bytes = 0);
+#else
+	constexpr bool enabled = false;
+
+	inline void record(GLCall, size_t = 0) {}
+#endif
+
+	// glBindTexture, counted; unbinding (texture 0) counts too
+	inline void bindTexture(GLenum target, GLuint texture) {
+		glBindTexture(target, texture);
+		record(GLCall::TextureBind);
+	}
+
+	// glUniform* on the current program, counted
+	inline void uniform(GLint location, int value) {
+		glUniform1i(location, value);
+		record(GLCall::Uniform);
+	}
+	inline void uniform(GLint location, float value) {
+		glUniform1f(location, value);
+		record(GLCall::Uniform);
+	}
+	inline void uniform(GLint location, const glm::vec3& value) {
+		glUniform3fv(location, 1, &value[0]);
+		record(GLCall::Uniform);
+	}
+	inline void uniform(GLint location, const glm::vec4& value) {
+		glUniform4fv(location, 1, &value[0]);
+		record(GLCall::Uniform);
+	}
+	inline void uniform(GLint location, const glm::mat4& value) {
+		glUniformMatrix4fv(location, 1, GL_FALSE, &value[0][0]);
+		record(GLCall::Uniform);
+	}
+
+	// Most calls and bytes of each type a frame may issue; 0 for no limit
+	struct Limits {
+		std::array<uint64_t, callCount> calls{};
+		std::array<uint64_t, callCount> bytes{};
+	};
+
+	// Parses --gl-limits. Logs and throws std::runtime_error on bad values,
+	// or when limits are given to a build without GL_STATS.
+	Limits parseLimits(int argc, char* argv[]);
+	void setLimits(const Limits& limits);
+
+	// Closes the frame: adds its counts to the histograms and checks them
+	// against the limits. Call on the render thread after its last GL call.
+	void endFrame();
+
+	// Forgets every frame so far, e.g. the warmup frames of a benchmark
+	void reset();
+
+	// Frames since the last reset() that went over a limit
+	uint64_t getViolations();
+
+	// Logs the histograms. Not safe while frames are still ending.
+	void printSummary();
+}
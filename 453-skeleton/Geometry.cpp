@@ -5,21 +5,21 @@
 
 GPU_Geometry::GPU_Geometry()
 	: vao()
-	, vertBuffer(0, 3, GL_FLOAT)
-	, texCoordBuffer(1, 2, GL_FLOAT)
-	, normalsBuffer(2, 3, GL_FLOAT)
+	, vertBuffer(0, 3, GL_FLOAT, "body meshes")
+	, texCoordBuffer(1, 2, GL_FLOAT, "body meshes")
+	, normalsBuffer(2, 3, GL_FLOAT, "body meshes")
 {}
 
 
-void GPU_Geometry::setVerts(const std::vector<glm::vec3>& verts) {
-	vertBuffer.uploadData(sizeof(glm::vec3) * verts.size(), verts.data(), GL_STATIC_DRAW);
+void GPU_Geometry::setVerts(const glm::vec3* verts, size_t count) {
+	vertBuffer.uploadData(sizeof(glm::vec3) * count, verts, GL_STATIC_DRAW);
 }
 
 
-void GPU_Geometry::setTexCoords(const std::vector<glm::vec2>& texCoords) {
-	texCoordBuffer.uploadData(sizeof(glm::vec2) * texCoords.size(), texCoords.data(), GL_STATIC_DRAW);
+void GPU_Geometry::setTexCoords(const glm::vec2* texCoords, size_t count) {
+	texCoordBuffer.uploadData(sizeof(glm::vec2) * count, texCoords, GL_STATIC_DRAW);
 }
 
-void GPU_Geometry::setNormals(const std::vector<glm::vec3>& norms) {
-	normalsBuffer.uploadData(sizeof(glm::vec3) * norms.size(), norms.data(), GL_STATIC_DRAW);
+void GPU_Geometry::setNormals(const glm::vec3* norms, size_t count) {
+	normalsBuffer.uploadData(sizeof(glm::vec3) * count, norms, GL_STATIC_DRAW);
 }
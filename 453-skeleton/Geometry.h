@@ -12,16 +12,22 @@
 #include <GL/glew.h>
 #include <glm/glm.hpp>
 
+#include <cstddef>
+#include <memory>
 #include <vector>
 
 
-// List of vertices and texture coordinates using std::vector and glm::vec3
-struct CPU_Geometry {
-	std::vector<glm::vec3> verts;
-	std::vector<glm::vec2> texCoords;
-	std::vector<glm::vec3> normals;
+// List of vertices and texture coordinates using std::vector and glm::vec3.
+// Transient geometry can live in an arena with BasicCPUGeometry<ArenaAllocator>.
+template<template<class> class Allocator = std::allocator>
+struct BasicCPUGeometry {
+	std::vector<glm::vec3, Allocator<glm::vec3>> verts;
+	std::vector<glm::vec2, Allocator<glm::vec2>> texCoords;
+	std::vector<glm::vec3, Allocator<glm::vec3>> normals;
 };
 
+using CPU_Geometry = BasicCPUGeometry<>;
+
 
 // VAO and two VBOs for storing vertices and texture coordinates, respectively
 class GPU_Geometry {
@@ -31,10 +37,18 @@ public:
 
 	// Public interface
 	void bind() { vao.bind(); }
-
-	void setVerts(const std::vector<glm::vec3>& verts);
-	void setTexCoords(const std::vector<glm::vec2>& texCoords);
-	void setNormals(const std::vector<glm::vec3>& norms);
+	GLuint getVAO() const { return vao; }
+
+	void setVerts(const glm::vec3* verts, size_t count);
+	void setTexCoords(const glm::vec2* texCoords, size_t count);
+	void setNormals(const glm::vec3* norms, size_t count);
+
+	template<class A>
+	void setVerts(const std::vector<glm::vec3, A>& verts) { setVerts(verts.data(), verts.size()); }
+	template<class A>
+	void setTexCoords(const std::vector<glm::vec2, A>& texCoords) { setTexCoords(texCoords.data(), texCoords.size()); }
+	template<class A>
+	void setNormals(const std::vector<glm::vec3, A>& norms) { setNormals(norms.data(), norms.size()); }
 
 private:
 	// note: due to how OpenGL works, vao needs to be
@@ -0,0 +1,30 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// Small, stable (across runs and platforms) 64-bit FNV-1a hashing helpers.
+//
+// Unlike std::hash, results can be written to disk and compared later.
+//------------------------------------------------------------------------------
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+
+namespace Hash {
+	constexpr uint64_t fnvOffset = 14695981039346656037ull;
+	constexpr uint64_t fnvPrime = 1099511628211ull;
+
+	inline uint64_t fnv1a(const void* data, size_t size, uint64_t hash = fnvOffset) {
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		for (size_t i = 0; i < size; i++) {
+			hash ^= bytes[i];
+			hash *= fnvPrime;
+		}
+		return hash;
+	}
+
+	inline uint64_t fnv1a(const std::string& s, uint64_t hash = fnvOffset) {
+		return fnv1a(s.data(), s.size(), hash);
+	}
+}
@@ -0,0 +1,464 @@
+#include "Image.h"
+
+#include "Log.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb/stb_image.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+	//--------------------------------------------------------------------------
+	// sRGB transfer function
+
+	float srgbToLinear(float c) {
+		return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+	}
+
+	float linearToSrgb(float c) {
+		return c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+	}
+
+	const std::array<float, 256>& toLinearTable() {
+		static const std::array<float, 256> table = [] {
+			std::array<float, 256> t{};
+			for (int i = 0; i < 256; i++) {
+				t[i] = srgbToLinear(i / 255.0f);
+			}
+			return t;
+		}();
+		return table;
+	}
+
+	const std::array<uint8_t, 4096>& toSrgbTable() {
+		static const std::array<uint8_t, 4096> table = [] {
+			std::array<uint8_t, 4096> t{};
+			for (int i = 0; i < 4096; i++) {
+				t[i] = uint8_t(std::lround(linearToSrgb(i / 4095.0f) * 255.0f));
+			}
+			return t;
+		}();
+		return table;
+	}
+
+
+	//--------------------------------------------------------------------------
+	// Block compression helpers
+
+	// Copies the 4x4 block at (bx, by) out of an RGBA8 level, clamping at the
+	// edges so levels smaller than a block still encode
+	void fetchBlock(const ImageLevel& level, int bx, int by, uint8_t block[64]) {
+		for (int y = 0; y < 4; y++) {
+			int sy = std::min(by * 4 + y, level.height - 1);
+			for (int x = 0; x < 4; x++) {
+				int sx = std::min(bx * 4 + x, level.width - 1);
+				std::memcpy(&block[(y * 4 + x) * 4], &level.data[(size_t(sy) * level.width + sx) * 4], 4);
+			}
+		}
+	}
+
+	// Endpoints of the block's colors projected onto their principal axis.
+	// Only the first `channels` components are considered.
+	void principalEndpoints(const uint8_t block[64], int channels, float e0[4], float e1[4]) {
+		float mean[4] = { 0, 0, 0, 0 };
+		for (int i = 0; i < 16; i++) {
+			for (int c = 0; c < channels; c++) {
+				mean[c] += block[i * 4 + c] / 16.0f;
+			}
+		}
+
+		float cov[4][4] = {};
+		for (int i = 0; i < 16; i++) {
+			float d[4];
+			for (int c = 0; c < channels; c++) {
+				d[c] = block[i * 4 + c] - mean[c];
+			}
+			for (int a = 0; a < channels; a++) {
+				for (int b = 0; b < channels; b++) {
+					cov[a][b] += d[a] * d[b];
+				}
+			}
+		}
+
+		// power iteration
+		float axis[4] = { 1, 1, 1, 1 };
+		for (int iteration = 0; iteration < 8; iteration++) {
+			float next[4] = { 0, 0, 0, 0 };
+			for (int a = 0; a < channels; a++) {
+				for (int b = 0; b < channels; b++) {
+					next[a] += cov[a][b] * axis[b];
+				}
+			}
+			float length = 0.0f;
+			for (int c = 0; c < channels; c++) {
+				length += next[c] * next[c];
+			}
+			length = std::sqrt(length);
+			if (length < 1e-6f) {
+				break; // flat block, any axis works
+			}
+			for (int c = 0; c < channels; c++) {
+				axis[c] = next[c] / length;
+			}
+		}
+
+		float tMin = 1e9f, tMax = -1e9f;
+		for (int i = 0; i < 16; i++) {
+			float t = 0.0f;
+			for (int c = 0; c < channels; c++) {
+				t += (block[i * 4 + c] - mean[c]) * axis[c];
+			}
+			tMin = std::min(tMin, t);
+			tMax = std::max(tMax, t);
+		}
+		for (int c = 0; c < channels; c++) {
+			e0[c] = std::clamp(mean[c] + tMin * axis[c], 0.0f, 255.0f);
+			e1[c] = std::clamp(mean[c] + tMax * axis[c], 0.0f, 255.0f);
+		}
+	}
+
+	int squaredError(const uint8_t* a, const int* b, int channels) {
+		int e = 0;
+		for (int c = 0; c < channels; c++) {
+			int d = int(a[c]) - b[c];
+			e += d * d;
+		}
+		return e;
+	}
+
+
+	//--------------------------------------------------------------------------
+	// BC1
+
+	uint16_t to565(const float c[4]) {
+		int r = std::clamp(int(std::lround(c[0] * 31.0f / 255.0f)), 0, 31);
+		int g = std::clamp(int(std::lround(c[1] * 63.0f / 255.0f)), 0, 63);
+		int b = std::clamp(int(std::lround(c[2] * 31.0f / 255.0f)), 0, 31);
+		return uint16_t((r << 11) | (g << 5) | b);
+	}
+
+	void from565(uint16_t v, int out[3]) {
+		int r = (v >> 11) & 31, g = (v >> 5) & 63, b = v & 31;
+		out[0] = (r << 3) | (r >> 2);
+		out[1] = (g << 2) | (g >> 4);
+		out[2] = (b << 3) | (b >> 2);
+	}
+
+	void encodeBC1Block(const uint8_t block[64], uint8_t out[8]) {
+		float e0[4], e1[4];
+		principalEndpoints(block, 3, e0, e1);
+
+		uint16_t c0 = to565(e1);
+		uint16_t c1 = to565(e0);
+		if (c0 < c1) {
+			std::swap(c0, c1);
+		}
+
+		uint32_t indices = 0;
+		if (c0 != c1) {
+			// c0 > c1 selects the four color mode
+			int palette[4][3];
+			from565(c0, palette[0]);
+			from565(c1, palette[1]);
+			for (int c = 0; c < 3; c++) {
+				palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+				palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+			}
+			for (int i = 0; i < 16; i++) {
+				int best = 0, bestError = squaredError(&block[i * 4], palette[0], 3);
+				for (int p = 1; p < 4; p++) {
+					int e = squaredError(&block[i * 4], palette[p], 3);
+					if (e < bestError) {
+						best = p;
+						bestError = e;
+					}
+				}
+				indices |= uint32_t(best) << (2 * i);
+			}
+		}
+
+		out[0] = uint8_t(c0 & 0xFF);
+		out[1] = uint8_t(c0 >> 8);
+		out[2] = uint8_t(c1 & 0xFF);
+		out[3] = uint8_t(c1 >> 8);
+		for (int i = 0; i < 4; i++) {
+			out[4 + i] = uint8_t(indices >> (8 * i));
+		}
+	}
+
+
+	//--------------------------------------------------------------------------
+	// BC7, mode 6 only: one subset, 7.7.7.7 RGBA endpoints with a p-bit each,
+	// 4-bit indices. It handles smooth color maps well and is simple enough
+	// to encode quickly.
+
+	const int bc7Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	struct BitWriter {
+		uint8_t* out;
+		int position = 0;
+
+		void put(uint32_t value, int bits) {
+			for (int i = 0; i < bits; i++, position++) {
+				if (value & (1u << i)) {
+					out[position >> 3] |= uint8_t(1u << (position & 7));
+				}
+			}
+		}
+	};
+
+	// Quantizes an endpoint to 7 bits per channel plus a shared p-bit,
+	// picking whichever p-bit reconstructs it more closely
+	void quantizeBC7Endpoint(const float e[4], int q[4], int& pbit) {
+		float bestError = 1e30f;
+		for (int p = 0; p < 2; p++) {
+			int candidate[4];
+			float error = 0.0f;
+			for (int c = 0; c < 4; c++) {
+				candidate[c] = std::clamp(int(std::lround((e[c] - p) / 2.0f)), 0, 127);
+				float d = float(candidate[c] * 2 + p) - e[c];
+				error += d * d;
+			}
+			if (error < bestError) {
+				bestError = error;
+				pbit = p;
+				std::copy(candidate, candidate + 4, q);
+			}
+		}
+	}
+
+	void encodeBC7Block(const uint8_t block[64], uint8_t out[16]) {
+		float e0[4], e1[4];
+		principalEndpoints(block, 4, e0, e1);
+
+		int q0[4], q1[4], p0 = 0, p1 = 0;
+		quantizeBC7Endpoint(e0, q0, p0);
+		quantizeBC7Endpoint(e1, q1, p1);
+
+		int palette[16][4];
+		for (int i = 0; i < 16; i++) {
+			int w = bc7Weights4[i];
+			for (int c = 0; c < 4; c++) {
+				int a = q0[c] * 2 + p0, b = q1[c] * 2 + p1;
+				palette[i][c] = ((64 - w) * a + w * b + 32) >> 6;
+			}
+		}
+
+		int indices[16];
+		for (int i = 0; i < 16; i++) {
+			int best = 0, bestError = squaredError(&block[i * 4], palette[0], 4);
+			for (int p = 1; p < 16; p++) {
+				int e = squaredError(&block[i * 4], palette[p], 4);
+				if (e < bestError) {
+					best = p;
+					bestError = e;
+				}
+			}
+			indices[i] = best;
+		}
+
+		// The first index is stored with its top bit implied to be 0
+		if (indices[0] & 8) {
+			std::swap(q0, q1);
+			std::swap(p0, p1);
+			for (int& index : indices) {
+				index = 15 - index;
+			}
+		}
+
+		std::memset(out, 0, 16);
+		BitWriter writer{ out };
+		writer.put(1u << 6, 7); // mode 6
+		for (int c = 0; c < 4; c++) {
+			writer.put(uint32_t(q0[c]), 7);
+			writer.put(uint32_t(q1[c]), 7);
+		}
+		writer.put(uint32_t(p0), 1);
+		writer.put(uint32_t(p1), 1);
+		writer.put(uint32_t(indices[0]), 3);
+		for (int i = 1; i < 16; i++) {
+			writer.put(uint32_t(indices[i]), 4);
+		}
+	}
+}
+
+
+std::vector<ImageLevelView> levelViews(const Image& image) {
+	std::vector<ImageLevelView> views;
+	for (const ImageLevel& level : image.levels) {
+		views.push_back({ level.width, level.height, level.data.data(), level.data.size() });
+	}
+	return views;
+}
+
+
+bool isCompressed(PixelFormat format) {
+	return format == PixelFormat::BC1 || format == PixelFormat::BC7;
+}
+
+
+int bytesPerPixel(PixelFormat format) {
+	switch (format) {
+	case PixelFormat::R8: return 1;
+	case PixelFormat::RG8: return 2;
+	case PixelFormat::RGBA8: return 4;
+	default: return 0;
+	}
+}
+
+
+size_t levelSizeInBytes(PixelFormat format, int width, int height) {
+	size_t blocks = size_t((width + 3) / 4) * size_t((height + 3) / 4);
+	switch (format) {
+	case PixelFormat::BC1: return blocks * 8;
+	case PixelFormat::BC7: return blocks * 16;
+	default: return size_t(width) * size_t(height) * bytesPerPixel(format);
+	}
+}
+
+
+int mipLevelCount(int width, int height) {
+	int levels = 1;
+	while (width > 1 || height > 1) {
+		width = std::max(1, width / 2);
+		height = std::max(1, height / 2);
+		levels++;
+	}
+	return levels;
+}
+
+
+size_t Image::getSizeInBytes() const {
+	size_t total = 0;
+	for (const ImageLevel& level : levels) {
+		total += level.data.size();
+	}
+	return total;
+}
+
+
+bool loadImage(const std::string& path, Image& image, bool srgb, bool flipVertically) {
+	int width, height, numComponents;
+	if (!stbi_info(path.c_str(), &width, &height, &numComponents)) {
+		Log::error("IMAGE reading {}: {}", path, stbi_failure_reason());
+		return false;
+	}
+
+	// Color maps always go to RGBA so they stay sRGB-correct and aligned;
+	// one and two channel data maps keep their layout
+	bool expand = srgb || numComponents == 3;
+	int desired = expand ? 4 : numComponents;
+
+	stbi_set_flip_vertically_on_load_thread(flipVertically);
+	unsigned char* data = stbi_load(path.c_str(), &width, &height, &numComponents, desired);
+	if (data == nullptr) {
+		Log::error("IMAGE reading {}: {}", path, stbi_failure_reason());
+		return false;
+	}
+
+	switch (desired) {
+	case 1: image.format = PixelFormat::R8; break;
+	case 2: image.format = PixelFormat::RG8; break;
+	default: image.format = PixelFormat::RGBA8; break;
+	}
+	image.srgb = srgb && image.format == PixelFormat::RGBA8;
+
+	ImageLevel level;
+	level.width = width;
+	level.height = height;
+	level.data.assign(data, data + size_t(width) * height * desired);
+	stbi_image_free(data);
+
+	image.levels.clear();
+	image.levels.push_back(std::move(level));
+	return true;
+}
+
+
+void generateMipChain(Image& image) {
+	if (image.levels.empty() || isCompressed(image.format)) {
+		return;
+	}
+	image.levels.resize(1);
+
+	const int channels = bytesPerPixel(image.format);
+	const std::array<float, 256>& toLinear = toLinearTable();
+	const std::array<uint8_t, 4096>& toSrgb = toSrgbTable();
+
+	while (image.levels.back().width > 1 || image.levels.back().height > 1) {
+		const ImageLevel& source = image.levels.back();
+		ImageLevel next;
+		next.width = std::max(1, source.width / 2);
+		next.height = std::max(1, source.height / 2);
+		next.data.resize(size_t(next.width) * next.height * channels);
+
+		for (int y = 0; y < next.height; y++) {
+			int y0 = std::min(2 * y, source.height - 1);
+			int y1 = std::min(2 * y + 1, source.height - 1);
+			for (int x = 0; x < next.width; x++) {
+				int x0 = std::min(2 * x, source.width - 1);
+				int x1 = std::min(2 * x + 1, source.width - 1);
+				const uint8_t* p[4] = {
+					&source.data[(size_t(y0) * source.width + x0) * channels],
+					&source.data[(size_t(y0) * source.width + x1) * channels],
+					&source.data[(size_t(y1) * source.width + x0) * channels],
+					&source.data[(size_t(y1) * source.width + x1) * channels],
+				};
+				uint8_t* out = &next.data[(size_t(y) * next.width + x) * channels];
+
+				for (int c = 0; c < channels; c++) {
+					// alpha is always linear
+					if (image.srgb && c < 3) {
+						float sum = toLinear[p[0][c]] + toLinear[p[1][c]] + toLinear[p[2][c]] + toLinear[p[3][c]];
+						out[c] = toSrgb[std::min(4095, int(sum * 0.25f * 4095.0f + 0.5f))];
+					}
+					else {
+						out[c] = uint8_t((p[0][c] + p[1][c] + p[2][c] + p[3][c] + 2) / 4);
+					}
+				}
+			}
+		}
+		image.levels.push_back(std::move(next));
+	}
+}
+
+
+Image compressImage(const Image& image, PixelFormat target) {
+	Image result;
+	result.format = target;
+	result.srgb = image.srgb;
+	if (image.format != PixelFormat::RGBA8 || !isCompressed(target)) {
+		Log::error("IMAGE block compression needs RGBA8 input and a compressed target");
+		return image;
+	}
+
+	const size_t blockBytes = (target == PixelFormat::BC1) ? 8 : 16;
+	for (const ImageLevel& level : image.levels) {
+		ImageLevel out;
+		out.width = level.width;
+		out.height = level.height;
+		out.data.resize(levelSizeInBytes(target, level.width, level.height));
+
+		int blocksX = (level.width + 3) / 4;
+		int blocksY = (level.height + 3) / 4;
+		uint8_t block[64];
+		for (int by = 0; by < blocksY; by++) {
+			for (int bx = 0; bx < blocksX; bx++) {
+				fetchBlock(level, bx, by, block);
+				uint8_t* dst = &out.data[(size_t(by) * blocksX + bx) * blockBytes];
+				if (target == PixelFormat::BC1) {
+					encodeBC1Block(block, dst);
+				}
+				else {
+					encodeBC7Block(block, dst);
+				}
+			}
+		}
+		result.levels.push_back(std::move(out));
+	}
+	return result;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// This file contains CPU-side image data and the processing done on it before
+// it is uploaded as a texture: decoding, mip chain generation and block
+// compression (BC1 and BC7). Nothing in here touches OpenGL.
+//------------------------------------------------------------------------------
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+enum class PixelFormat : uint32_t {
+	R8 = 0,
+	RG8 = 1,
+	RGBA8 = 2,
+	BC1 = 3, // 4x4 blocks, 8 bytes, RGB with 1-bit alpha
+	BC7 = 4  // 4x4 blocks, 16 bytes, RGBA
+};
+
+
+struct ImageLevel {
+	int width = 0;
+	int height = 0;
+	std::vector<uint8_t> data;
+};
+
+
+// A level stored elsewhere, e.g. in a memory mapped texture container
+struct ImageLevelView {
+	int width = 0;
+	int height = 0;
+	const uint8_t* data = nullptr;
+	size_t size = 0;
+};
+
+
+struct Image {
+	PixelFormat format = PixelFormat::RGBA8;
+	bool srgb = false; // color data encoded with the sRGB transfer function
+	std::vector<ImageLevel> levels; // levels[0] is the full resolution image
+
+	int getWidth() const { return levels.empty() ? 0 : levels[0].width; }
+	int getHeight() const { return levels.empty() ? 0 : levels[0].height; }
+	size_t getSizeInBytes() const;
+};
+
+
+// Views of every level of image, valid as long as image isn't modified
+std::vector<ImageLevelView> levelViews(const Image& image);
+
+bool isCompressed(PixelFormat format);
+int bytesPerPixel(PixelFormat format); // uncompressed formats only
+size_t levelSizeInBytes(PixelFormat format, int width, int height);
+
+// Number of levels in a full mip chain down to 1x1
+int mipLevelCount(int width, int height);
+
+// Decodes an image file into level 0. Three channel images are expanded to
+// RGBA8 so every row stays 4-byte aligned. Logs and returns false on failure.
+bool loadImage(const std::string& path, Image& image, bool srgb, bool flipVertically = true);
+
+// Appends the full mip chain to an uncompressed image with one level, using a
+// 2x2 box filter (in linear space for sRGB images).
+void generateMipChain(Image& image);
+
+// Block-compresses every level of an uncompressed RGBA8 image
+Image compressImage(const Image& image, PixelFormat target);
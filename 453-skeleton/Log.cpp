@@ -0,0 +1,186 @@
+#include "Log.h"
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <thread>
+
+
+namespace {
+	using Log::Level;
+	using Log::detail::Record;
+
+	// Records in the ring, a power of two. About 1 MB.
+	constexpr size_t capacity = 4096;
+
+	// Bounded multi-producer queue after Dmitry Vyukov's: every slot carries
+	// a sequence number saying whose turn it is, so producers only contend on
+	// one counter and never on the slots.
+	class Writer {
+	public:
+		Writer()
+			: ring(new Record[capacity])
+			, enqueuePosition(0)
+			, dequeuePosition(0)
+			, written(0)
+			, droppedCount(0)
+			, stopping(false)
+		{
+			for (size_t i = 0; i < capacity; i++) {
+				ring[i].sequence.store(i, std::memory_order_relaxed);
+			}
+			thread = std::thread(&Writer::run, this);
+		}
+
+		~Writer() {
+			stopping.store(true, std::memory_order_release);
+			thread.join();
+		}
+
+		Record* claim() {
+			size_t position = enqueuePosition.load(std::memory_order_relaxed);
+			while (true) {
+				Record& record = ring[position & (capacity - 1)];
+				size_t sequence = record.sequence.load(std::memory_order_acquire);
+				intptr_t difference = intptr_t(sequence) - intptr_t(position);
+				if (difference == 0) {
+					if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+						record.position = position;
+						return &record;
+					}
+				}
+				else if (difference < 0) {
+					// the writer hasn't freed this slot since the last lap
+					droppedCount.fetch_add(1, std::memory_order_relaxed);
+					return nullptr;
+				}
+				else {
+					position = enqueuePosition.load(std::memory_order_relaxed);
+				}
+			}
+		}
+
+		void commit(Record* record) {
+			record->sequence.store(record->position + 1, std::memory_order_release);
+		}
+
+		void flush() {
+			size_t target = enqueuePosition.load(std::memory_order_acquire);
+			while (written.load(std::memory_order_acquire) < target) {
+				std::this_thread::sleep_for(std::chrono::microseconds(100));
+			}
+		}
+
+		uint64_t dropped() const { return droppedCount.load(std::memory_order_relaxed); }
+
+	private:
+		std::unique_ptr<Record[]> ring;
+		std::atomic<size_t> enqueuePosition;
+		size_t dequeuePosition; // writer thread only
+		std::atomic<size_t> written;
+		std::atomic<uint64_t> droppedCount;
+		std::atomic<bool> stopping;
+		std::thread thread;
+
+		static void header(Level level, fmt::memory_buffer& out) {
+			switch (level) {
+			case Level::Debug: fmt::format_to(out, "{}[DEBUG]{}: ", Log::ansi::green, Log::ansi::reset); break;
+			case Level::Info:  fmt::format_to(out, "{}[INFO]{}: ", Log::ansi::white, Log::ansi::reset); break;
+			case Level::Warn:  fmt::format_to(out, "{}[WARN]{}: ", Log::ansi::yellow, Log::ansi::reset); break;
+			case Level::Error: fmt::format_to(out, "{}[ERROR]{}: ", Log::ansi::red, Log::ansi::reset); break;
+			}
+		}
+
+		// Writes every committed record. Returns false if there was none.
+		bool drain(fmt::memory_buffer& line) {
+			bool any = false;
+			while (true) {
+				Record& record = ring[dequeuePosition & (capacity - 1)];
+				if (record.sequence.load(std::memory_order_acquire) != dequeuePosition + 1) {
+					break; // empty, or the next producer hasn't committed yet
+				}
+
+				line.clear();
+				header(record.level, line);
+				try {
+					record.decode(record.payload, record.format, line);
+				}
+				catch (const std::exception& e) {
+					fmt::format_to(line, "(bad log format: {})", e.what());
+				}
+				line.push_back('\n');
+				std::fwrite(line.data(), 1, line.size(), stdout);
+
+				record.sequence.store(dequeuePosition + capacity, std::memory_order_release);
+				dequeuePosition++;
+				written.store(dequeuePosition, std::memory_order_release);
+				any = true;
+			}
+			return any;
+		}
+
+		void run() {
+			fmt::memory_buffer line;
+			uint64_t reportedDrops = 0;
+			while (true) {
+				// read before draining, so nothing committed before the stop is lost
+				bool stop = stopping.load(std::memory_order_acquire);
+				bool wrote = drain(line);
+
+				uint64_t drops = dropped();
+				if (drops != reportedDrops) {
+					line.clear();
+					header(Level::Warn, line);
+					fmt::format_to(line, "LOG dropped {} message(s) so far, the ring was full\n", drops);
+					std::fwrite(line.data(), 1, line.size(), stdout);
+					reportedDrops = drops;
+					wrote = true;
+				}
+
+				if (wrote) {
+					std::fflush(stdout);
+				}
+				else if (stop) {
+					return;
+				}
+				else {
+					// producers never wake us; a short nap keeps them at a plain store
+					std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				}
+			}
+		}
+	};
+
+	Writer& writer() {
+		static Writer instance;
+		return instance;
+	}
+}
+
+
+uint64_t Log::dropped() {
+	return writer().dropped();
+}
+
+
+void Log::flush() {
+	writer().flush();
+}
+
+
+Record* Log::detail::claim() {
+	return writer().claim();
+}
+
+
+void Log::detail::commit(Record* record) {
+	writer().commit(record);
+}
+
+
+void Log::detail::decodeFormatted(const char* payload, fmt::string_view, fmt::memory_buffer& out) {
+	std::string* text;
+	std::memcpy(&text, payload, sizeof(text));
+	out.append(text->data(), text->data() + text->size());
+	delete text;
+}
@@ -10,6 +10,18 @@
 //		  Log::warning("Elapsed time: {0:.2f} seconds", 1.23);
 //		  Log::error("Elapsed time: {0:.2f} seconds", 1.23);
 //
+// Nothing is formatted or printed on the calling thread. The arguments are
+// copied into a lock-free ring buffer, and a background thread formats them
+// and writes to stdout. Strings are copied by value; any other argument type
+// must be trivially copyable, and the format string is copied too. Calls
+// with other argument types, or too large for a ring record, are formatted
+// on the calling thread, and only the printing is deferred. When the ring is
+// full, messages are dropped and counted (see dropped()). Errors wait for the
+// ring to drain, so they are on screen before any exception unwinds.
+//
+// Messages below LOG_MIN_LEVEL (0 debug, 1 info, 2 warn, 3 error) compile to
+// nothing. It defaults to 1 in release (NDEBUG) builds and to 0 otherwise.
+//
 // This code isn't intented for your review. Of course, if you feel like it, dive
 // right in.
 //------------------------------------------------------------------------------
@@ -17,44 +29,207 @@
 #include <fmt/format.h>
 #include <vivid/vivid.h>
 
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+
+#ifndef LOG_MIN_LEVEL
+#ifdef NDEBUG
+#define LOG_MIN_LEVEL 1
+#else
+#define LOG_MIN_LEVEL 0
+#endif
+#endif
 
 
 namespace Log {
 	namespace ansi = vivid::ansi;
-	template <typename S1, typename S2, typename S3, typename... Args>
-	void _log(const S1 &prefix, const S2 &c, const S3 &format_str, Args&&... args) {
-		fmt::print(
-			"{}[{}]{}: {}\n",
-			c,
-			prefix,
-			ansi::reset,
-			fmt::format(format_str, std::forward<Args>(args)...)
-		);
+
+	enum class Level {
+		Debug,
+		Info,
+		Warn,
+		Error
+	};
+
+	constexpr Level minLevel = Level(LOG_MIN_LEVEL);
+
+	// Messages dropped so far because the ring was full
+	uint64_t dropped();
+
+	// Blocks until everything logged so far has been written
+	void flush();
+
+
+	namespace detail {
+		constexpr size_t payloadSize = 200;
+
+		using Decoder = void (*)(const char* payload, fmt::string_view format, fmt::memory_buffer& out);
+
+		// One slot of the ring
+		struct Record {
+			std::atomic<size_t> sequence;
+			size_t position; // claimed ring position, set by claim()
+			Level level;
+			Decoder decode;
+			fmt::string_view format;
+			alignas(8) char payload[payloadSize];
+		};
+
+		// Reserves the next record, or returns nullptr and counts a drop if the
+		// ring is full. Every record claimed has to be committed.
+		Record* claim();
+
+		// Hands a filled record to the writer thread
+		void commit(Record* record);
+
+		template <typename T>
+		constexpr bool isString = std::is_same_v<T, const char*> || std::is_same_v<T, char*>
+			|| std::is_same_v<T, std::string> || std::is_same_v<T, std::string_view> || std::is_same_v<T, fmt::string_view>;
+
+		template <typename T>
+		constexpr bool isDeferrable = isString<T> || std::is_trivially_copyable_v<T>;
+
+		// What an argument is copied and formatted as
+		template <typename T>
+		using Stored = std::conditional_t<isString<T>, std::string_view, T>;
+
+		inline std::string_view asView(const char* s) { return s != nullptr ? std::string_view(s) : std::string_view("(null)"); }
+		inline std::string_view asView(const std::string& s) { return s; }
+		inline std::string_view asView(std::string_view s) { return s; }
+		inline std::string_view asView(fmt::string_view s) { return std::string_view(s.data(), s.size()); }
+
+		template <typename T>
+		size_t storedSize(const T& value) {
+			if constexpr (isString<T>) {
+				return sizeof(uint32_t) + asView(value).size();
+			}
+			else {
+				return sizeof(T);
+			}
+		}
+
+		template <typename T>
+		char* encode(char* out, const T& value) {
+			if constexpr (isString<T>) {
+				std::string_view s = asView(value);
+				uint32_t size = uint32_t(s.size());
+				std::memcpy(out, &size, sizeof(size));
+				std::memcpy(out + sizeof(size), s.data(), s.size());
+				return out + sizeof(size) + s.size();
+			}
+			else {
+				std::memcpy(out, &value, sizeof(T));
+				return out + sizeof(T);
+			}
+		}
+
+		template <typename T>
+		Stored<T> take(const char*& in) {
+			if constexpr (isString<T>) {
+				uint32_t size;
+				std::memcpy(&size, in, sizeof(size));
+				std::string_view s(in + sizeof(size), size);
+				in += sizeof(size) + size;
+				return s;
+			}
+			else {
+				T value;
+				std::memcpy(&value, in, sizeof(T));
+				in += sizeof(T);
+				return value;
+			}
+		}
+
+		// Runs on the writer thread
+		template <typename... Args>
+		void decode(const char* payload, fmt::string_view format, fmt::memory_buffer& out) {
+			// braced initialization takes the arguments in order
+			std::tuple<Stored<Args>...> values{ take<Args>(payload)... };
+			std::apply([&](const auto&... value) {
+				fmt::vformat_to(out, format, fmt::make_format_args(value...));
+			}, values);
+		}
+
+		// Message formatted by the caller, owned by the record until written
+		void decodeFormatted(const char* payload, fmt::string_view format, fmt::memory_buffer& out);
+
+		template <typename S, typename... Args>
+		std::string* format(const S& format_str, const Args&... args) {
+			try {
+				return new std::string(fmt::format(format_str, args...));
+			}
+			catch (const std::exception& e) {
+				// the record is claimed already, so it has to carry something
+				return new std::string(fmt::format("(bad log format: {})", e.what()));
+			}
+		}
+
+		template <Level level, typename S, typename... Args>
+		void log(const S& format_str, const Args&... args) {
+			if constexpr (level >= minLevel) {
+				Record* record = claim();
+				if (record == nullptr) {
+					return;
+				}
+				record->level = level;
+
+				// The format text is copied after the arguments, since the
+				// caller's string may be gone by the time the writer gets to it
+				bool deferred = false;
+				if constexpr (isString<std::decay_t<const S>> && (isDeferrable<std::decay_t<const Args>> && ...)) {
+					std::string_view format = asView(format_str);
+					size_t size = (format.size() + ... + storedSize<std::decay_t<const Args>>(args));
+					if (size <= payloadSize) {
+						char* out = record->payload;
+						((out = encode<std::decay_t<const Args>>(out, args)), ...);
+						std::memcpy(out, format.data(), format.size());
+						record->decode = &decode<std::decay_t<const Args>...>;
+						record->format = fmt::string_view(out, format.size());
+						deferred = true;
+					}
+				}
+				if (!deferred) {
+					std::string* text = format(format_str, args...);
+					std::memcpy(record->payload, &text, sizeof(text));
+					record->decode = &decodeFormatted;
+				}
+				commit(record);
+
+				if constexpr (level == Level::Error) {
+					flush();
+				}
+			}
+		}
 	}
 
 
 	template <typename S, typename... Args>
 	void debug(const S &format_str, Args&&... args) {
-		_log("DEBUG", ansi::green, format_str, args...);
+		detail::log<Level::Debug>(format_str, args...);
 	}
 
 	template <typename S, typename... Args>
 	void info(const S &format_str, Args&&... args) {
-		_log("INFO", ansi::white, format_str, args...);
+		detail::log<Level::Info>(format_str, args...);
 	}
 
 	template <typename S, typename... Args>
 	void warning(const S &format_str, Args&&... args) {
-		_log("WARN", ansi::yellow, format_str, args...);
+		detail::log<Level::Warn>(format_str, args...);
 	}
 	template <typename S, typename... Args>
 	void warn(const S &format_str, Args&&... args) {
-		_log("WARN", ansi::yellow, format_str, args...);
+		detail::log<Level::Warn>(format_str, args...);
 	}
 
 	template <typename S, typename... Args>
 	void error(const S &format_str, Args&&... args) {
-		_log("ERROR", ansi::red, format_str, args...);
+		detail::log<Level::Error>(format_str, args...);
 	}
 
 
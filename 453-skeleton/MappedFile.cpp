@@ -0,0 +1,138 @@
+#include "MappedFile.h"
+
+#include "Log.h"
+
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+MappedFile::~MappedFile() {
+	close();
+}
+
+
+MappedFile::MappedFile(MappedFile&& other) noexcept {
+	*this = std::move(other);
+}
+
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+	if (this != &other) {
+		close();
+		std::swap(bytes, other.bytes);
+		std::swap(length, other.length);
+		std::swap(memory, other.memory);
+#ifdef _WIN32
+		std::swap(mapping, other.mapping);
+#endif
+	}
+	return *this;
+}
+
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::string& path) {
+	close();
+
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		Log::error("MAPPED_FILE could not open {}", path);
+		return false;
+	}
+
+	LARGE_INTEGER fileSize{};
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+		Log::error("MAPPED_FILE {} is empty", path);
+		CloseHandle(file);
+		return false;
+	}
+
+	// the mapping object keeps the file open, the file handle isn't needed anymore
+	mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	CloseHandle(file);
+	if (mapping == nullptr) {
+		Log::error("MAPPED_FILE could not map {}", path);
+		return false;
+	}
+
+	bytes = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	if (bytes == nullptr) {
+		Log::error("MAPPED_FILE could not map {}", path);
+		CloseHandle(mapping);
+		mapping = nullptr;
+		return false;
+	}
+	length = size_t(fileSize.QuadPart);
+	memory.set(MemoryCategory::MappedFiles, path, length);
+	return true;
+}
+
+
+void MappedFile::close() {
+	if (bytes != nullptr) {
+		UnmapViewOfFile(bytes);
+		CloseHandle(mapping);
+	}
+	bytes = nullptr;
+	length = 0;
+	memory.reset();
+	mapping = nullptr;
+}
+
+#else
+
+bool MappedFile::open(const std::string& path) {
+	close();
+
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		Log::error("MAPPED_FILE could not open {}", path);
+		return false;
+	}
+
+	struct stat info {};
+	if (fstat(fd, &info) != 0 || info.st_size == 0) {
+		Log::error("MAPPED_FILE {} is empty", path);
+		::close(fd);
+		return false;
+	}
+
+	// the mapping stays valid after the descriptor is closed
+	void* address = mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (address == MAP_FAILED) {
+		Log::error("MAPPED_FILE could not map {}", path);
+		return false;
+	}
+
+	// everything in the file is about to be read front to back
+	madvise(address, size_t(info.st_size), MADV_WILLNEED);
+
+	bytes = static_cast<const uint8_t*>(address);
+	length = size_t(info.st_size);
+	memory.set(MemoryCategory::MappedFiles, path, length);
+	return true;
+}
+
+
+void MappedFile::close() {
+	if (bytes != nullptr) {
+		munmap(const_cast<uint8_t*>(bytes), length);
+	}
+	bytes = nullptr;
+	length = 0;
+	memory.reset();
+}
+
+#endif
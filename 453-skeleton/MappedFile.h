@@ -0,0 +1,47 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// A read-only memory mapped file.
+//
+// The pages are faulted in by the OS as they are touched instead of being
+// copied into a buffer up front, so data can be handed straight from the
+// mapping to OpenGL.
+//------------------------------------------------------------------------------
+
+#include "MemoryAccounting.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+
+class MappedFile {
+
+public:
+	MappedFile() = default;
+	~MappedFile();
+
+	// Owns the mapping, so like the GL handles it can be moved but not copied
+	MappedFile(const MappedFile&) = delete;
+	MappedFile operator=(const MappedFile&) = delete;
+	MappedFile(MappedFile&& other) noexcept;
+	MappedFile& operator=(MappedFile&& other) noexcept;
+
+	// Public interface
+	// Maps the whole file, replacing any previous mapping. Logs and returns
+	// false on failure.
+	bool open(const std::string& path);
+	void close();
+
+	bool isOpen() const { return bytes != nullptr; }
+	const uint8_t* data() const { return bytes; }
+	size_t size() const { return length; }
+
+private:
+	const uint8_t* bytes = nullptr;
+	size_t length = 0;
+	MemoryRecord memory;
+#ifdef _WIN32
+	void* mapping = nullptr; // HANDLE of the file mapping object
+#endif
+};
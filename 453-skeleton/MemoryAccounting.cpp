@@ -0,0 +1,248 @@
+#include "MemoryAccounting.h"
+
+#include "Log.h"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <utility>
+
+namespace {
+	struct TagKey {
+		MemoryCategory category;
+		std::string_view name;
+	};
+
+	struct TagLess {
+		bool operator()(const TagKey& a, const TagKey& b) const {
+			return a.category != b.category ? a.category < b.category : a.name < b.name;
+		}
+	};
+
+	struct TagEntry {
+		MemoryCategory category;
+		std::string name;
+		MemoryUsage usage;
+	};
+
+	// Lookups take views of the caller's name; the map's own keys view the
+	// names in tags, which a deque never moves
+	struct Registry {
+		std::mutex mutex;
+		std::deque<TagEntry> tags;
+		std::map<TagKey, MemoryAccounting::TagId, TagLess> ids;
+		std::array<MemoryUsage, size_t(MemoryCategory::Count)> categories;
+	};
+
+	// Never destroyed, so records released during static destruction still
+	// find it
+	Registry& registry() {
+		static Registry* instance = new Registry();
+		return *instance;
+	}
+
+	void grow(MemoryUsage& usage, uint64_t bytes) {
+		usage.live += bytes;
+		usage.peak = std::max(usage.peak, usage.live);
+		usage.allocations++;
+	}
+
+	void shrink(MemoryUsage& usage, uint64_t bytes) {
+		usage.live -= std::min(usage.live, bytes);
+		usage.allocations -= std::min<uint64_t>(usage.allocations, 1);
+	}
+
+	std::string escape(std::string_view text) {
+		std::string escaped;
+		for (char c : text) {
+			if (c == '"' || c == '\\') {
+				escaped.push_back('\\');
+				escaped.push_back(c);
+			}
+			else if (static_cast<unsigned char>(c) < 0x20) {
+				// control characters aren't allowed raw in JSON strings
+				escaped += fmt::format("\\u{:04x}", static_cast<unsigned char>(c));
+			}
+			else {
+				escaped.push_back(c);
+			}
+		}
+		return escaped;
+	}
+
+	void appendUsage(std::string& out, const MemoryUsage& usage) {
+		out += fmt::format("\"live\":{},\"peak\":{},\"allocations\":{}", usage.live, usage.peak, usage.allocations);
+	}
+}
+
+
+const char* getCategoryName(MemoryCategory category) {
+	switch (category) {
+	case MemoryCategory::Geometry: return "geometry";
+	case MemoryCategory::Textures: return "textures";
+	case MemoryCategory::VirtualTextures: return "virtual textures";
+	case MemoryCategory::RenderTargets: return "render targets";
+	case MemoryCategory::Programs: return "programs";
+	case MemoryCategory::TransferBuffers: return "transfer buffers";
+	case MemoryCategory::Bodies: return "bodies";
+	case MemoryCategory::PickingTree: return "picking tree";
+	case MemoryCategory::Arenas: return "arenas";
+	case MemoryCategory::MappedFiles: return "mapped files";
+	case MemoryCategory::Count: break;
+	}
+	return "unknown";
+}
+
+
+MemoryKind getCategoryKind(MemoryCategory category) {
+	if (category >= MemoryCategory::MappedFiles) {
+		return MemoryKind::Mapped;
+	}
+	return category >= MemoryCategory::Bodies ? MemoryKind::Heap : MemoryKind::Video;
+}
+
+
+const char* getKindName(MemoryKind kind) {
+	switch (kind) {
+	case MemoryKind::Video: return "video";
+	case MemoryKind::Heap: return "heap";
+	case MemoryKind::Mapped: return "mapped";
+	}
+	return "unknown";
+}
+
+
+MemoryUsage MemoryReport::getTotal(MemoryKind kind) const {
+	// per-category peaks were reached at different times, so their sum is an
+	// upper bound on the kind's peak
+	MemoryUsage total;
+	for (size_t i = 0; i < categories.size(); i++) {
+		if (getCategoryKind(MemoryCategory(i)) == kind) {
+			total.live += categories[i].live;
+			total.peak += categories[i].peak;
+			total.allocations += categories[i].allocations;
+		}
+	}
+	return total;
+}
+
+
+MemoryAccounting::TagId MemoryAccounting::getTag(MemoryCategory category, std::string_view name) {
+	Registry& r = registry();
+	std::lock_guard<std::mutex> lock(r.mutex);
+	auto found = r.ids.find(TagKey{ category, name });
+	if (found != r.ids.end()) {
+		return found->second;
+	}
+	TagId id = TagId(r.tags.size());
+	r.tags.push_back({ category, std::string(name), MemoryUsage() });
+	r.ids.emplace(TagKey{ category, r.tags.back().name }, id);
+	return id;
+}
+
+
+void MemoryAccounting::update(TagId oldTag, uint64_t oldBytes, TagId newTag, uint64_t newBytes) {
+	Registry& r = registry();
+	std::lock_guard<std::mutex> lock(r.mutex);
+	if (oldTag != noTag) {
+		TagEntry& entry = r.tags[oldTag];
+		shrink(entry.usage, oldBytes);
+		shrink(r.categories[size_t(entry.category)], oldBytes);
+	}
+	if (newTag != noTag) {
+		TagEntry& entry = r.tags[newTag];
+		grow(entry.usage, newBytes);
+		grow(r.categories[size_t(entry.category)], newBytes);
+	}
+}
+
+
+void MemoryAccounting::snapshot(MemoryReport& report) {
+	Registry& r = registry();
+	std::lock_guard<std::mutex> lock(r.mutex);
+	report.categories = r.categories;
+	report.tags.clear();
+	for (const auto& [key, id] : r.ids) {
+		const TagEntry& entry = r.tags[id];
+		report.tags.push_back({ entry.category, entry.name, entry.usage });
+	}
+}
+
+
+std::string MemoryAccounting::toJson(const MemoryReport& report) {
+	std::string out = "{\"kinds\":{";
+	for (MemoryKind kind : { MemoryKind::Video, MemoryKind::Heap, MemoryKind::Mapped }) {
+		out += fmt::format("{}\"{}\":{{", kind == MemoryKind::Video ? "" : ",", getKindName(kind));
+		appendUsage(out, report.getTotal(kind));
+		out += "}";
+	}
+	out += "},\n\"categories\":[";
+	for (size_t i = 0; i < report.categories.size(); i++) {
+		MemoryCategory category = MemoryCategory(i);
+		out += fmt::format("{}\n{{\"name\":\"{}\",\"kind\":\"{}\",", i == 0 ? "" : ",",
+			getCategoryName(category), getKindName(getCategoryKind(category)));
+		appendUsage(out, report.categories[i]);
+		out += "}";
+	}
+	out += "],\n\"tags\":[";
+	for (size_t i = 0; i < report.tags.size(); i++) {
+		const MemoryReport::Tag& tag = report.tags[i];
+		out += fmt::format("{}\n{{\"category\":\"{}\",\"tag\":\"{}\",", i == 0 ? "" : ",",
+			getCategoryName(tag.category), escape(tag.name));
+		appendUsage(out, tag.usage);
+		out += "}";
+	}
+	out += "]}\n";
+	return out;
+}
+
+
+bool MemoryAccounting::writeJson(const std::string& path) {
+	MemoryReport report;
+	snapshot(report);
+	std::ofstream out(path, std::ios::trunc);
+	out << toJson(report);
+	if (!out) {
+		Log::error("MEMORY could not write {}", path);
+		return false;
+	}
+	Log::info("MEMORY wrote {} tags to {}", report.tags.size(), path);
+	return true;
+}
+
+
+MemoryRecord::MemoryRecord(MemoryRecord&& other) noexcept
+	: tag(std::exchange(other.tag, MemoryAccounting::noTag))
+	, bytes(std::exchange(other.bytes, 0))
+{}
+
+
+MemoryRecord& MemoryRecord::operator=(MemoryRecord&& other) noexcept {
+	std::swap(tag, other.tag);
+	std::swap(bytes, other.bytes);
+	return *this;
+}
+
+
+void MemoryRecord::set(MemoryCategory category, std::string_view name, size_t size) {
+	MemoryAccounting::TagId newTag = MemoryAccounting::getTag(category, name);
+	if (newTag == tag && uint64_t(size) == bytes) {
+		return;
+	}
+	MemoryAccounting::update(tag, bytes, newTag, size);
+	tag = newTag;
+	bytes = size;
+}
+
+
+void MemoryRecord::reset() {
+	if (tag != MemoryAccounting::noTag) {
+		MemoryAccounting::update(tag, bytes, MemoryAccounting::noTag, 0);
+		tag = MemoryAccounting::noTag;
+		bytes = 0;
+	}
+}
@@ -0,0 +1,163 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// This file contains the registry that accounts for the memory the app holds:
+// video memory behind GL objects, heap memory of the large body arrays, and
+// memory mapped files.
+//
+// Every allocation is recorded under a category and an owner tag (a texture
+// path, a shader pair, ...). The registry keeps live bytes and high-water
+// marks per category and per tag. GL handles carry a MemoryRecord that
+// their owner fills in once the object's storage is specified; heap memory
+// is recorded by containers using TrackedAllocator.
+//
+// Sizes of GL objects are what the app asked for. The driver pads, keeps
+// shadow copies and allocates internally, so the real footprint is larger.
+//------------------------------------------------------------------------------
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+enum class MemoryCategory : uint8_t {
+	// video memory
+	Geometry,
+	Textures,
+	VirtualTextures,
+	RenderTargets,
+	Programs,
+	TransferBuffers,
+	// heap
+	Bodies,
+	PickingTree,
+	Arenas,
+	// mapped files
+	MappedFiles,
+
+	Count
+};
+
+enum class MemoryKind { Video, Heap, Mapped };
+
+const char* getCategoryName(MemoryCategory category);
+MemoryKind getCategoryKind(MemoryCategory category);
+const char* getKindName(MemoryKind kind);
+
+
+struct MemoryUsage {
+	uint64_t live = 0;        // bytes
+	uint64_t peak = 0;        // bytes, highest live so far
+	uint64_t allocations = 0; // live allocations
+};
+
+
+// Copy of the registry at one point in time
+struct MemoryReport {
+	struct Tag {
+		MemoryCategory category;
+		std::string_view name; // interned, valid for the life of the program
+		MemoryUsage usage;
+	};
+
+	std::array<MemoryUsage, size_t(MemoryCategory::Count)> categories;
+	std::vector<Tag> tags; // by category, then name; tags that were freed stay listed
+
+	MemoryUsage getTotal(MemoryKind kind) const;
+};
+
+
+namespace MemoryAccounting {
+	using TagId = uint32_t;
+	constexpr TagId noTag = 0xFFFFFFFF;
+
+	// Id of the tag name under category, created on first use
+	TagId getTag(MemoryCategory category, std::string_view name);
+
+	// Moves an allocation of oldBytes under oldTag to newBytes under newTag.
+	// Either tag may be noTag, to only add or only release.
+	void update(TagId oldTag, uint64_t oldBytes, TagId newTag, uint64_t newBytes);
+
+	// Refills report, reusing its storage
+	void snapshot(MemoryReport& report);
+
+	std::string toJson(const MemoryReport& report);
+
+	// Writes a snapshot to path. Logs and returns false on failure.
+	bool writeJson(const std::string& path);
+}
+
+
+// One accounted allocation, released when the record dies. Owned by whatever
+// owns the memory, usually a GL handle.
+class MemoryRecord {
+
+public:
+	MemoryRecord() = default;
+	~MemoryRecord() { reset(); }
+
+	MemoryRecord(const MemoryRecord&) = delete;
+	MemoryRecord& operator=(const MemoryRecord&) = delete;
+
+	MemoryRecord(MemoryRecord&& other) noexcept;
+	MemoryRecord& operator=(MemoryRecord&& other) noexcept;
+
+	// Public interface
+	// Replaces what the record accounted for. Setting the same tag and size
+	// again, as buffers re-specified every frame do, changes nothing.
+	void set(MemoryCategory category, std::string_view tag, size_t bytes);
+	void reset();
+
+	size_t getBytes() const { return size_t(bytes); }
+
+private:
+	MemoryAccounting::TagId tag = MemoryAccounting::noTag;
+	uint64_t bytes = 0;
+};
+
+
+// Standard allocator that accounts what it allocates under category, for
+// containers that grow with the size of the scene
+template<class T, MemoryCategory category>
+class TrackedAllocator {
+
+public:
+	using value_type = T;
+
+	template<class U>
+	struct rebind { using other = TrackedAllocator<U, category>; };
+
+	TrackedAllocator() = default;
+	template<class U>
+	TrackedAllocator(const TrackedAllocator<U, category>&) {}
+
+	T* allocate(size_t count) {
+		T* p = std::allocator<T>().allocate(count);
+		MemoryAccounting::update(MemoryAccounting::noTag, 0, categoryTag(), count * sizeof(T));
+		return p;
+	}
+
+	void deallocate(T* p, size_t count) {
+		MemoryAccounting::update(categoryTag(), count * sizeof(T), MemoryAccounting::noTag, 0);
+		std::allocator<T>().deallocate(p, count);
+	}
+
+	template<class U>
+	bool operator==(const TrackedAllocator<U, category>&) const { return true; }
+	template<class U>
+	bool operator!=(const TrackedAllocator<U, category>&) const { return false; }
+
+private:
+	static MemoryAccounting::TagId categoryTag() {
+		static const MemoryAccounting::TagId tag = MemoryAccounting::getTag(category, "");
+		return tag;
+	}
+};
+
+
+template<class T, MemoryCategory category>
+using TrackedVector = std::vector<T, TrackedAllocator<T, category>>;
@@ -0,0 +1,77 @@
+#include "MemoryPanel.h"
+
+#include "imgui/imgui.h"
+
+namespace {
+	void bytesColumn(uint64_t bytes) {
+		if (bytes >= (uint64_t(1) << 20)) {
+			ImGui::Text("%.1f MB", double(bytes) / double(1 << 20));
+		}
+		else {
+			ImGui::Text("%.1f KB", double(bytes) / 1024.0);
+		}
+		ImGui::NextColumn();
+	}
+
+	void usageColumns(const MemoryUsage& usage) {
+		bytesColumn(usage.live);
+		bytesColumn(usage.peak);
+		ImGui::Text("%llu", (unsigned long long)usage.allocations);
+		ImGui::NextColumn();
+	}
+}
+
+
+void MemoryPanel::draw(const std::string& exportPath) {
+	MemoryAccounting::snapshot(report);
+
+	ImGui::SetNextWindowBgAlpha(0.6f);
+	ImGui::Begin("Memory", nullptr,
+		ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_NoFocusOnAppearing);
+
+	ImGui::Columns(4, "memoryCategories", false);
+	const char* headers[] = { "", "live", "peak", "count" };
+	for (const char* header : headers) {
+		ImGui::TextUnformatted(header);
+		ImGui::NextColumn();
+	}
+	ImGui::Separator();
+
+	for (MemoryKind kind : { MemoryKind::Video, MemoryKind::Heap, MemoryKind::Mapped }) {
+		ImGui::TextUnformatted(getKindName(kind));
+		ImGui::NextColumn();
+		usageColumns(report.getTotal(kind));
+
+		for (size_t i = 0; i < report.categories.size(); i++) {
+			MemoryCategory category = MemoryCategory(i);
+			if (getCategoryKind(category) != kind) {
+				continue;
+			}
+
+			// Tags of the category, folded away by default
+			bool open = ImGui::TreeNode(getCategoryName(category));
+			ImGui::NextColumn();
+			usageColumns(report.categories[i]);
+			if (!open) {
+				continue;
+			}
+			for (const MemoryReport::Tag& tag : report.tags) {
+				if (tag.category == category && !tag.name.empty()) {
+					ImGui::Indent();
+					ImGui::TextUnformatted(tag.name.data(), tag.name.data() + tag.name.size());
+					ImGui::Unindent();
+					ImGui::NextColumn();
+					usageColumns(tag.usage);
+				}
+			}
+			ImGui::TreePop();
+		}
+		ImGui::Separator();
+	}
+	ImGui::Columns(1);
+
+	if (ImGui::Button("Export JSON")) {
+		MemoryAccounting::writeJson(exportPath);
+	}
+	ImGui::End();
+}
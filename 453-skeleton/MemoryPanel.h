@@ -0,0 +1,24 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// This file contains the ImGui panel showing the memory accounting (see
+// MemoryAccounting.h): live bytes and high-water marks per category, with
+// each category's owner tags underneath.
+//------------------------------------------------------------------------------
+
+#include "MemoryAccounting.h"
+
+#include <string>
+
+
+class MemoryPanel {
+
+public:
+	// Public interface
+	// Draws the panel. Its export button writes a JSON report to exportPath.
+	void draw(const std::string& exportPath);
+
+private:
+	// reused from frame to frame
+	MemoryReport report;
+};
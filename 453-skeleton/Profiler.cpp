@@ -0,0 +1,376 @@
+#include "Profiler.h"
+
+#include "Log.h"
+
+#include "imgui/imgui.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+
+Profiler& Profiler::get() {
+	static Profiler profiler;
+	return profiler;
+}
+
+
+Profiler::Profiler()
+	: enabled(true)
+	, debugGroups(false)
+	, inFrame(false)
+	, owner(std::thread::id())
+	, origin(Clock::now())
+	, frameIndex(0)
+	, frameStart(0)
+	, cpuSamples(0)
+	, gpuSamples(0)
+	, frames(traceFrames)
+	, summarizedFrames(0)
+{
+	// Every trace slot and GPU frame gets its room up front, instead of
+	// growing while the first traceFrames frames are recorded
+	for (FrameRecord& record : frames) {
+		record.events.reserve(eventsPerFrame);
+	}
+	for (GpuFrame& gpu : gpuFrames) {
+		gpu.events.reserve(eventsPerFrame);
+		gpu.queries.reserve(2 * eventsPerFrame);
+	}
+	cpuStack.reserve(eventsPerFrame);
+	gpuStack.reserve(eventsPerFrame);
+}
+
+
+int64_t Profiler::now() const {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - origin).count();
+}
+
+
+bool Profiler::recording() const {
+	return enabled && owner.load(std::memory_order_relaxed) == std::this_thread::get_id() && inFrame;
+}
+
+
+int Profiler::scopeIndex(const char* name) {
+	// a handful of scopes, so a linear search beats hashing
+	for (size_t i = 0; i < scopes.size(); i++) {
+		if (scopes[i].name == name) {
+			return int(i);
+		}
+	}
+	Scope scope;
+	scope.name = name;
+	std::lock_guard<std::mutex> lock(summaryMutex);
+	scopes.push_back(scope);
+	return int(scopes.size() - 1);
+}
+
+
+void Profiler::setEnabled(bool enable) {
+	enabled = enable;
+	inFrame = false;
+	cpuStack.clear();
+	gpuStack.clear();
+}
+
+
+void Profiler::beginFrame() {
+	if (!enabled) {
+		return;
+	}
+	if (frameIndex == 0) {
+		owner.store(std::this_thread::get_id(), std::memory_order_relaxed);
+		debugGroups = GLEW_KHR_debug || GLEW_VERSION_4_3;
+	}
+
+	frameIndex++;
+	frameStart = now();
+	inFrame = true;
+	cpuStack.clear();
+	gpuStack.clear();
+	for (Scope& scope : scopes) {
+		scope.cpuFrame = 0.0f;
+	}
+
+	FrameRecord& record = frames[frameIndex % traceFrames];
+	record.index = frameIndex;
+	record.events.clear();
+
+	// The slot was last used gpuFramesInFlight frames ago, so its queries
+	// have almost certainly finished by now
+	GpuFrame& gpu = gpuFrames[frameIndex % gpuFramesInFlight];
+	if (gpu.pending) {
+		readBack(gpu);
+	}
+	gpu.index = frameIndex;
+	gpu.pending = false;
+	gpu.events.clear();
+	gpu.usedQueries = 0;
+	GLint64 gpuTime = 0;
+	glGetInteger64v(GL_TIMESTAMP, &gpuTime);
+	gpu.cpuOrigin = now();
+	gpu.gpuOrigin = gpuTime;
+}
+
+
+void Profiler::endFrame() {
+	if (!recording()) {
+		return;
+	}
+	inFrame = false;
+
+	int frameScope = scopeIndex("frame");
+	int64_t end = now();
+	frames[frameIndex % traceFrames].events.push_back({ frameScope, frameStart, end, false });
+	scopes[frameScope].cpuFrame = float(end - frameStart) * 1e-6f;
+
+	GpuFrame& gpu = gpuFrames[frameIndex % gpuFramesInFlight];
+	gpu.pending = gpu.usedQueries > 0;
+
+	for (Scope& scope : scopes) {
+		scope.cpu[cpuSamples % historyFrames] = scope.cpuFrame;
+	}
+	cpuSamples++;
+
+	// sorting a few hundred samples per scope is cheap, but not free
+	if (frameIndex % 30 == 0) {
+		summarize();
+	}
+}
+
+
+void Profiler::beginCpu(const char* name) {
+	if (!recording()) {
+		return;
+	}
+	std::vector<Event>& events = frames[frameIndex % traceFrames].events;
+	events.push_back({ scopeIndex(name), now(), 0, false });
+	cpuStack.push_back(int(events.size() - 1));
+}
+
+
+void Profiler::endCpu() {
+	if (!recording() || cpuStack.empty()) {
+		return;
+	}
+	Event& event = frames[frameIndex % traceFrames].events[cpuStack.back()];
+	cpuStack.pop_back();
+	event.end = now();
+	scopes[event.scope].cpuFrame += float(event.end - event.start) * 1e-6f;
+}
+
+
+int Profiler::nextQuery(GpuFrame& frame) {
+	if (frame.usedQueries == int(frame.queries.size())) {
+		frame.queries.emplace_back();
+	}
+	return frame.usedQueries++;
+}
+
+
+void Profiler::beginGpu(const char* name) {
+	if (!recording()) {
+		return;
+	}
+	// Timestamps instead of GL_TIME_ELAPSED, which can't nest
+	GpuFrame& gpu = gpuFrames[frameIndex % gpuFramesInFlight];
+	int begin = nextQuery(gpu);
+	glQueryCounter(gpu.queries[begin], GL_TIMESTAMP);
+	gpu.events.push_back({ scopeIndex(name), begin, -1 });
+	gpuStack.push_back(int(gpu.events.size() - 1));
+
+	if (debugGroups) {
+		glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, name);
+	}
+}
+
+
+void Profiler::endGpu() {
+	if (!recording() || gpuStack.empty()) {
+		return;
+	}
+	if (debugGroups) {
+		glPopDebugGroup();
+	}
+
+	GpuFrame& gpu = gpuFrames[frameIndex % gpuFramesInFlight];
+	int end = nextQuery(gpu);
+	glQueryCounter(gpu.queries[end], GL_TIMESTAMP);
+	gpu.events[gpuStack.back()].end = end;
+	gpuStack.pop_back();
+}
+
+
+void Profiler::readBack(GpuFrame& frame) {
+	frame.pending = false;
+
+	// Queries finish in order, so the last one being ready means all are.
+	// If the GPU is that far behind, drop the frame rather than wait.
+	GLint available = 0;
+	glGetQueryObjectiv(frame.queries[frame.usedQueries - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available) {
+		return;
+	}
+
+	for (Scope& scope : scopes) {
+		scope.gpuFrame = 0.0f;
+	}
+
+	FrameRecord& record = frames[frame.index % traceFrames];
+	bool traced = record.index == frame.index;
+	for (const GpuEvent& event : frame.events) {
+		if (event.end < 0) {
+			continue;
+		}
+		GLuint64 begin = 0;
+		GLuint64 end = 0;
+		glGetQueryObjectui64v(frame.queries[event.begin], GL_QUERY_RESULT, &begin);
+		glGetQueryObjectui64v(frame.queries[event.end], GL_QUERY_RESULT, &end);
+
+		Scope& scope = scopes[event.scope];
+		scope.gpuFrame += float(end - begin) * 1e-6f;
+		if (!scope.hasGpu) {
+			std::lock_guard<std::mutex> lock(summaryMutex);
+			scope.hasGpu = true;
+		}
+		if (traced) {
+			int64_t start = frame.cpuOrigin + (int64_t(begin) - frame.gpuOrigin);
+			record.events.push_back({ event.scope, start, start + int64_t(end - begin), true });
+		}
+	}
+
+	for (Scope& scope : scopes) {
+		scope.gpu[gpuSamples % historyFrames] = scope.gpuFrame;
+	}
+	gpuSamples++;
+}
+
+
+Profiler::Percentiles Profiler::percentiles(const std::array<float, historyFrames>& samples, int count) {
+	Percentiles result;
+	if (count == 0) {
+		return result;
+	}
+	sortScratch.assign(samples.begin(), samples.begin() + count);
+	std::sort(sortScratch.begin(), sortScratch.end());
+
+	// nearest rank
+	auto rank = [&](float p) {
+		int index = int(std::ceil(p / 100.0f * float(count))) - 1;
+		return sortScratch[std::clamp(index, 0, count - 1)];
+	};
+	result.p50 = rank(50.0f);
+	result.p95 = rank(95.0f);
+	result.p99 = rank(99.0f);
+	return result;
+}
+
+
+void Profiler::summarize() {
+	int cpuCount = std::min(cpuSamples, historyFrames);
+	int gpuCount = std::min(gpuSamples, historyFrames);
+	for (Scope& scope : scopes) {
+		Percentiles cpu = percentiles(scope.cpu, cpuCount);
+		Percentiles gpu = scope.hasGpu ? percentiles(scope.gpu, gpuCount) : Percentiles();
+
+		std::lock_guard<std::mutex> lock(summaryMutex);
+		scope.cpuSummary = cpu;
+		scope.gpuSummary = gpu;
+	}
+	std::lock_guard<std::mutex> lock(summaryMutex);
+	summarizedFrames = cpuCount;
+}
+
+
+void Profiler::drawOverlay() {
+	std::lock_guard<std::mutex> lock(summaryMutex);
+	ImGui::SetNextWindowBgAlpha(0.6f);
+	ImGui::Begin("Profiler", nullptr,
+		ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_NoFocusOnAppearing);
+
+	ImGui::Text("Last %d frames, ms", summarizedFrames);
+	ImGui::Columns(7, "profilerScopes", false);
+	const char* headers[] = { "scope", "cpu p50", "p95", "p99", "gpu p50", "p95", "p99" };
+	for (const char* header : headers) {
+		ImGui::TextUnformatted(header);
+		ImGui::NextColumn();
+	}
+	ImGui::Separator();
+
+	for (const Scope& scope : scopes) {
+		ImGui::TextUnformatted(scope.name);
+		ImGui::NextColumn();
+		for (float value : { scope.cpuSummary.p50, scope.cpuSummary.p95, scope.cpuSummary.p99 }) {
+			ImGui::Text("%.2f", value);
+			ImGui::NextColumn();
+		}
+		for (float value : { scope.gpuSummary.p50, scope.gpuSummary.p95, scope.gpuSummary.p99 }) {
+			if (scope.hasGpu) {
+				ImGui::Text("%.2f", value);
+			}
+			else {
+				ImGui::TextUnformatted("-");
+			}
+			ImGui::NextColumn();
+		}
+	}
+
+	ImGui::Columns(1);
+	ImGui::End();
+}
+
+
+void Profiler::printSummary() {
+	summarize();
+	for (const Scope& scope : scopes) {
+		if (scope.hasGpu) {
+			Log::info("PROFILE {:<16} cpu p50 {:.3f} p95 {:.3f} p99 {:.3f} ms, gpu p50 {:.3f} p95 {:.3f} p99 {:.3f} ms",
+				scope.name, scope.cpuSummary.p50, scope.cpuSummary.p95, scope.cpuSummary.p99,
+				scope.gpuSummary.p50, scope.gpuSummary.p95, scope.gpuSummary.p99);
+		}
+		else {
+			Log::info("PROFILE {:<16} cpu p50 {:.3f} p95 {:.3f} p99 {:.3f} ms",
+				scope.name, scope.cpuSummary.p50, scope.cpuSummary.p95, scope.cpuSummary.p99);
+		}
+	}
+}
+
+
+bool Profiler::writeTrace(const std::string& path) const {
+	std::ofstream out(path, std::ios::trunc);
+	if (!out) {
+		Log::error("PROFILER could not write trace {}", path);
+		return false;
+	}
+
+	out << "{\"traceEvents\":[\n";
+	out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n";
+	out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}";
+
+	// oldest frame first; slots that were never used have index 0
+	size_t count = 0;
+	for (uint64_t i = 1; i <= uint64_t(traceFrames); i++) {
+		const FrameRecord& record = frames[(frameIndex + i) % traceFrames];
+		if (record.index == 0) {
+			continue;
+		}
+		for (const Event& event : record.events) {
+			if (event.end < event.start) {
+				continue;
+			}
+			out << fmt::format(",\n{{\"name\":\"{}\",\"cat\":\"{}\",\"ph\":\"X\",\"pid\":1,\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f},\"args\":{{\"frame\":{}}}}}",
+				scopes[event.scope].name, event.gpu ? "gpu" : "cpu", event.gpu ? 2 : 1,
+				double(event.start) * 1e-3, double(event.end - event.start) * 1e-3, record.index);
+			count++;
+		}
+	}
+	out << "\n]}\n";
+
+	if (!out) {
+		Log::error("PROFILER could not write trace {}", path);
+		return false;
+	}
+	Log::info("PROFILER wrote {} events to {}", count, path);
+	return true;
+}
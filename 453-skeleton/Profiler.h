@@ -0,0 +1,196 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// This file contains a lightweight frame profiler.
+//
+// CPU time is measured by RAII scopes, GPU time by pairs of GL_TIMESTAMP
+// queries around the same work. Query results are read back a few frames
+// later from a ring, so measuring never waits on the GPU; a frame whose
+// results are still not ready by then is dropped instead. GPU scopes also
+// push a debug group with their name, so captures in RenderDoc/Nsight show
+// the same structure.
+//
+//	{
+//		ProfileScope scope("cull");        // CPU only
+//		...
+//	}
+//	{
+//		GpuProfileScope scope("draw");     // CPU and GPU
+//		...
+//	}
+//
+// Scope names must be string literals (they are looked up by address). Only
+// the thread that calls beginFrame() records; scopes on other threads are
+// ignored. The overlay may be drawn from any thread. Each frame keeps its raw
+// events for a trace dump in Chrome's trace_event format (open with
+// chrome://tracing or https://ui.perfetto.dev).
+//------------------------------------------------------------------------------
+
+#include "GLHandles.h"
+
+#include <GL/glew.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+class Profiler {
+
+public:
+	static constexpr int historyFrames = 240;   // frames behind the percentiles
+	static constexpr int traceFrames = 300;     // frames kept for trace dumps
+	static constexpr int gpuFramesInFlight = 4; // frames before reading queries back
+	static constexpr int eventsPerFrame = 64;   // reserved, so frames don't allocate
+
+	// The process wide profiler every scope records into
+	static Profiler& get();
+
+	Profiler(const Profiler&) = delete;
+	Profiler operator=(const Profiler&) = delete;
+
+	// Public interface
+	void beginFrame();
+	void endFrame();
+
+	void beginCpu(const char* name);
+	void endCpu();
+	void beginGpu(const char* name);
+	void endGpu();
+
+	// A disabled profiler ignores scopes and frames entirely
+	void setEnabled(bool enabled);
+	bool isEnabled() const { return enabled; }
+
+	// Small window with p50/p95/p99 per scope, for use between
+	// ImGui::NewFrame() and ImGui::Render()
+	void drawOverlay();
+
+	// Logs the same percentiles, e.g. at the end of a benchmark run
+	void printSummary();
+
+	// Writes the last traceFrames frames as Chrome trace_event JSON
+	bool writeTrace(const std::string& path) const;
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	// Event times are nanoseconds since the profiler was created. GPU events
+	// are mapped onto the same timeline through the clock pair sampled at
+	// the beginning of their frame.
+	struct Event {
+		int scope;
+		int64_t start;
+		int64_t end;
+		bool gpu;
+	};
+
+	struct FrameRecord {
+		uint64_t index = 0;
+		std::vector<Event> events;
+	};
+
+	struct GpuEvent {
+		int scope;
+		int begin; // indices into GpuFrame::queries
+		int end;
+	};
+
+	struct GpuFrame {
+		uint64_t index = 0;
+		bool pending = false;
+		int64_t cpuOrigin = 0;
+		int64_t gpuOrigin = 0;
+		std::vector<GpuEvent> events;
+		std::vector<QueryHandle> queries;
+		int usedQueries = 0;
+	};
+
+	struct Percentiles {
+		float p50 = 0.0f;
+		float p95 = 0.0f;
+		float p99 = 0.0f;
+	};
+
+	// Per-frame totals in milliseconds, in rings of historyFrames
+	struct Scope {
+		const char* name;
+		std::array<float, historyFrames> cpu{};
+		std::array<float, historyFrames> gpu{};
+		float cpuFrame = 0.0f;
+		float gpuFrame = 0.0f;
+		bool hasGpu = false;
+		Percentiles cpuSummary;
+		Percentiles gpuSummary;
+	};
+
+	Profiler();
+
+	bool enabled;
+	bool debugGroups;
+	bool inFrame;
+	std::atomic<std::thread::id> owner; // the thread recording frames
+	Clock::time_point origin;
+
+	uint64_t frameIndex;
+	int64_t frameStart;
+	int cpuSamples;
+	int gpuSamples;
+
+	std::vector<Scope> scopes;
+	std::vector<FrameRecord> frames;
+	std::array<GpuFrame, gpuFramesInFlight> gpuFrames;
+	std::vector<int> cpuStack; // open events in the current frame
+	std::vector<int> gpuStack; // open events in the current GPU frame
+
+	// reused by the percentile computation
+	std::vector<float> sortScratch;
+
+	// Guards what the overlay reads: the scope list and its summaries. The
+	// recording thread only takes it to add a scope or publish summaries.
+	std::mutex summaryMutex;
+	int summarizedFrames;
+
+	int64_t now() const;
+	bool recording() const;
+	int scopeIndex(const char* name);
+	int nextQuery(GpuFrame& frame);
+	void readBack(GpuFrame& frame);
+	void summarize();
+	Percentiles percentiles(const std::array<float, historyFrames>& samples, int count);
+};
+
+
+// Measures CPU time from construction to destruction
+class ProfileScope {
+
+public:
+	explicit ProfileScope(const char* name) { Profiler::get().beginCpu(name); }
+	~ProfileScope() { Profiler::get().endCpu(); }
+
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope operator=(const ProfileScope&) = delete;
+};
+
+
+// Measures CPU and GPU time of the commands issued in its lifetime
+class GpuProfileScope {
+
+public:
+	explicit GpuProfileScope(const char* name) {
+		Profiler::get().beginCpu(name);
+		Profiler::get().beginGpu(name);
+	}
+	~GpuProfileScope() {
+		Profiler::get().endGpu();
+		Profiler::get().endCpu();
+	}
+
+	GpuProfileScope(const GpuProfileScope&) = delete;
+	GpuProfileScope operator=(const GpuProfileScope&) = delete;
+};
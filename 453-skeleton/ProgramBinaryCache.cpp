@@ -0,0 +1,140 @@
+#include "ProgramBinaryCache.h"
+
+#include "Hash.h"
+#include "Log.h"
+
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace {
+	constexpr uint32_t magic = 0x43425053; // "SPBC"
+
+	struct FileHeader {
+		uint32_t magic;
+		uint32_t format;
+		uint32_t length;
+	};
+
+	std::string driverString() {
+		std::string result;
+		for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION }) {
+			const GLubyte* s = glGetString(name);
+			result += s ? reinterpret_cast<const char*>(s) : "";
+			result += '\n';
+		}
+		return result;
+	}
+
+	std::filesystem::path entryPath(uint64_t key) {
+		return std::filesystem::path(ProgramBinaryCache::directory) / fmt::format("{:016x}.bin", key);
+	}
+}
+
+
+std::string ProgramBinaryCache::directory = "shader_cache";
+
+
+bool ProgramBinaryCache::isSupported() {
+	static const bool supported = [] {
+		if (!GLEW_VERSION_4_1 && !GLEW_ARB_get_program_binary) {
+			return false;
+		}
+		GLint formats = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+		return formats > 0;
+	}();
+	return supported;
+}
+
+
+uint64_t ProgramBinaryCache::makeKey(const std::string& vertexSource, const std::string& fragmentSource, const ShaderDefines& defines) {
+	uint64_t key = Hash::fnv1a(vertexSource);
+	key = Hash::fnv1a(fragmentSource, key);
+	for (const std::string& define : defines) {
+		key = Hash::fnv1a(define + '\n', key);
+	}
+	static const std::string driver = driverString();
+	return Hash::fnv1a(driver, key);
+}
+
+
+bool ProgramBinaryCache::load(GLuint program, uint64_t key) {
+	if (!isSupported()) {
+		return false;
+	}
+
+	std::filesystem::path path = entryPath(key);
+	std::ifstream file(path, std::ios::binary);
+	if (!file) {
+		return false;
+	}
+
+	// The header is checked against the file before the length is trusted,
+	// so a corrupt or foreign file can't ask for gigabytes
+	std::error_code ec;
+	uintmax_t fileSize = std::filesystem::file_size(path, ec);
+	FileHeader header{};
+	file.read(reinterpret_cast<char*>(&header), sizeof(header));
+	bool valid = file && !ec && header.magic == magic && fileSize - sizeof(header) == header.length;
+	std::vector<char> binary;
+	if (valid) {
+		binary.resize(header.length);
+		file.read(binary.data(), binary.size());
+		valid = bool(file);
+	}
+	file.close();
+
+	if (valid) {
+		glProgramBinary(program, header.format, binary.data(), GLsizei(binary.size()));
+		GLint success = GL_FALSE;
+		glGetProgramiv(program, GL_LINK_STATUS, &success);
+		if (success) {
+			return true;
+		}
+	}
+
+	// Rejected (driver changed in a way the key didn't catch, or a truncated
+	// file). Drop it so the freshly linked program can replace it.
+	Log::warn("SHADER_CACHE discarding rejected binary {}", path.string());
+	std::filesystem::remove(path, ec);
+	return false;
+}
+
+
+void ProgramBinaryCache::save(GLuint program, uint64_t key) {
+	if (!isSupported()) {
+		return;
+	}
+
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0) {
+		return;
+	}
+	std::vector<char> binary(length);
+	GLenum format = 0;
+	glGetProgramBinary(program, length, nullptr, &format, binary.data());
+
+	std::error_code ec;
+	std::filesystem::create_directories(directory, ec);
+
+	// write to a temporary and rename, so a crash never leaves a half-written entry
+	std::filesystem::path path = entryPath(key);
+	std::filesystem::path temporary = path;
+	temporary += ".tmp";
+	{
+		std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+		FileHeader header{ magic, format, uint32_t(length) };
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(binary.data(), binary.size());
+		if (!file) {
+			Log::warn("SHADER_CACHE could not write {}", temporary.string());
+			return;
+		}
+	}
+	std::filesystem::rename(temporary, path, ec);
+	if (ec) {
+		Log::warn("SHADER_CACHE could not write {}: {}", path.string(), ec.message());
+	}
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// On-disk cache of linked program binaries (GL_ARB_get_program_binary).
+//
+// After a program links, its driver-specific binary is written to the cache
+// directory. Later launches hand that binary straight back to the driver with
+// glProgramBinary instead of compiling and linking GLSL again. Entries are
+// keyed by both shader sources, the define set and the driver's vendor,
+// renderer and version strings, so a driver update simply misses the cache.
+//------------------------------------------------------------------------------
+
+#include "Shader.h"
+
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <string>
+
+
+namespace ProgramBinaryCache {
+
+	// Directory the binaries are stored in, relative to the working directory
+	extern std::string directory;
+
+	bool isSupported();
+
+	uint64_t makeKey(const std::string& vertexSource, const std::string& fragmentSource, const ShaderDefines& defines);
+
+	// Tries to load the binary for key into program. Returns false (and drops
+	// the entry if the driver rejected it) when the program still needs linking.
+	bool load(GLuint program, uint64_t key);
+
+	// Stores the binary of a successfully linked program
+	void save(GLuint program, uint64_t key);
+}
@@ -0,0 +1,211 @@
+#include "RenderQueue.h"
+
+#include "GLStats.h"
+
+#include <algorithm>
+#include <array>
+#include <utility>
+
+
+uint64_t RenderQueue::makeKey(RenderPass pass, GLuint program, GLuint material, GLuint mesh, float depth) {
+	// Opaque geometry sorts front-to-back to maximize early depth rejection,
+	// blended geometry back-to-front so it composites correctly.
+	float d = std::clamp(depth, 0.0f, 1.0f);
+	if (pass == RenderPass::Transparent) {
+		d = 1.0f - d;
+	}
+	uint64_t depthBits = uint64_t(d * float((1 << 24) - 1));
+
+	// GL names are small integers in practice. Collisions after masking only
+	// cost an extra state change, execute() compares the real names.
+	return (uint64_t(pass) & 0xF) << 60
+		| (uint64_t(program) & 0x3FF) << 50
+		| (uint64_t(material) & 0x3FFF) << 36
+		| (uint64_t(mesh) & 0xFFF) << 24
+		| depthBits;
+}
+
+
+void RenderQueue::submit(uint64_t key, const DrawPacket& packet) {
+	keys.push_back(key);
+	packets.push_back(packet);
+}
+
+
+void RenderQueue::clear() {
+	keys.clear();
+	packets.clear();
+}
+
+
+void RenderQueue::reserve(size_t count) {
+	keys.reserve(count);
+	packets.reserve(count);
+	order.reserve(count);
+	scratch.reserve(count);
+}
+
+
+void RenderQueue::sort() {
+	const size_t n = keys.size();
+	order.resize(n);
+	scratch.resize(n);
+	for (size_t i = 0; i < n; i++) {
+		order[i] = uint32_t(i);
+	}
+
+	// LSD radix sort over the packet indices, one byte at a time. Bytes that
+	// are identical across all keys (very common: few passes, few programs)
+	// are skipped entirely.
+	for (int shift = 0; shift < 64; shift += 8) {
+		std::array<uint32_t, 256> counts{};
+		for (size_t i = 0; i < n; i++) {
+			counts[(keys[order[i]] >> shift) & 0xFF]++;
+		}
+		if (n == 0 || counts[(keys[order[0]] >> shift) & 0xFF] == n) {
+			continue;
+		}
+
+		uint32_t offset = 0;
+		for (uint32_t& c : counts) {
+			uint32_t count = c;
+			c = offset;
+			offset += count;
+		}
+		for (size_t i = 0; i < n; i++) {
+			uint32_t index = order[i];
+			scratch[counts[(keys[index] >> shift) & 0xFF]++] = index;
+		}
+		std::swap(order, scratch);
+	}
+}
+
+
+void RenderQueue::beginPass(RenderPass pass) {
+	switch (pass) {
+	case RenderPass::Opaque:
+		glDepthFunc(GL_LESS);
+		glDepthMask(GL_TRUE);
+		glDisable(GL_BLEND);
+		break;
+	case RenderPass::Sky:
+		// drawn after opaque geometry at the far plane, so it only shades
+		// pixels nothing else covered
+		glDepthFunc(GL_LEQUAL);
+		glDepthMask(GL_FALSE);
+		glDisable(GL_BLEND);
+		break;
+	case RenderPass::Transparent:
+	case RenderPass::Overlay:
+		glDepthFunc(GL_LEQUAL);
+		glDepthMask(GL_FALSE);
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		break;
+	}
+}
+
+
+void RenderQueue::endPasses() {
+	glDepthFunc(GL_LESS);
+	glDepthMask(GL_TRUE);
+	glDisable(GL_BLEND);
+}
+
+
+void RenderQueue::execute(const std::function<void(GLuint)>& onProgramBound) {
+	sort();
+	stats = Stats();
+
+	bool first = true;
+	uint64_t currentPass = 0;
+	GLuint currentProgram = 0;
+	GLenum currentTarget = GL_TEXTURE_2D;
+	GLuint currentTexture = 0;
+	GLuint currentSecondary = 0;
+	GLuint currentVAO = 0;
+	TransformLocations locations;
+
+	for (uint32_t index : order) {
+		const DrawPacket& packet = packets[index];
+		uint64_t pass = keys[index] >> 60;
+
+		if (first || pass != currentPass) {
+			beginPass(RenderPass(pass));
+			currentPass = pass;
+		}
+		if (first || packet.program != currentProgram) {
+			glUseProgram(packet.program);
+			GLStats::record(GLCall::ProgramBind);
+			currentProgram = packet.program;
+			locations.transformation = glGetUniformLocation(packet.program, "transformationMatrix");
+			locations.rotation = glGetUniformLocation(packet.program, "rotationMatrix");
+			locations.negRotation = glGetUniformLocation(packet.program, "negRotationMatrix");
+			locations.parameters = glGetUniformLocation(packet.program, "drawParameters");
+			if (onProgramBound) {
+				onProgramBound(packet.program);
+			}
+			stats.programChanges++;
+		}
+		if (first || packet.texture != currentTexture || packet.textureTarget != currentTarget) {
+			if (!first && packet.textureTarget != currentTarget) {
+				GLStats::bindTexture(currentTarget, 0);
+			}
+			GLStats::bindTexture(packet.textureTarget, packet.texture);
+			currentTarget = packet.textureTarget;
+			currentTexture = packet.texture;
+			stats.textureChanges++;
+		}
+		if (packet.secondaryTexture != currentSecondary) {
+			glActiveTexture(GL_TEXTURE1);
+			GLStats::bindTexture(GL_TEXTURE_2D, packet.secondaryTexture);
+			glActiveTexture(GL_TEXTURE0);
+			currentSecondary = packet.secondaryTexture;
+			stats.textureChanges++;
+		}
+		if (first || packet.vao != currentVAO) {
+			glBindVertexArray(packet.vao);
+			GLStats::record(GLCall::VertexArrayBind);
+			currentVAO = packet.vao;
+			stats.meshChanges++;
+		}
+		first = false;
+
+		if (packet.transformation != nullptr) {
+			GLStats::uniform(locations.transformation, *packet.transformation);
+		}
+		if (packet.rotation != nullptr) {
+			GLStats::uniform(locations.rotation, *packet.rotation);
+		}
+		if (packet.negRotation != nullptr) {
+			GLStats::uniform(locations.negRotation, *packet.negRotation);
+		}
+		if (packet.parameters != nullptr) {
+			GLStats::uniform(locations.parameters, *packet.parameters);
+		}
+
+		if (packet.condition != 0) {
+			// the result may still be in flight; NO_WAIT draws in that case
+			glBeginConditionalRender(packet.condition, GL_QUERY_NO_WAIT);
+			glDrawArrays(packet.mode, packet.first, packet.count);
+			glEndConditionalRender();
+			GLStats::record(GLCall::ConditionalDraw);
+			stats.conditionalDraws++;
+		}
+		else {
+			glDrawArrays(packet.mode, packet.first, packet.count);
+			GLStats::record(GLCall::Draw);
+		}
+		stats.draws++;
+	}
+
+	if (currentSecondary != 0) {
+		glActiveTexture(GL_TEXTURE1);
+		GLStats::bindTexture(GL_TEXTURE_2D, 0);
+		glActiveTexture(GL_TEXTURE0);
+	}
+	if (!first) {
+		GLStats::bindTexture(currentTarget, 0);
+		endPasses();
+	}
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// This file contains a sort-key based render queue.
+//
+// Systems submit draw packets tagged with a 64-bit key instead of issuing GL
+// calls directly. Each frame the queue radix-sorts the keys and walks the
+// packets in order, only touching GL state when it actually changes between
+// two consecutive draws.
+//
+// Key layout (most significant bits first):
+//
+//	| pass: 4 | program: 10 | material: 14 | mesh: 12 | depth: 24 |
+//
+// so draws are grouped by pass first, then by program, material (texture) and
+// mesh, and finally ordered by depth inside a group. Opaque passes sort
+// front-to-back, transparent ones back-to-front.
+//------------------------------------------------------------------------------
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+
+enum class RenderPass : uint8_t {
+	Opaque = 0,
+	Sky = 1,
+	Transparent = 2,
+	Overlay = 3
+};
+
+
+// Everything needed to issue a single draw call
+struct DrawPacket {
+	GLuint program = 0;
+	GLenum textureTarget = GL_TEXTURE_2D;
+	GLuint texture = 0;
+	GLuint vao = 0;
+	GLenum mode = GL_TRIANGLES;
+	GLint first = 0;
+	GLsizei count = 0;
+
+	// Occlusion query gating the draw through conditional rendering, or 0
+	GLuint condition = 0;
+
+	// Extra GL_TEXTURE_2D bound to texture unit 1 (e.g. a virtual texture's
+	// indirection table), or 0 if the draw doesn't sample one
+	GLuint secondaryTexture = 0;
+
+	// Per-draw model matrices. They must stay valid until execute() returns.
+	// Null pointers leave the corresponding uniform untouched.
+	const glm::mat4* transformation = nullptr;
+	const glm::mat4* rotation = nullptr;
+	const glm::mat4* negRotation = nullptr;
+
+	// Uploaded to the "drawParameters" uniform if set. Same lifetime rules.
+	const glm::vec4* parameters = nullptr;
+};
+
+
+class RenderQueue {
+
+public:
+	// Number of state changes and draws issued by the last execute()
+	struct Stats {
+		unsigned int draws = 0;
+		unsigned int conditionalDraws = 0;
+		unsigned int programChanges = 0;
+		unsigned int textureChanges = 0;
+		unsigned int meshChanges = 0;
+	};
+
+	// depth is expected in [0, 1] (e.g. view distance divided by the far plane)
+	static uint64_t makeKey(RenderPass pass, GLuint program, GLuint material, GLuint mesh, float depth);
+
+	// Public interface
+	void submit(uint64_t key, const DrawPacket& packet);
+	void clear();
+
+	// Makes room for count packets, so submitting up to that many never
+	// allocates
+	void reserve(size_t count);
+
+	// Sorts the submitted packets and issues them. onProgramBound is called
+	// each time a new program becomes current so per-program uniforms
+	// (camera, lights) can be set once instead of once per draw.
+	void execute(const std::function<void(GLuint)>& onProgramBound);
+
+	size_t size() const { return packets.size(); }
+	const Stats& getStats() const { return stats; }
+
+private:
+	struct TransformLocations {
+		GLint transformation = -1;
+		GLint rotation = -1;
+		GLint negRotation = -1;
+		GLint parameters = -1;
+	};
+
+	std::vector<uint64_t> keys;
+	std::vector<DrawPacket> packets;
+
+	// sort buffers, kept around so steady-state frames don't allocate
+	std::vector<uint32_t> order;
+	std::vector<uint32_t> scratch;
+
+	Stats stats;
+
+	void sort();
+	void beginPass(RenderPass pass);
+	void endPasses();
+};
@@ -0,0 +1,45 @@
+#include "RenderTarget.h"
+
+#include "GLStats.h"
+#include "Log.h"
+
+#include <stdexcept>
+
+
+RenderTarget::RenderTarget(int width, int height)
+	: framebuffer(), color(), depth(), width(width), height(height)
+{
+	GLStats::bindTexture(GL_TEXTURE_2D, color);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB8_ALPHA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	GLStats::bindTexture(GL_TEXTURE_2D, 0);
+
+	glBindRenderbuffer(GL_RENDERBUFFER, depth);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+	color.track(MemoryCategory::RenderTargets, "offscreen", size_t(width) * height * 4);
+	depth.track(MemoryCategory::RenderTargets, "offscreen", size_t(width) * height * 4);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, color, 0);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	if (status != GL_FRAMEBUFFER_COMPLETE) {
+		Log::error("RENDER_TARGET {}x{} framebuffer incomplete: {:#x}", width, height, status);
+		throw std::runtime_error("Failed to create render target");
+	}
+}
+
+
+void RenderTarget::bind() {
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glViewport(0, 0, width, height);
+}
+
+
+void RenderTarget::unbind() {
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// An offscreen framebuffer with an sRGB color texture and a depth buffer, for
+// rendering without a visible window.
+//------------------------------------------------------------------------------
+
+#include "GLHandles.h"
+
+#include <GL/glew.h>
+
+
+class RenderTarget {
+
+public:
+	RenderTarget(int width, int height);
+
+	// Because the members are RAII handles the defaults do the right thing.
+	// Rule of zero
+
+	// Public interface
+	// Makes this the draw and read framebuffer and sets the viewport to cover it
+	void bind();
+	void unbind();
+
+	int getWidth() const { return width; }
+	int getHeight() const { return height; }
+	GLuint getColor() const { return color; }
+
+private:
+	FramebufferHandle framebuffer;
+	TextureHandle color;
+	RenderbufferHandle depth;
+	int width;
+	int height;
+};
@@ -0,0 +1,144 @@
+#include "ResourceLoader.h"
+
+#include "GLDebug.h"
+#include "Log.h"
+
+#include <chrono>
+#include <stdexcept>
+
+
+LoadTicket::LoadTicket()
+	: fence(nullptr)
+	, jobFailed(false)
+	, done(false)
+	, signalled(false)
+{}
+
+
+LoadTicket::~LoadTicket() {
+	// sync objects are shared, so whichever context drops the ticket can delete it
+	if (fence != nullptr) {
+		glDeleteSync(fence);
+	}
+}
+
+
+bool LoadTicket::ready() {
+	if (signalled) {
+		return true;
+	}
+	if (!done.load(std::memory_order_acquire)) {
+		return false;
+	}
+
+	if (fence != nullptr) {
+		GLenum result = glClientWaitSync(fence, 0, 0);
+		if (result == GL_TIMEOUT_EXPIRED) {
+			return false;
+		}
+		if (result == GL_WAIT_FAILED) {
+			Log::warn("RESOURCE_LOADER waiting on a load fence failed");
+		}
+		glDeleteSync(fence);
+		fence = nullptr;
+	}
+	signalled = true;
+	return true;
+}
+
+
+void LoadTicket::wait() {
+	while (!ready()) {
+		if (done.load(std::memory_order_acquire) && fence != nullptr) {
+			// queued on the GPU already, so a blocking wait is cheaper than spinning
+			glClientWaitSync(fence, 0, 1000000000);
+		}
+		else {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	}
+}
+
+
+ResourceLoader::ResourceLoader(GLFWwindow* share)
+	: context(nullptr)
+	, stopping(false)
+{
+	// same context as Window's, so objects can be shared between them
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+	glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GL_TRUE);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	context = std::unique_ptr<GLFWwindow, WindowDeleter>(glfwCreateWindow(1, 1, "loader", NULL, share));
+	glfwDefaultWindowHints();
+	if (context == nullptr) {
+		Log::error("RESOURCE_LOADER failed to create a shared context");
+		throw std::runtime_error("Failed to create the resource loader context.");
+	}
+
+	thread = std::thread(&ResourceLoader::loaderLoop, this);
+}
+
+
+ResourceLoader::~ResourceLoader() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	thread.join();
+}
+
+
+std::shared_ptr<LoadTicket> ResourceLoader::submit(std::function<void()> job) {
+	auto ticket = std::make_shared<LoadTicket>();
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		jobs.push_back({ std::move(job), ticket });
+	}
+	wake.notify_one();
+	return ticket;
+}
+
+
+size_t ResourceLoader::queued() {
+	std::lock_guard<std::mutex> lock(mutex);
+	return jobs.size();
+}
+
+
+void ResourceLoader::loaderLoop() {
+	glfwMakeContextCurrent(context.get());
+	GLDebug::enable();
+
+	while (true) {
+		Job job;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [&] { return stopping || !jobs.empty(); });
+			if (stopping) {
+				// dropped here, so objects only the jobs held die with a context current
+				jobs.clear();
+				break;
+			}
+			job = std::move(jobs.front());
+			jobs.pop_front();
+		}
+
+		try {
+			job.run();
+			job.ticket->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		}
+		catch (const std::exception& e) {
+			Log::error("RESOURCE_LOADER job failed: {}", e.what());
+			job.ticket->jobFailed = true;
+		}
+		// the fence only ever signals once it reached the GPU
+		glFlush();
+		job.ticket->done.store(true, std::memory_order_release);
+	}
+
+	glfwMakeContextCurrent(nullptr);
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// This file contains a thread that creates GL objects off the render thread.
+//
+// The loader owns a hidden 1x1 window whose context shares objects with the
+// main window's. Submitted jobs run on the loader thread with that context
+// current, so buffers, textures and programs they create are visible to the
+// render thread too. After each job the loader inserts a fence
+// (glFenceSync) and flushes; the render thread checks it with a zero timeout
+// glClientWaitSync every frame and only uses the new objects once it has
+// signalled, so large uploads and links never stall the frame loop.
+//
+// The hidden window has to be created on the main thread (GLFW rule), before
+// the render thread takes over the main context.
+//------------------------------------------------------------------------------
+
+#include "Window.h"
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+
+// Completion of one job submitted to a ResourceLoader. Polled from the
+// thread that uses the job's results.
+class LoadTicket {
+
+public:
+	LoadTicket();
+	~LoadTicket();
+
+	LoadTicket(const LoadTicket&) = delete;
+	LoadTicket operator=(const LoadTicket&) = delete;
+
+	// True once the job ran and the GPU finished the commands it issued.
+	// Never blocks. Needs a GL context current.
+	bool ready();
+
+	// Blocks until ready()
+	void wait();
+
+	// The job threw; whatever it created is unusable
+	bool failed() const { return jobFailed; }
+
+private:
+	friend class ResourceLoader;
+
+	GLsync fence;               // written by the loader thread before done
+	bool jobFailed;
+	std::atomic<bool> done;     // the job ran and fenced
+	bool signalled;
+};
+
+
+class ResourceLoader {
+
+public:
+	// share is the context the loaded objects are used from. Call on the
+	// main thread.
+	explicit ResourceLoader(GLFWwindow* share);
+	~ResourceLoader();
+
+	// Owns a thread and a window
+	ResourceLoader(const ResourceLoader&) = delete;
+	ResourceLoader operator=(const ResourceLoader&) = delete;
+
+	// Runs job on the loader thread. Objects the job creates or fills may be
+	// used once the ticket is ready. Jobs run in submission order; ones still
+	// queued when the loader is destroyed are dropped, on the loader thread.
+	std::shared_ptr<LoadTicket> submit(std::function<void()> job);
+
+	// Jobs submitted and not run yet
+	size_t queued();
+
+private:
+	struct Job {
+		std::function<void()> run;
+		std::shared_ptr<LoadTicket> ticket;
+	};
+
+	std::unique_ptr<GLFWwindow, WindowDeleter> context; // hidden, shares with the main window
+	std::thread thread;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::deque<Job> jobs;
+	bool stopping;
+
+	void loaderLoop();
+};
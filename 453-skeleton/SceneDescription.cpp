@@ -0,0 +1,125 @@
+#include "SceneDescription.h"
+
+#include "Log.h"
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace {
+	constexpr float degrees = 3.14159265359f / 180.0f;
+
+	bool parseFloat(const std::string& text, float& value) {
+		char* end = nullptr;
+		value = std::strtof(text.c_str(), &end);
+		return !text.empty() && end == text.c_str() + text.size();
+	}
+
+	int findBody(const SceneDescription& scene, const std::string& name) {
+		for (size_t i = 0; i < scene.bodies.size(); i++) {
+			if (scene.bodies[i].name == name) {
+				return int(i);
+			}
+		}
+		return -1;
+	}
+
+	// Applies one key=value field (or bare flag) of a body statement
+	bool parseField(const SceneDescription& scene, const std::string& field, BodyDescription& body) {
+		if (field == "emissive") {
+			body.emissive = true;
+			return true;
+		}
+
+		size_t equals = field.find('=');
+		if (equals == std::string::npos) {
+			return false;
+		}
+		std::string key = field.substr(0, equals);
+		std::string value = field.substr(equals + 1);
+
+		if (key == "parent") {
+			body.parent = findBody(scene, value);
+			return body.parent >= 0;
+		}
+		if (key == "texture") {
+			body.texture = value;
+			return !value.empty();
+		}
+
+		float number;
+		if (!parseFloat(value, number)) {
+			return false;
+		}
+		if (key == "radius") body.radius = number;
+		else if (key == "distance") body.distance = number;
+		else if (key == "orbit") body.orbitSpeed = number;
+		else if (key == "rotation") body.rotationSpeed = number;
+		else if (key == "inclination") body.orbitalInclination = number * degrees;
+		else if (key == "tilt") body.axialTilt = number * degrees;
+		else return false;
+		return true;
+	}
+}
+
+
+bool loadSceneDescription(const std::string& path, SceneDescription& scene) {
+	scene = {};
+	std::ifstream in(path);
+	if (!in) {
+		Log::error("SCENE could not open {}", path);
+		return false;
+	}
+
+	std::string line;
+	for (int lineNumber = 1; std::getline(in, line); lineNumber++) {
+		line = line.substr(0, line.find('#'));
+		std::istringstream words(line);
+		std::string statement;
+		if (!(words >> statement)) {
+			continue; // blank or comment
+		}
+
+		if (statement == "catalog" || statement == "stars") {
+			std::string catalog;
+			if (!(words >> catalog)) {
+				Log::error("SCENE {}:{} {} needs a path", path, lineNumber, statement);
+				return false;
+			}
+			catalog = (std::filesystem::path(path).parent_path() / catalog).string();
+			if (statement == "stars") {
+				scene.stars = catalog;
+			}
+			else {
+				scene.catalogs.push_back(catalog);
+			}
+			continue;
+		}
+
+		if (statement != "body") {
+			Log::error("SCENE {}:{} unknown statement '{}'", path, lineNumber, statement);
+			return false;
+		}
+
+		BodyDescription body;
+		if (!(words >> body.name) || findBody(scene, body.name) >= 0) {
+			Log::error("SCENE {}:{} body needs a new name", path, lineNumber);
+			return false;
+		}
+		std::string field;
+		while (words >> field) {
+			if (!parseField(scene, field, body)) {
+				Log::error("SCENE {}:{} bad field '{}' for body {}", path, lineNumber, field, body.name);
+				return false;
+			}
+		}
+		scene.bodies.push_back(std::move(body));
+	}
+
+	if (scene.bodies.empty()) {
+		Log::error("SCENE {} has no bodies", path);
+		return false;
+	}
+	return true;
+}
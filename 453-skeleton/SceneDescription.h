@@ -0,0 +1,49 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// This file contains the text scene format, for systems small enough to edit
+// by hand. Larger populations go in binary catalogs (see BodyCatalog.h) that
+// the scene refers to.
+//
+// One statement per line, # starts a comment:
+//
+//	body <name> [parent=<name>] [radius=<km>] [distance=<km>] [orbit=<rad/s>]
+//	     [rotation=<rad/s>] [inclination=<deg>] [tilt=<deg>] [texture=<name>]
+//	     [emissive]
+//	catalog <path>
+//	stars <path>
+//
+// A parent has to be declared before its children. texture names a map under
+// textures/ without extension. stars replaces the sky texture with a star
+// catalog (see StarCatalog.h). Catalog paths are relative to the scene file.
+// orbit and rotation are angular speeds at animation speed 1 (see BodyMotion).
+//------------------------------------------------------------------------------
+
+#include <string>
+#include <vector>
+
+
+struct BodyDescription {
+	std::string name;
+	int parent = -1;                 // index of an earlier body, -1 for none
+	float radius = 1.0f;             // km
+	float distance = 0.0f;           // from the parent, km
+	float orbitSpeed = 0.0f;         // radians per second
+	float rotationSpeed = 0.0f;      // radians per second
+	float orbitalInclination = 0.0f; // radians
+	float axialTilt = 0.0f;          // radians
+	std::string texture;             // empty for none
+	bool emissive = false;           // gives off light instead of being lit
+};
+
+
+struct SceneDescription {
+	std::vector<BodyDescription> bodies;
+	std::vector<std::string> catalogs;
+	std::string stars; // empty draws the sky texture
+};
+
+
+// Replaces scene with the one in the file at path. Logs the offending line
+// and returns false on failure.
+bool loadSceneDescription(const std::string& path, SceneDescription& scene);
@@ -2,6 +2,7 @@
 
 #include "Log.h"
 
+#include <algorithm>
 #include <cstring>
 #include <fstream>
 #include <iostream>
@@ -10,20 +11,18 @@
 #include <vector>
 
 
-Shader::Shader(const std::string& path, GLenum type)
+Shader::Shader(const std::string& path, GLenum type, const ShaderDefines& defines)
 	: shaderID(type)
 	, type(type)
 	, path(path)
+	, defines(defines)
 {
 	if (!compile()) {
 		throw std::runtime_error("Shader did not compile");
 	}
 }
 
-bool Shader::compile() {
-
-	// read shader source
-	std::string sourceString;
+bool readShaderSource(const std::string& path, std::string& source) {
 	std::ifstream file;
 
 	// ensure ifstream objects can throw exceptions:
@@ -40,12 +39,53 @@ bool Shader::compile() {
 		file.close();
 
 		// convert stream into string
-		sourceString = sourceStream.str();
+		source = sourceStream.str();
 	}
 	catch (std::ifstream::failure &e) {
 		Log::error("SHADER reading {}:\n{}", path, strerror(errno));
 		return false;
 	}
+	return true;
+}
+
+
+std::string injectDefines(const std::string& source, const ShaderDefines& defines) {
+	if (defines.empty()) {
+		return source;
+	}
+
+	// #version has to stay the first statement, so the defines go right after it
+	size_t insertAt = 0;
+	size_t version = source.find("#version");
+	if (version != std::string::npos) {
+		size_t lineEnd = source.find('\n', version);
+		insertAt = (lineEnd == std::string::npos) ? source.size() : lineEnd + 1;
+	}
+
+	std::string block;
+	for (const std::string& define : defines) {
+		block += "#define " + define + "\n";
+	}
+	// keep compiler error line numbers pointing at the file on disk
+	size_t versionLines = size_t(std::count(source.begin(), source.begin() + insertAt, '\n'));
+	block += "#line " + std::to_string(versionLines + 1) + "\n";
+
+	std::string result = source.substr(0, insertAt);
+	if (!result.empty() && result.back() != '\n') {
+		result += '\n';
+	}
+	return result + block + source.substr(insertAt);
+}
+
+
+bool Shader::compile() {
+
+	// read shader source
+	std::string sourceString;
+	if (!readShaderSource(path, sourceString)) {
+		return false;
+	}
+	sourceString = injectDefines(sourceString, defines);
 	const GLchar* sourceCode = sourceString.c_str();
 
 
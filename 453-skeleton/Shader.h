@@ -4,14 +4,26 @@
 
 #include <GL/glew.h>
 
+#include <cstdint>
+#include <set>
 #include <string>
 
 class ShaderProgram;
 
+// Preprocessor symbols (UNLIT, EMISSIVE, INSTANCED, IMPOSTOR, ...) selecting a
+// variant of a shader source. Kept sorted so equal sets compare equal.
+using ShaderDefines = std::set<std::string>;
+
+// Reads a whole shader file into source. Logs and returns false on failure.
+bool readShaderSource(const std::string& path, std::string& source);
+
+// Returns source with one #define per entry inserted right after its #version line
+std::string injectDefines(const std::string& source, const ShaderDefines& defines);
+
 class Shader {
 
 public:
-	Shader(const std::string& path, GLenum type);
+	Shader(const std::string& path, GLenum type, const ShaderDefines& defines = {});
 
 	// Because we're using the ShaderHandle to do RAII for the shader for us
 	// and our other types are trivial or provide their own RAII
@@ -23,14 +35,17 @@ public:
 	// Public interface
 	std::string getPath() const { return path; }
 	GLenum getType() const { return type; }
+	const ShaderDefines& getDefines() const { return defines; }
 
 	void friend attach(ShaderProgram& sp, Shader& s);
+	void friend detach(ShaderProgram& sp, Shader& s);
 
 private:
 	ShaderHandle shaderID;
 	GLenum type;
 
 	std::string path;
+	ShaderDefines defines;
 
 	bool compile();
 };
@@ -0,0 +1,107 @@
+#include "ShaderCache.h"
+
+#include "Hash.h"
+#include "Log.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
+
+namespace {
+	bool samePath(const std::string& a, const std::string& b) {
+		return std::filesystem::path(a).lexically_normal() == std::filesystem::path(b).lexically_normal();
+	}
+}
+
+
+bool ShaderCache::hashSources(const std::string& vertexPath, const std::string& fragmentPath, uint64_t& hash) {
+	std::string vertexSource, fragmentSource;
+	if (!readShaderSource(vertexPath, vertexSource) || !readShaderSource(fragmentPath, fragmentSource)) {
+		return false;
+	}
+
+	// hash the sources rather than the paths so two paths with the same
+	// contents share a program
+	hash = Hash::fnv1a(fragmentSource, Hash::fnv1a(vertexSource));
+	return true;
+}
+
+
+ShaderProgram& ShaderCache::get(const std::string& vertexPath, const std::string& fragmentPath, const ShaderDefines& defines) {
+	uint64_t hash;
+	if (!hashSources(vertexPath, fragmentPath, hash)) {
+		throw std::runtime_error("Shader source could not be read");
+	}
+	Key key{ hash, defines };
+
+	auto it = programs.find(key);
+	if (it != programs.end()) {
+		return *it->second;
+	}
+
+	auto program = std::make_unique<ShaderProgram>(vertexPath, fragmentPath, defines);
+	ShaderProgram& result = *program;
+	programs.emplace(std::move(key), std::move(program));
+	return result;
+}
+
+
+void ShaderCache::reload(const std::string& path) {
+	for (auto& entry : programs) {
+		ShaderProgram* program = entry.second.get();
+		if (!samePath(program->getVertexPath(), path) && !samePath(program->getFragmentPath(), path)) {
+			continue;
+		}
+
+		// a newer edit supersedes a build that is still in flight
+		pending.erase(std::remove_if(pending.begin(), pending.end(), [&](const PendingBuild& p) {
+			return p.target == program;
+		}), pending.end());
+
+		// A blocking build is fine over there; failures throw and fail the ticket
+		auto loaded = std::make_shared<std::optional<ShaderProgram>>();
+		auto ticket = loader.submit([loaded, vertexPath = program->getVertexPath(),
+			fragmentPath = program->getFragmentPath(), defines = program->getDefines()]() {
+			loaded->emplace(vertexPath, fragmentPath, defines);
+			Log::info("SHADER_PROGRAM rebuilt {} + {} on the loader thread", vertexPath, fragmentPath);
+		});
+		pending.push_back({ program, std::move(loaded), std::move(ticket) });
+	}
+}
+
+
+void ShaderCache::update() {
+	for (auto it = pending.begin(); it != pending.end();) {
+		if (!it->ticket->ready()) {
+			++it;
+			continue;
+		}
+
+		if (!it->ticket->failed() && *it->loaded) {
+			ShaderProgram* target = it->target;
+			*target = std::move(**it->loaded);
+
+			// re-key the entry under the new source hash
+			auto entry = std::find_if(programs.begin(), programs.end(), [&](const auto& e) {
+				return e.second.get() == target;
+			});
+			uint64_t hash;
+			if (entry != programs.end() && hashSources(target->getVertexPath(), target->getFragmentPath(), hash)) {
+				auto node = programs.extract(entry);
+				uint64_t oldHash = node.key().sourceHash;
+				node.key().sourceHash = hash;
+				auto inserted = programs.insert(std::move(node));
+				if (!inserted.inserted) {
+					// another entry already has these sources; keep the old key
+					// rather than dropping a program someone may reference
+					inserted.node.key().sourceHash = oldHash;
+					programs.insert(std::move(inserted.node));
+				}
+			}
+		}
+		else {
+			Log::warn("SHADER_PROGRAM falling back to previous version of shaders");
+		}
+		it = pending.erase(it);
+	}
+}
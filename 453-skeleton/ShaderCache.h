@@ -0,0 +1,73 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// This file contains a cache of compiled shader program variants.
+//
+// A variant is a vertex/fragment source pair compiled with a set of
+// preprocessor defines (see ShaderDefines). Programs are keyed by a hash of
+// both sources plus the define set, so asking twice for the same variant
+// returns the same program and each variant is only compiled once.
+//
+// When a source file changes, reload() rebuilds every variant using it in the
+// background, on the ResourceLoader's context. The old program stays bound
+// and in use until update() sees the new one linked and swaps it in place, so
+// references handed out by get() never dangle. A failed build keeps the old
+// program.
+//------------------------------------------------------------------------------
+
+#include "ResourceLoader.h"
+#include "ShaderProgram.h"
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <vector>
+
+
+class ShaderCache {
+
+public:
+	// loader must outlive the cache
+	explicit ShaderCache(ResourceLoader& loader) : loader(loader) {}
+
+	// Returns the program for this variant, compiling it on first use.
+	// The reference stays valid for the lifetime of the cache.
+	// Throws std::runtime_error if the variant fails to compile or link.
+	ShaderProgram& get(const std::string& vertexPath, const std::string& fragmentPath, const ShaderDefines& defines = {});
+
+	// Starts rebuilding every cached program that uses the file at path
+	void reload(const std::string& path);
+
+	// Polls in-flight rebuilds and swaps in the ones that finished. Call once per frame.
+	void update();
+
+	size_t size() const { return programs.size(); }
+	size_t pendingBuilds() const { return pending.size(); }
+
+private:
+	struct Key {
+		uint64_t sourceHash;
+		ShaderDefines defines;
+
+		bool operator<(const Key& other) const {
+			return std::tie(sourceHash, defines) < std::tie(other.sourceHash, other.defines);
+		}
+	};
+
+	// A program being linked on the loader thread
+	struct PendingBuild {
+		ShaderProgram* target;
+		std::shared_ptr<std::optional<ShaderProgram>> loaded;
+		std::shared_ptr<LoadTicket> ticket;
+	};
+
+	ResourceLoader& loader;
+
+	std::map<Key, std::unique_ptr<ShaderProgram>> programs;
+	std::vector<PendingBuild> pending;
+
+	static bool hashSources(const std::string& vertexPath, const std::string& fragmentPath, uint64_t& hash);
+};
@@ -1,32 +1,81 @@
 #include "ShaderProgram.h"
 
+#include <algorithm>
 #include <iostream>
 #include <stdexcept>
 #include <vector>
 
 #include "Log.h"
+#include "ProgramBinaryCache.h"
 
+namespace {
+	std::string describe(const ShaderDefines& defines) {
+		std::string result;
+		for (const std::string& define : defines) {
+			result += result.empty() ? define : " " + define;
+		}
+		return result;
+	}
+}
 
-ShaderProgram::ShaderProgram(const std::string& vertexPath, const std::string& fragmentPath)
+ShaderProgram::ShaderProgram(const std::string& vertexPath, const std::string& fragmentPath, const ShaderDefines& defines)
 	: programID()
-	, vertex(vertexPath, GL_VERTEX_SHADER)
-	, fragment(fragmentPath, GL_FRAGMENT_SHADER)
+	, vertexPath(vertexPath)
+	, fragmentPath(fragmentPath)
+	, defines(defines)
 {
+	std::string vertexSource, fragmentSource;
+	if (!readShaderSource(vertexPath, vertexSource) || !readShaderSource(fragmentPath, fragmentSource)) {
+		throw std::runtime_error("Shader did not compile");
+	}
+
+	uint64_t key = ProgramBinaryCache::makeKey(vertexSource, fragmentSource, defines);
+	if (ProgramBinaryCache::load(programID, key)) {
+		Log::info("SHADER_PROGRAM loaded {} + {} [{}] from the binary cache", vertexPath, fragmentPath, describe(defines));
+		trackMemory();
+		return;
+	}
+
+	compileAndLink();
+	ProgramBinaryCache::save(programID, key);
+	trackMemory();
+}
+
+
+void ShaderProgram::trackMemory() {
+	// The binary is the only measure of a program's size the driver exposes
+	GLint length = 0;
+	glGetProgramiv(programID, GL_PROGRAM_BINARY_LENGTH, &length);
+	programID.track(MemoryCategory::Programs, vertexPath + " + " + fragmentPath, size_t(std::max(length, 0)));
+}
+
+
+void ShaderProgram::compileAndLink() {
+	// The shader objects are only needed until the program is linked
+	Shader vertex(vertexPath, GL_VERTEX_SHADER, defines);
+	Shader fragment(fragmentPath, GL_FRAGMENT_SHADER, defines);
+
 	attach(*this, vertex);
 	attach(*this, fragment);
+	if (ProgramBinaryCache::isSupported()) {
+		glProgramParameteri(programID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
 	glLinkProgram(programID);
 
 	if (!checkAndLogLinkSuccess()) {
 		glDeleteProgram(programID);
 		throw std::runtime_error("Shaders did not link.");
 	}
+	detach(*this, vertex);
+	detach(*this, fragment);
 }
 
+
 bool ShaderProgram::recompile() {
 
 	try {
 		// Try to create a new program
-		ShaderProgram newProgram(vertex.getPath(), fragment.getPath());
+		ShaderProgram newProgram(vertexPath, fragmentPath, defines);
 		*this = std::move(newProgram);
 		return true;
 	}
@@ -42,6 +91,11 @@ void attach(ShaderProgram& sp, Shader& s) {
 }
 
 
+void detach(ShaderProgram& sp, Shader& s) {
+	glDetachShader(sp.programID, s.shaderID);
+}
+
+
 bool ShaderProgram::checkAndLogLinkSuccess() const {
 
 	GLint success;
@@ -53,11 +107,11 @@ bool ShaderProgram::checkAndLogLinkSuccess() const {
 		std::vector<char> log(logLength);
 		glGetProgramInfoLog(programID, logLength, NULL, log.data());
 
-		Log::error("SHADER_PROGRAM linking {} + {}:\n{}", vertex.getPath(), fragment.getPath(), log.data());
+		Log::error("SHADER_PROGRAM linking {} + {} [{}]:\n{}", vertexPath, fragmentPath, describe(defines), log.data());
 		return false;
 	}
 	else {
-		Log::info("SHADER_PROGRAM successfully compiled and linked {} + {}", vertex.getPath(), fragment.getPath());
+		Log::info("SHADER_PROGRAM successfully compiled and linked {} + {} [{}]", vertexPath, fragmentPath, describe(defines));
 		return true;
 	}
 }
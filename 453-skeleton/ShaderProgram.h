@@ -3,6 +3,7 @@
 #include "Shader.h"
 
 #include "GLHandles.h"
+#include "GLStats.h"
 
 #include <GL/glew.h>
 
@@ -12,7 +13,9 @@
 class ShaderProgram {
 
 public:
-	ShaderProgram(const std::string& vertexPath, const std::string& fragmentPath);
+	// Loads the linked program from the ProgramBinaryCache when possible and
+	// only compiles the GLSL sources on a cache miss
+	ShaderProgram(const std::string& vertexPath, const std::string& fragmentPath, const ShaderDefines& defines = {});
 
 	// Because we're using the ShaderProgramHandle to do RAII for the shader for us
 	// and our other types are trivial or provide their own RAII
@@ -23,9 +26,16 @@ public:
 
 	// Public interface
 	bool recompile();
-	void use() const { glUseProgram(programID); }
+	void use() const {
+		glUseProgram(programID);
+		GLStats::record(GLCall::ProgramBind);
+	}
+	std::string getVertexPath() const { return vertexPath; }
+	std::string getFragmentPath() const { return fragmentPath; }
+	const ShaderDefines& getDefines() const { return defines; }
 
 	void friend attach(ShaderProgram& sp, Shader& s);
+	void friend detach(ShaderProgram& sp, Shader& s);
 
 	operator GLuint() const {
 		return programID;
@@ -34,8 +44,11 @@ public:
 private:
 	ShaderProgramHandle programID;
 
-	Shader vertex;
-	Shader fragment;
+	std::string vertexPath;
+	std::string fragmentPath;
+	ShaderDefines defines;
 
+	void compileAndLink();
 	bool checkAndLogLinkSuccess() const;
+	void trackMemory();
 };
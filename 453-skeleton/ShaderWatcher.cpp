@@ -0,0 +1,99 @@
+#include "ShaderWatcher.h"
+
+#include "Log.h"
+
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+
+ShaderWatcher::ShaderWatcher(const std::string& directory)
+	: directory(directory)
+	, inotifyFD(-1)
+	, watchFD(-1)
+	, lastScan(0.0)
+{
+#ifdef __linux__
+	inotifyFD = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (inotifyFD >= 0) {
+		// editors either rewrite the file or write a new one and rename it over
+		watchFD = inotify_add_watch(inotifyFD, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+	}
+	if (watchFD >= 0) {
+		Log::info("SHADER_WATCHER watching {} with inotify", directory);
+		return;
+	}
+	Log::warn("SHADER_WATCHER inotify unavailable for {}, polling instead", directory);
+#endif
+	scan(nullptr);
+}
+
+
+ShaderWatcher::~ShaderWatcher() {
+#ifdef __linux__
+	if (inotifyFD >= 0) {
+		close(inotifyFD);
+	}
+#endif
+}
+
+
+std::vector<std::string> ShaderWatcher::poll() {
+	std::vector<std::string> changed;
+
+#ifdef __linux__
+	if (watchFD >= 0) {
+		alignas(inotify_event) char buffer[4096];
+		ssize_t length;
+		while ((length = read(inotifyFD, buffer, sizeof(buffer))) > 0) {
+			for (char* p = buffer; p < buffer + length;) {
+				inotify_event* event = reinterpret_cast<inotify_event*>(p);
+				if (event->len > 0) {
+					std::string path = (std::filesystem::path(directory) / event->name).generic_string();
+					if (std::find(changed.begin(), changed.end(), path) == changed.end()) {
+						changed.push_back(path);
+					}
+				}
+				p += sizeof(inotify_event) + event->len;
+			}
+		}
+		return changed;
+	}
+#endif
+
+	double now = glfwGetTime();
+	if (now - lastScan >= 0.5) {
+		lastScan = now;
+		scan(&changed);
+	}
+	return changed;
+}
+
+
+void ShaderWatcher::scan(std::vector<std::string>* changed) {
+	std::error_code ec;
+	for (const auto& entry : std::filesystem::directory_iterator(directory, ec)) {
+		if (!entry.is_regular_file(ec)) {
+			continue;
+		}
+		std::string path = (std::filesystem::path(directory) / entry.path().filename()).generic_string();
+		std::filesystem::file_time_type time = entry.last_write_time(ec);
+
+		auto it = writeTimes.find(path);
+		if (it == writeTimes.end()) {
+			writeTimes.emplace(path, time);
+		}
+		else if (it->second != time) {
+			it->second = time;
+			if (changed != nullptr) {
+				changed->push_back(path);
+			}
+		}
+	}
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// This file contains a watcher that reports files changed in a directory.
+//
+// On Linux it uses inotify, so poll() is a single non-blocking read. Elsewhere
+// it falls back to comparing modification times, at most twice per second.
+//------------------------------------------------------------------------------
+
+#include <filesystem>
+#include <map>
+#include <string>
+#include <vector>
+
+
+class ShaderWatcher {
+
+public:
+	ShaderWatcher(const std::string& directory);
+	~ShaderWatcher();
+
+	// Owns an OS handle
+	ShaderWatcher(const ShaderWatcher&) = delete;
+	ShaderWatcher operator=(const ShaderWatcher&) = delete;
+
+	// Public interface
+
+	// Paths (directory/name) of files written since the last call. Never blocks.
+	std::vector<std::string> poll();
+
+	std::string getDirectory() const { return directory; }
+
+private:
+	std::string directory;
+
+	int inotifyFD;
+	int watchFD;
+
+	// modification time fallback
+	std::map<std::string, std::filesystem::file_time_type> writeTimes;
+	double lastScan;
+
+	void scan(std::vector<std::string>* changed);
+};
@@ -0,0 +1,127 @@
+#include "Skybox.h"
+
+#include "GLStats.h"
+#include "Image.h"
+#include "Log.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+	constexpr float PI = 3.14159265359f;
+
+	// Direction through texel (s, t) of a cube face, both in [-1, 1],
+	// following the face orientation conventions of the GL spec
+	glm::vec3 faceDirection(int face, float s, float t) {
+		switch (face) {
+		case 0: return glm::vec3(1.0f, -t, -s);  // +X
+		case 1: return glm::vec3(-1.0f, -t, s);  // -X
+		case 2: return glm::vec3(s, 1.0f, t);    // +Y
+		case 3: return glm::vec3(s, -1.0f, -t);  // -Y
+		case 4: return glm::vec3(s, -t, 1.0f);   // +Z
+		default: return glm::vec3(-s, -t, -1.0f); // -Z
+		}
+	}
+}
+
+
+Skybox::Skybox(ShaderCache& shaders, const std::string& equirectPath, int faceSize)
+	: cubemapID()
+	, emptyVAO()
+	, program(shaders.get("shaders/sky.vert", "shaders/sky.frag"))
+	, path(equirectPath)
+	, faceSize(faceSize)
+{
+	loadEquirect();
+}
+
+
+void Skybox::loadEquirect() {
+	Image image;
+	if (!loadImage(path, image, true, false)) {
+		throw std::runtime_error("Failed to read sky texture data from file!");
+	}
+	const int width = image.getWidth();
+	const int height = image.getHeight();
+	const uint8_t* data = image.levels[0].data.data();
+	if (faceSize <= 0) {
+		faceSize = std::max(1, width / 4);
+	}
+
+	// Bilinear lookup into the equirectangular image, wrapping horizontally
+	auto sample = [&](float x, float y, unsigned char* out) {
+		x = x - 0.5f;
+		y = std::clamp(y - 0.5f, 0.0f, float(height - 1));
+		int x0 = int(std::floor(x));
+		int y0 = int(y);
+		float fx = x - float(x0);
+		float fy = y - float(y0);
+		int x1 = x0 + 1;
+		int y1 = std::min(y0 + 1, height - 1);
+		x0 = ((x0 % width) + width) % width;
+		x1 = ((x1 % width) + width) % width;
+
+		for (int c = 0; c < 3; c++) {
+			float top = data[(y0 * width + x0) * 4 + c] * (1.0f - fx) + data[(y0 * width + x1) * 4 + c] * fx;
+			float bottom = data[(y1 * width + x0) * 4 + c] * (1.0f - fx) + data[(y1 * width + x1) * 4 + c] * fx;
+			out[c] = (unsigned char)(top * (1.0f - fy) + bottom * fy + 0.5f);
+		}
+	};
+
+	GLStats::bindTexture(GL_TEXTURE_CUBE_MAP, cubemapID);
+
+	// rows of tightly packed RGB aren't 4-byte aligned for every face size
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	std::vector<unsigned char> face(size_t(faceSize) * faceSize * 3);
+	for (int f = 0; f < 6; f++) {
+		for (int y = 0; y < faceSize; y++) {
+			for (int x = 0; x < faceSize; x++) {
+				float s = 2.0f * (x + 0.5f) / faceSize - 1.0f;
+				float t = 2.0f * (y + 0.5f) / faceSize - 1.0f;
+				glm::vec3 d = glm::normalize(faceDirection(f, s, t));
+
+				// Same parameterization the old background sphere used: poles on
+				// z, flipped half a turn around x by its initial orientation
+				glm::vec3 p(d.x, -d.y, -d.z);
+				float phi = std::acos(std::clamp(p.z, -1.0f, 1.0f));
+				float theta = std::atan2(p.y, p.x);
+				if (theta < 0.0f) {
+					theta += 2.0f * PI;
+				}
+				float u = theta / (2.0f * PI);
+				float v = 1.0f - phi / PI; // image rows run top to bottom
+
+				sample(u * width, v * height, &face[(size_t(y) * faceSize + x) * 3]);
+			}
+		}
+		glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + f, 0, GL_SRGB8, faceSize, faceSize, 0, GL_RGB, GL_UNSIGNED_BYTE, face.data());
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);	//Return to default alignment
+
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+	cubemapID.track(MemoryCategory::Textures, path, size_t(6) * faceSize * faceSize * 3);
+	glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+
+	GLStats::bindTexture(GL_TEXTURE_CUBE_MAP, 0);
+	Log::info("SKYBOX converted {} ({}x{}) to {}x{} cube map", path, width, height, faceSize, faceSize);
+}
+
+
+void Skybox::submit(RenderQueue& queue) const {
+	DrawPacket packet;
+	packet.program = program;
+	packet.textureTarget = GL_TEXTURE_CUBE_MAP;
+	packet.texture = cubemapID;
+	packet.vao = emptyVAO;
+	packet.count = 3;
+
+	queue.submit(RenderQueue::makeKey(RenderPass::Sky, packet.program, packet.texture, packet.vao, 1.0f), packet);
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// This file contains a cube-mapped sky.
+//
+// The equirectangular source image is resampled into a cube map once at load
+// time. The sky is then drawn as a single full-screen triangle sitting on the
+// far plane, after all opaque geometry, so it only costs one texture fetch for
+// the pixels nothing else covered.
+//------------------------------------------------------------------------------
+
+#include "GLHandles.h"
+#include "RenderQueue.h"
+#include "ShaderCache.h"
+#include "ShaderProgram.h"
+#include "VertexArray.h"
+
+#include <GL/glew.h>
+
+#include <string>
+
+
+class Skybox {
+
+public:
+	// faceSize of 0 picks a quarter of the source width, which keeps roughly
+	// the same texel density as the equirectangular image
+	Skybox(ShaderCache& shaders, const std::string& equirectPath, int faceSize = 0);
+
+	// Public interface
+	void submit(RenderQueue& queue) const;
+
+	std::string getPath() const { return path; }
+	int getFaceSize() const { return faceSize; }
+
+private:
+	TextureHandle cubemapID;
+	VertexArray emptyVAO; // the full-screen triangle is generated from gl_VertexID
+	ShaderProgram& program;
+
+	std::string path;
+	int faceSize;
+
+	void loadEquirect();
+};
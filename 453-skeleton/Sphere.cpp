@@ -0,0 +1,53 @@
+#include "Sphere.h"
+
+#include <glm/gtc/constants.hpp>
+
+#include <cmath>
+
+
+namespace {
+	/* sphere parametric representation:
+	Q(u,v) = [rsin(u)cos(v), rsin(u)sin(v), rcos(u)] , 0 <= u <= PI, 0 <= v <= 2PI
+	u = phi, v = theta
+	*/
+	glm::vec3 vertexCoord(float radius, float phi, float theta) {
+		return radius * glm::vec3(std::sin(phi) * std::cos(theta), std::sin(phi) * std::sin(theta), std::cos(phi));
+	}
+
+	glm::vec2 textureCoord(float phi, float theta) {
+		return glm::vec2(theta / (2 * glm::pi<float>()), phi / glm::pi<float>());
+	}
+}
+
+
+void generateSphere(float radius, float step, std::vector<glm::vec3>& verts, std::vector<glm::vec2>& texCoords) {
+	const float pi = glm::pi<float>();
+	verts.clear();
+	texCoords.clear();
+
+	auto point = [&](float phi, float theta) {
+		verts.push_back(vertexCoord(radius, phi, theta));
+		texCoords.push_back(textureCoord(phi, theta));
+	};
+
+	for (float u = 0.0f; u <= pi; u += step) { // u
+		for (float v = 0.0f; v <= 2 * pi; v += step) { // v
+			// triangle #1: |\ (u, v), (u + 1, v), (u, v + 1)
+			point(u, v);
+			point(u + step, v);
+			point(u, v + step);
+
+			// triangle #2: \| (u + 1, v), (u + 1, v + 1), (u, v + 1)
+			point(u + step, v);
+			point(u + step, v + step);
+			point(u, v + step);
+		}
+	}
+}
+
+
+void sphereNormals(const glm::vec3* verts, size_t count, glm::vec3 center, glm::vec3* normals) {
+	for (size_t i = 0; i < count; i++) {
+		normals[i] = glm::normalize(verts[i] - center);
+	}
+}
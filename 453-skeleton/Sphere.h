@@ -0,0 +1,28 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// This file contains the CPU side sphere tessellation used for every body.
+// Nothing in here touches OpenGL.
+//------------------------------------------------------------------------------
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+
+// Replaces verts and texCoords with a UV sphere of the given radius, as a
+// plain triangle list. step is the angle between neighbouring rings and
+// segments in radians; halving it quadruples the triangle count.
+void generateSphere(float radius, float step, std::vector<glm::vec3>& verts, std::vector<glm::vec2>& texCoords);
+
+// Writes the direction from center to each of the count verts to normals
+void sphereNormals(const glm::vec3* verts, size_t count, glm::vec3 center, glm::vec3* normals);
+
+// Replaces normals with the direction from center to every vertex. Sizing
+// normals reuses its capacity, so calling this every frame doesn't allocate.
+template<class A, class B>
+void sphereNormals(const std::vector<glm::vec3, A>& verts, glm::vec3 center, std::vector<glm::vec3, B>& normals) {
+	normals.resize(verts.size());
+	sphereNormals(verts.data(), verts.size(), center, normals.data());
+}
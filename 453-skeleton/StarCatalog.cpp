@@ -0,0 +1,136 @@
+#include "StarCatalog.h"
+
+#include "Log.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace {
+	constexpr uint32_t magic = 0x31544353; // "SCT1"
+	constexpr uint64_t columnAlignment = 64;
+
+	struct FileHeader {
+		uint32_t magic;
+		uint32_t reserved;
+		uint64_t starCount;
+		uint64_t columnOffsets[3];
+	};
+
+	// floats per star in each column
+	constexpr uint64_t columnWidths[3] = { 3, 1, 1 };
+
+	uint64_t alignUp(uint64_t value) {
+		return (value + columnAlignment - 1) / columnAlignment * columnAlignment;
+	}
+}
+
+
+bool StarCatalog::open(const std::string& path) {
+	count = 0;
+	if (!file.open(path)) {
+		return false;
+	}
+
+	FileHeader header{};
+	if (file.size() < sizeof(header)) {
+		Log::error("STAR_CATALOG {} is truncated", path);
+		return false;
+	}
+	std::memcpy(&header, file.data(), sizeof(header));
+	if (header.magic != magic) {
+		Log::error("STAR_CATALOG {} is not a star catalog", path);
+		return false;
+	}
+	if (header.starCount > file.size() / 4) {
+		Log::error("STAR_CATALOG {} is truncated", path);
+		return false;
+	}
+	for (int i = 0; i < 3; i++) {
+		uint64_t offset = header.columnOffsets[i];
+		uint64_t size = header.starCount * columnWidths[i] * 4;
+		if (offset % 4 != 0 || offset > file.size() || size > file.size() - offset) {
+			Log::error("STAR_CATALOG {} column {} is corrupt", path, i);
+			return false;
+		}
+		columns[i] = reinterpret_cast<const float*>(file.data() + offset);
+	}
+
+	count = size_t(header.starCount);
+	return true;
+}
+
+
+size_t StarCatalog::countBrighterThan(float magnitude) const {
+	const float* magnitudes = getMagnitudes();
+	return size_t(std::upper_bound(magnitudes, magnitudes + count, magnitude) - magnitudes);
+}
+
+
+glm::vec3 equatorialToScene(float rightAscension, float declination) {
+	// obliquity of the ecliptic at J2000
+	const float obliquity = 0.40909280f;
+
+	float ex = std::cos(declination) * std::cos(rightAscension);
+	float ey = std::cos(declination) * std::sin(rightAscension);
+	float ez = std::sin(declination);
+
+	// rotate about the vernal equinox (x) onto the ecliptic
+	float cy = ey * std::cos(obliquity) + ez * std::sin(obliquity);
+	float cz = -ey * std::sin(obliquity) + ez * std::cos(obliquity);
+
+	// same axes as BodyCatalog: the ecliptic is the xz plane, north up
+	return glm::vec3(ex, cz, -cy);
+}
+
+
+bool writeStarCatalog(const std::string& path, std::vector<Star> stars) {
+	std::stable_sort(stars.begin(), stars.end(), [](const Star& a, const Star& b) { return a.magnitude < b.magnitude; });
+	const uint64_t n = stars.size();
+
+	FileHeader header{};
+	header.magic = magic;
+	header.starCount = n;
+	uint64_t offset = alignUp(sizeof(header));
+	for (int i = 0; i < 3; i++) {
+		header.columnOffsets[i] = offset;
+		offset = alignUp(offset + n * columnWidths[i] * 4);
+	}
+
+	std::vector<float> directions(n * 3), magnitudes(n), colors(n);
+	for (uint64_t i = 0; i < n; i++) {
+		directions[i * 3 + 0] = stars[i].direction.x;
+		directions[i * 3 + 1] = stars[i].direction.y;
+		directions[i * 3 + 2] = stars[i].direction.z;
+		magnitudes[i] = stars[i].magnitude;
+		colors[i] = stars[i].color;
+	}
+	const std::vector<float>* columns[3] = { &directions, &magnitudes, &colors };
+
+	// write to a temporary and rename, so a crash never leaves a half-written file
+	std::filesystem::path temporary = path;
+	temporary += ".tmp";
+	{
+		std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		const char padding[columnAlignment] = {};
+		for (int i = 0; i < 3; i++) {
+			out.write(padding, std::streamsize(header.columnOffsets[i] - uint64_t(out.tellp())));
+			out.write(reinterpret_cast<const char*>(columns[i]->data()), std::streamsize(columns[i]->size() * 4));
+		}
+		if (!out) {
+			Log::error("STAR_CATALOG could not write {}", temporary.string());
+			return false;
+		}
+	}
+
+	std::error_code ec;
+	std::filesystem::rename(temporary, path, ec);
+	if (ec) {
+		Log::error("STAR_CATALOG could not write {}: {}", path, ec.message());
+		return false;
+	}
+	return true;
+}
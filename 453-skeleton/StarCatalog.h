@@ -0,0 +1,69 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// A binary star catalog, converted offline from a CSV catalog (HYG, Gaia
+// subsets) by the star-catalog tool.
+//
+// Stars are sorted brightest first, so every magnitude cutoff selects a
+// prefix of the catalog: drawing down to a limit is drawing the first
+// countBrighterThan(limit) stars. Like body catalogs the file is stored
+// column by column and memory mapped, so the columns go to OpenGL as they
+// are.
+//
+// Layout (little endian):
+//
+//	FileHeader               star count and the offset of every column
+//	direction                3 floats per star, unit vector in scene space
+//	magnitude                1 float per star, apparent visual magnitude
+//	color                    1 float per star, B-V color index
+//------------------------------------------------------------------------------
+
+#include "MappedFile.h"
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+struct Star {
+	glm::vec3 direction; // unit vector in scene space
+	float magnitude;     // apparent, smaller is brighter
+	float color;         // B-V color index, 0 white, below blue, above red
+};
+
+
+class StarCatalog {
+
+public:
+	// File extension catalogs are written with
+	static constexpr const char* extension = ".scat";
+
+	// Public interface
+	// Maps and validates the file. Logs and returns false on failure.
+	bool open(const std::string& path);
+
+	size_t size() const { return count; }
+
+	// Point into the mapping, valid while the catalog is alive
+	const float* getDirections() const { return columns[0]; }
+	const float* getMagnitudes() const { return columns[1]; }
+	const float* getColors() const { return columns[2]; }
+
+	// Number of stars at or brighter than magnitude, which are the first ones
+	size_t countBrighterThan(float magnitude) const;
+
+private:
+	MappedFile file;
+	size_t count = 0;
+	const float* columns[3] = {};
+};
+
+
+// Converts equatorial coordinates (J2000, radians) to a scene direction.
+// The scene's xz plane is the ecliptic, with north along +y.
+glm::vec3 equatorialToScene(float rightAscension, float declination);
+
+// Sorts stars brightest first and writes them to a catalog at path
+bool writeStarCatalog(const std::string& path, std::vector<Star> stars);
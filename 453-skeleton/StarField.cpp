@@ -0,0 +1,49 @@
+#include "StarField.h"
+
+#include "Log.h"
+
+#include <stdexcept>
+
+
+StarField::StarField(ShaderCache& shaders, const std::string& catalogPath)
+	: vao()
+	, directions(0, 3, GL_FLOAT, "star field")
+	, magnitudes(1, 1, GL_FLOAT, "star field")
+	, colors(2, 1, GL_FLOAT, "star field")
+	, program(shaders.get("shaders/stars.vert", "shaders/stars.frag"))
+{
+	if (!catalog.open(catalogPath)) {
+		throw std::runtime_error("Failed to read star catalog!");
+	}
+
+	// the columns go from the mapping straight into the buffers
+	const GLsizeiptr n = GLsizeiptr(catalog.size());
+	vao.bind();
+	directions.uploadData(n * 3 * sizeof(float), catalog.getDirections(), GL_STATIC_DRAW);
+	magnitudes.uploadData(n * sizeof(float), catalog.getMagnitudes(), GL_STATIC_DRAW);
+	colors.uploadData(n * sizeof(float), catalog.getColors(), GL_STATIC_DRAW);
+
+	// stars.vert sizes the sprites
+	glEnable(GL_PROGRAM_POINT_SIZE);
+	Log::info("STARS loaded {} stars from {}", catalog.size(), catalogPath);
+}
+
+
+void StarField::submit(RenderQueue& queue, float magnitudeLimit) {
+	drawn = catalog.countBrighterThan(magnitudeLimit);
+	if (drawn == 0) {
+		return;
+	}
+	parameters.x = magnitudeLimit;
+
+	DrawPacket packet;
+	packet.program = program;
+	packet.vao = vao;
+	packet.mode = GL_POINTS;
+	packet.count = GLsizei(drawn);
+	packet.parameters = &parameters;
+
+	// alpha blended, so the soft edge of a sprite fades over whatever is
+	// behind it instead of cutting a square into it
+	queue.submit(RenderQueue::makeKey(RenderPass::Transparent, packet.program, packet.texture, packet.vao, 1.0f), packet);
+}
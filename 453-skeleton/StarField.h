@@ -0,0 +1,46 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// This file contains a star field drawn from a star catalog, as an
+// alternative to the Skybox that stays sharp at any zoom.
+//
+// Every star is a point sprite in one static vertex buffer, sized and dimmed
+// by its apparent magnitude. The catalog is sorted brightest first, so the
+// magnitude limit only changes how many points are drawn.
+//------------------------------------------------------------------------------
+
+#include "RenderQueue.h"
+#include "ShaderCache.h"
+#include "ShaderProgram.h"
+#include "StarCatalog.h"
+#include "VertexArray.h"
+#include "VertexBuffer.h"
+
+#include <glm/glm.hpp>
+
+#include <string>
+
+
+class StarField {
+
+public:
+	StarField(ShaderCache& shaders, const std::string& catalogPath);
+
+	// Public interface
+	// Draws the stars at or brighter than magnitudeLimit
+	void submit(RenderQueue& queue, float magnitudeLimit);
+
+	size_t size() const { return catalog.size(); }
+	size_t getDrawnCount() const { return drawn; }
+
+private:
+	StarCatalog catalog;
+	VertexArray vao;
+	VertexBuffer directions;
+	VertexBuffer magnitudes;
+	VertexBuffer colors;
+	ShaderProgram& program;
+
+	size_t drawn = 0;
+	glm::vec4 parameters = glm::vec4(0.0f); // x: magnitude limit
+};
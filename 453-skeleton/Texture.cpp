@@ -1,60 +1,204 @@
 #include "Texture.h"
-#define STB_IMAGE_IMPLEMENTATION
-#include <stb/stb_image.h>
 
-#include <iostream>
+#include "GLStats.h"
+#include "Log.h"
+#include "TextureContainer.h"
+#include "TextureStreamer.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+	bool usesMipmaps(GLint minFilter) {
+		return minFilter == GL_NEAREST_MIPMAP_NEAREST || minFilter == GL_LINEAR_MIPMAP_NEAREST
+			|| minFilter == GL_NEAREST_MIPMAP_LINEAR || minFilter == GL_LINEAR_MIPMAP_LINEAR;
+	}
+
+	PixelFormat compressedFormat(TextureCompression compression) {
+		return compression == TextureCompression::BC1 ? PixelFormat::BC1 : PixelFormat::BC7;
+	}
+}
+
+
+GLint unpackAlignment(size_t rowBytes) {
+	if (rowBytes % 8 == 0) return 8;
+	if (rowBytes % 4 == 0) return 4;
+	if (rowBytes % 2 == 0) return 2;
+	return 1;
+}
+
+
+void applyTextureSettings(GLenum target, int levels, const TextureSettings& settings) {
+	glTexParameteri(target, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, levels - 1);
+	glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(target, GL_TEXTURE_MIN_FILTER, levels > 1 ? settings.minFilter : settings.magFilter);
+	glTexParameteri(target, GL_TEXTURE_MAG_FILTER, settings.magFilter);
+
+	if (settings.anisotropy > 1.0f && GLEW_EXT_texture_filter_anisotropic) {
+		GLfloat maxAnisotropy = 1.0f;
+		glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &maxAnisotropy);
+		glTexParameterf(target, GL_TEXTURE_MAX_ANISOTROPY_EXT, std::min(settings.anisotropy, maxAnisotropy));
+	}
+}
+
+
+bool uploadTextureLevels(PixelFormat pixelFormat, bool srgb, const std::vector<ImageLevelView>& imageLevels) {
+	GLenum internalFormat, format;
+	if (!textureInternalFormat(pixelFormat, srgb, internalFormat, format)) {
+		return false;
+	}
+
+	for (size_t i = 0; i < imageLevels.size(); i++) {
+		const ImageLevelView& level = imageLevels[i];
+		if (isCompressed(pixelFormat)) {
+			glCompressedTexImage2D(GL_TEXTURE_2D, GLint(i), internalFormat, level.width, level.height, 0, GLsizei(level.size), level.data);
+		}
+		else {
+			glPixelStorei(GL_UNPACK_ALIGNMENT, unpackAlignment(size_t(level.width) * bytesPerPixel(pixelFormat)));
+			glTexImage2D(GL_TEXTURE_2D, GLint(i), internalFormat, level.width, level.height, 0, format, GL_UNSIGNED_BYTE, level.data);
+		}
+		GLStats::record(GLCall::TextureUpload, level.size);
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);	//Return to default alignment
+	return true;
+}
+
+
+bool textureInternalFormat(PixelFormat pixelFormat, bool srgb, GLenum& internalFormat, GLenum& format) {
+	switch (pixelFormat) {
+	case PixelFormat::R8:
+		internalFormat = GL_R8;
+		format = GL_RED;
+		return true;
+	case PixelFormat::RG8:
+		internalFormat = GL_RG8;
+		format = GL_RG;
+		return true;
+	case PixelFormat::RGBA8:
+		internalFormat = srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+		format = GL_RGBA;
+		return true;
+	case PixelFormat::BC1:
+		internalFormat = srgb ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+		format = internalFormat;
+		return GLEW_EXT_texture_compression_s3tc && (!srgb || GLEW_EXT_texture_sRGB);
+	case PixelFormat::BC7:
+		internalFormat = srgb ? GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM : GL_COMPRESSED_RGBA_BPTC_UNORM;
+		format = internalFormat;
+		return GLEW_VERSION_4_2 || GLEW_ARB_texture_compression_bptc;
+	}
+	return false;
+}
+
+
+TextureSettings supportedSettings(const TextureSettings& settings) {
+	if (settings.compression == TextureCompression::None) {
+		return settings;
+	}
+
+	GLenum internalFormat, format;
+	if (textureInternalFormat(compressedFormat(settings.compression), settings.srgb, internalFormat, format)) {
+		return settings;
+	}
+
+	Log::warn("TEXTURE compression not supported by this driver, uploading uncompressed");
+	TextureSettings fallback = settings;
+	fallback.compression = TextureCompression::None;
+	return fallback;
+}
+
+
+bool decodeTexture(const std::string& path, const TextureSettings& settings, Image& image) {
+	if (!loadImage(path, image, settings.srgb)) {
+		return false;
+	}
+	if (usesMipmaps(settings.minFilter)) {
+		generateMipChain(image);
+	}
+	if (settings.compression != TextureCompression::None && image.format == PixelFormat::RGBA8) {
+		image = compressImage(image, compressedFormat(settings.compression));
+	}
+	return true;
+}
+
 
 Texture::Texture(std::string path, GLint interpolation)
-	: textureID(), path(path), interpolation(interpolation)
-{
-	int numComponents;
-	stbi_set_flip_vertically_on_load(true);
-	const char* pathData = path.c_str();
-	unsigned char* data = stbi_load(pathData, &width, &height, &numComponents, 0);
-	if (stbi_failure_reason()) {
-		std::cout << stbi_failure_reason() << std::endl;
-	}
-	if (data != nullptr)
-	{
-		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);		//Set alignment to be 1
-
-		bind();
-
-		//Set number of components by format of the texture
-		GLuint format = GL_RGB;
-		switch (numComponents)
-		{
-		case 4:
-			format = GL_RGBA;
-			break;
-		case 3:
-			format = GL_RGB;
-			break;
-		case 2:
-			format = GL_RG;
-			break;
-		case 1:
-			format = GL_RED;
-			break;
-		default:
-			std::cout << "Invalid Texture Format" << std::endl;
-			break;
-		};
-		//Loads texture data into bound texture
-		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, interpolation);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, interpolation);
-
-		// Clean up
-		unbind();
-		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);	//Return to default alignment
-		stbi_image_free(data);
+	: Texture(path, TextureSettings{ interpolation, interpolation, 1.0f, false, TextureCompression::None })
+{}
 
+
+Texture::Texture(std::string path, const TextureSettings& settings)
+	: textureID(), path(path), interpolation(settings.minFilter), width(0), height(0), levels(0), sizeInBytes(0)
+	, settings(settings), finestLevel(0)
+{
+	// Containers were decoded (and mipmapped, compressed) at import time, so
+	// their levels go straight from the mapping to the driver
+	if (isTextureContainer(path)) {
+		TextureContainer container;
+		if (!container.open(path)) {
+			throw std::runtime_error("Failed to read texture data from file!");
+		}
+		upload(container.getFormat(), container.isSrgb(), container.getLevels(), settings);
+		return;
 	}
-	else {
+
+	Image image;
+	if (!decodeTexture(path, supportedSettings(settings), image)) {
 		throw std::runtime_error("Failed to read texture data from file!");
 	}
+	upload(image.format, image.srgb, levelViews(image), settings);
+}
+
+
+Texture::Texture(std::string path, const TextureSettings& settings, TextureStreamer& streamer)
+	: textureID(), path(path), interpolation(settings.minFilter), width(1), height(1), levels(1), sizeInBytes(4)
+	, settings(settings), finestLevel(0), stream(std::make_shared<TextureStreamStatus>())
+{
+	const unsigned char grey[4] = { 128, 128, 128, 255 };
+	bind();
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, grey);
+	textureID.track(MemoryCategory::Textures, path, sizeInBytes);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	unbind();
+
+	streamer.request(textureID, path, settings, stream);
+}
+
+
+void Texture::reallocate(const TextureContainer& source, int level) {
+	const std::vector<ImageLevelView>& all = source.getLevels();
+	level = std::clamp(level, 0, int(all.size()) - 1);
+
+	// A new texture object rather than respecifying levels of the old one, so
+	// the driver really lets go of the dropped levels' memory
+	TextureHandle fresh;
+	std::swap(textureID, fresh);
+	stream.reset();
+
+	upload(source.getFormat(), source.isSrgb(), std::vector<ImageLevelView>(all.begin() + level, all.end()), settings);
+	finestLevel = level;
+}
+
+
+void Texture::upload(PixelFormat pixelFormat, bool srgb, const std::vector<ImageLevelView>& imageLevels, const TextureSettings& settings) {
+	width = imageLevels[0].width;
+	height = imageLevels[0].height;
+	levels = int(imageLevels.size());
+	sizeInBytes = 0;
+	for (const ImageLevelView& level : imageLevels) {
+		sizeInBytes += level.size;
+	}
+
+	bind();
+	if (!uploadTextureLevels(pixelFormat, srgb, imageLevels)) {
+		unbind();
+		throw std::runtime_error("Texture format not supported by this driver!");
+	}
+	applyTextureSettings(GL_TEXTURE_2D, levels, settings);
+	unbind();
+	textureID.track(MemoryCategory::Textures, path, sizeInBytes);
 }
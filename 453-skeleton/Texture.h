@@ -1,16 +1,72 @@
 #pragma once
 
 #include "GLHandles.h"
+#include "GLStats.h"
+#include "Image.h"
 #include <GL/glew.h>
+#include <memory>
+#include <optional>
 #include <string>
+#include <vector>
 
 #include <glm/glm.hpp>
 
 
+enum class TextureCompression {
+	None,
+	BC1, // 4 bpp, opaque color maps
+	BC7  // 8 bpp, higher quality, alpha
+};
+
+
+struct TextureSettings {
+	GLint minFilter = GL_LINEAR_MIPMAP_LINEAR; // trilinear
+	GLint magFilter = GL_LINEAR;
+	float anisotropy = 8.0f;                   // clamped to the driver limit, 1 disables
+	bool srgb = true;                          // false for data maps (normals, masks, ...)
+	TextureCompression compression = TextureCompression::None;
+};
+
+
+class TextureContainer;
+class TextureStreamer;
+
+// Progress of a texture loading through a TextureStreamer. Shared between the
+// texture and the streamer; the streamer drops the load if the texture dies.
+struct TextureStreamStatus {
+	int width = 1;
+	int height = 1;
+	int levels = 1;
+	int baseLevel = 0;      // finest mip level uploaded so far
+	size_t sizeInBytes = 0; // of the full chain, once known
+	bool resident = false;  // every level uploaded
+	bool failed = false;
+
+	// Set when the whole texture was built on a ResourceLoader instead of
+	// streamed into the placeholder; replaces it from then on
+	std::optional<TextureHandle> loaded;
+
+	// Accounts for the storage the streamer specified for the placeholder
+	MemoryRecord memory;
+};
+
+
 class Texture {
 public:
+	// Single level texture with the same min and mag filter
 	Texture(std::string path, GLint interpolation);
 
+	// path is either a source image or a TextureContainer (.txc). Source
+	// images get a mip chain whenever settings.minFilter samples mipmaps;
+	// containers keep the levels, format and compression they were imported
+	// with and only take filtering from settings.
+	Texture(std::string path, const TextureSettings& settings);
+
+	// Decodes on the streamer's worker threads and uploads over the following
+	// frames, coarsest mip level first. Until the first level arrives the
+	// texture is a 1x1 grey placeholder, so it can be bound right away.
+	Texture(std::string path, const TextureSettings& settings, TextureStreamer& streamer);
+
 	// Because we're using the TextureHandle to do RAII for the texture for us
 	// and our other types are trivial or provide their own RAII
 	// we don't have to provide any specialized functions here. Rule of zero
@@ -22,12 +78,32 @@ public:
 	std::string getPath() const { return path; }
 	GLenum getInterpolation() const { return interpolation; }
 
+	// Dimensions, levels and size describe what is currently on the GPU, which
+	// is less than the source after reallocate() dropped fine levels.
 	// Although uint (i.e. uvec2) might make more sense here, went with int (i.e. ivec2) under
 	// the assumption that most students will want to work with ints, not uints, in main.cpp
-	glm::ivec2 getDimensions() const { return glm::uvec2(width, height); }
+	glm::ivec2 getDimensions() const { return stream ? glm::ivec2(stream->width, stream->height) : glm::ivec2(width, height); }
+
+	int getLevels() const { return stream ? stream->levels : levels; }
+	size_t getSizeInBytes() const { return stream ? stream->sizeInBytes : sizeInBytes; }
+	bool isResident() const { return !stream || stream->resident; }
+
+	// Level of the source the resident level 0 corresponds to
+	int getFinestLevel() const { return finestLevel; }
+
+	// Re-creates the texture with the levels of source from finestLevel down,
+	// releasing (or restoring) the finer ones. source is the container the
+	// texture was loaded from.
+	void reallocate(const TextureContainer& source, int finestLevel);
 
-	void bind() { glBindTexture(GL_TEXTURE_2D, textureID); }
-	void unbind() { glBindTexture(GL_TEXTURE_2D, textureID); }
+	void bind() {
+		GLStats::bindTexture(GL_TEXTURE_2D, *this);
+	}
+	void unbind() { GLStats::bindTexture(GL_TEXTURE_2D, 0); }
+
+	operator GLuint() const {
+		return stream && stream->loaded ? GLuint(*stream->loaded) : GLuint(textureID);
+	}
 
 private:
 	TextureHandle textureID;
@@ -40,6 +116,36 @@ private:
 	int width;
 	int height;
 
+	int levels;
+	size_t sizeInBytes;
+
+	TextureSettings settings;
+	int finestLevel;
 
+	// only set for streamed textures
+	std::shared_ptr<TextureStreamStatus> stream;
 
+	void upload(PixelFormat pixelFormat, bool srgb, const std::vector<ImageLevelView>& imageLevels, const TextureSettings& settings);
 };
+
+
+// GL internal format pixels of pixelFormat are stored with. Returns false if
+// the driver can't sample that format.
+bool textureInternalFormat(PixelFormat pixelFormat, bool srgb, GLenum& internalFormat, GLenum& format);
+
+// settings with compression turned off if the driver can't sample the result
+TextureSettings supportedSettings(const TextureSettings& settings);
+
+// Everything up to the GL upload of a source image: decode, mip chain, block
+// compression. Doesn't touch GL, so it can run on any thread.
+bool decodeTexture(const std::string& path, const TextureSettings& settings, Image& image);
+
+// Specifies every level of the texture bound to GL_TEXTURE_2D. Returns false
+// if the driver can't sample pixelFormat.
+bool uploadTextureLevels(PixelFormat pixelFormat, bool srgb, const std::vector<ImageLevelView>& imageLevels);
+
+// Largest GL_UNPACK_ALIGNMENT that rows of rowBytes satisfy
+GLint unpackAlignment(size_t rowBytes);
+
+// Filtering, wrapping and mip range for the texture bound to target
+void applyTextureSettings(GLenum target, int levels, const TextureSettings& settings);
@@ -0,0 +1,119 @@
+#include "TextureContainer.h"
+
+#include "Log.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace {
+	constexpr uint32_t magic = 0x31435854; // "TXC1"
+	constexpr uint32_t flagSrgb = 1u << 0;
+	constexpr uint64_t levelAlignment = 16;
+
+	struct FileHeader {
+		uint32_t magic;
+		uint32_t format;     // PixelFormat
+		uint32_t flags;
+		uint32_t levelCount;
+	};
+
+	struct LevelEntry {
+		uint64_t offset;
+		uint64_t size;
+		uint32_t width;
+		uint32_t height;
+	};
+
+	uint64_t alignUp(uint64_t value) {
+		return (value + levelAlignment - 1) / levelAlignment * levelAlignment;
+	}
+}
+
+
+bool isTextureContainer(const std::string& path) {
+	return std::filesystem::path(path).extension() == TextureContainer::extension;
+}
+
+
+bool TextureContainer::open(const std::string& path) {
+	levels.clear();
+	if (!file.open(path)) {
+		return false;
+	}
+
+	// Everything is checked against the file size up front, so a truncated or
+	// corrupt file is rejected here instead of crashing inside the driver
+	FileHeader header{};
+	if (file.size() < sizeof(header)) {
+		Log::error("TEXTURE_CONTAINER {} is truncated", path);
+		return false;
+	}
+	std::memcpy(&header, file.data(), sizeof(header));
+	if (header.magic != magic || header.format > uint32_t(PixelFormat::BC7) || header.levelCount == 0 || header.levelCount > 32) {
+		Log::error("TEXTURE_CONTAINER {} is not a texture container", path);
+		return false;
+	}
+	if (file.size() < sizeof(header) + header.levelCount * sizeof(LevelEntry)) {
+		Log::error("TEXTURE_CONTAINER {} is truncated", path);
+		return false;
+	}
+
+	format = PixelFormat(header.format);
+	srgb = (header.flags & flagSrgb) != 0;
+
+	const uint8_t* entries = file.data() + sizeof(header);
+	for (uint32_t i = 0; i < header.levelCount; i++) {
+		LevelEntry entry{};
+		std::memcpy(&entry, entries + i * sizeof(LevelEntry), sizeof(entry));
+		bool valid = entry.width > 0 && entry.height > 0
+			&& entry.size == levelSizeInBytes(format, int(entry.width), int(entry.height))
+			&& entry.offset <= file.size() && entry.size <= file.size() - entry.offset;
+		if (!valid) {
+			Log::error("TEXTURE_CONTAINER {} level {} is corrupt", path, i);
+			levels.clear();
+			return false;
+		}
+		levels.push_back({ int(entry.width), int(entry.height), file.data() + entry.offset, size_t(entry.size) });
+	}
+	return true;
+}
+
+
+bool writeTextureContainer(const std::string& path, const Image& image) {
+	FileHeader header{ magic, uint32_t(image.format), image.srgb ? flagSrgb : 0u, uint32_t(image.levels.size()) };
+
+	std::vector<LevelEntry> entries;
+	uint64_t offset = alignUp(sizeof(header) + image.levels.size() * sizeof(LevelEntry));
+	for (const ImageLevel& level : image.levels) {
+		entries.push_back({ offset, level.data.size(), uint32_t(level.width), uint32_t(level.height) });
+		offset = alignUp(offset + level.data.size());
+	}
+
+	// write to a temporary and rename, so a crash never leaves a half-written file
+	std::filesystem::path temporary = path;
+	temporary += ".tmp";
+	{
+		std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		out.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(LevelEntry));
+		for (size_t i = 0; i < image.levels.size(); i++) {
+			// zero padding up to the level's offset
+			const char padding[levelAlignment] = {};
+			out.write(padding, std::streamsize(entries[i].offset - uint64_t(out.tellp())));
+			out.write(reinterpret_cast<const char*>(image.levels[i].data.data()), image.levels[i].data.size());
+		}
+		if (!out) {
+			Log::error("TEXTURE_CONTAINER could not write {}", temporary.string());
+			return false;
+		}
+	}
+
+	std::error_code ec;
+	std::filesystem::rename(temporary, path, ec);
+	if (ec) {
+		Log::error("TEXTURE_CONTAINER could not write {}: {}", path, ec.message());
+		return false;
+	}
+	return true;
+}
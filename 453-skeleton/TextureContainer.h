@@ -0,0 +1,53 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// A pre-processed texture file, loosely modelled on KTX2.
+//
+// Source images are decoded, mipmapped and optionally block compressed once by
+// the texture-import tool. At runtime the container is memory mapped and its
+// levels are handed to glTexImage2D / glCompressedTexImage2D as they are, with
+// no decoding at all.
+//
+// Layout (little endian):
+//
+//	FileHeader
+//	LevelEntry[levelCount]   offsets are from the start of the file
+//	level data               each level 16-byte aligned, level 0 first
+//------------------------------------------------------------------------------
+
+#include "Image.h"
+#include "MappedFile.h"
+
+#include <string>
+#include <vector>
+
+
+class TextureContainer {
+
+public:
+	// File extension the importer writes and Texture recognizes
+	static constexpr const char* extension = ".txc";
+
+	// Public interface
+	// Maps and validates the file. Logs and returns false on failure.
+	bool open(const std::string& path);
+
+	PixelFormat getFormat() const { return format; }
+	bool isSrgb() const { return srgb; }
+
+	// Point into the mapping, valid while the container is alive
+	const std::vector<ImageLevelView>& getLevels() const { return levels; }
+
+private:
+	MappedFile file;
+	PixelFormat format = PixelFormat::RGBA8;
+	bool srgb = false;
+	std::vector<ImageLevelView> levels;
+};
+
+
+// True if path names a texture container rather than a source image
+bool isTextureContainer(const std::string& path);
+
+// Writes every level of image to a container at path
+bool writeTextureContainer(const std::string& path, const Image& image);
@@ -0,0 +1,161 @@
+#include "TextureResidency.h"
+
+#include "Arena.h"
+#include "Log.h"
+
+#include <algorithm>
+#include <cmath>
+#include <queue>
+
+
+TextureResidency::TextureResidency(size_t budgetBytes, size_t uploadBytesPerFrame)
+	: budget(budgetBytes)
+	, uploadBytesPerFrame(uploadBytesPerFrame)
+{}
+
+
+void TextureResidency::add(Texture& texture) {
+	Entry entry;
+	entry.texture = &texture;
+	entries.push_back(std::move(entry));
+}
+
+
+void TextureResidency::remove(Texture& texture) {
+	entries.erase(std::remove_if(entries.begin(), entries.end(), [&](const Entry& e) { return e.texture == &texture; }), entries.end());
+}
+
+
+void TextureResidency::reportUsage(const Texture& texture, float screenSize) {
+	for (Entry& entry : entries) {
+		if (entry.texture == &texture) {
+			entry.screenSize = std::max(entry.screenSize, screenSize);
+		}
+	}
+}
+
+
+// Maps the source of a texture once it has finished loading
+bool TextureResidency::prepare(Entry& entry) {
+	if (!entry.levelSizes.empty()) {
+		return entry.source != nullptr;
+	}
+	if (!entry.texture->isResident()) {
+		return false;
+	}
+
+	if (isTextureContainer(entry.texture->getPath())) {
+		auto source = std::make_unique<TextureContainer>();
+		if (source->open(entry.texture->getPath())) {
+			for (const ImageLevelView& level : source->getLevels()) {
+				entry.levelSizes.push_back(level.size);
+			}
+			entry.source = std::move(source);
+			entry.target = entry.texture->getFinestLevel();
+			return true;
+		}
+	}
+
+	// not restorable: a single fixed size level as far as the budget goes
+	entry.levelSizes.push_back(entry.texture->getSizeInBytes());
+	return false;
+}
+
+
+size_t TextureResidency::residentBytes(const Entry& entry, int finestLevel) const {
+	size_t bytes = 0;
+	for (size_t i = size_t(finestLevel); i < entry.levelSizes.size(); i++) {
+		bytes += entry.levelSizes[i];
+	}
+	return bytes;
+}
+
+
+void TextureResidency::update() {
+	stats = Stats();
+	stats.budgetBytes = budget;
+
+	// Finest level each texture can show: about one texel per screen pixel
+	// The lists below only live for this call, so they come from the scratch
+	// arena rather than the heap
+	ScratchScope scratch;
+	size_t total = 0;
+	ArenaVector<size_t> managed;
+	managed.reserve(entries.size());
+	for (size_t i = 0; i < entries.size(); i++) {
+		Entry& entry = entries[i];
+		if (!prepare(entry)) {
+			total += entry.texture->getSizeInBytes();
+			continue;
+		}
+
+		const int coarsest = int(entry.levelSizes.size()) - 1;
+		const float width = float(entry.source->getLevels()[0].width);
+		entry.wanted = entry.screenSize > 0.0f
+			? std::clamp(int(std::floor(std::log2(width / entry.screenSize))), 0, coarsest)
+			: coarsest;
+
+		// Levels finer than needed stay while there is room for them; they
+		// are the first to go below when there isn't
+		entry.target = std::min(entry.wanted, entry.texture->getFinestLevel());
+
+		total += residentBytes(entry, entry.target);
+		managed.push_back(i);
+	}
+
+	// Over budget: repeatedly drop the top level that covers the fewest
+	// screen pixels per texel
+	auto importance = [&](size_t i) {
+		const Entry& entry = entries[i];
+		float texels = float(std::max(1, entry.source->getLevels()[entry.target].width));
+		return entry.screenSize / texels;
+	};
+	auto lessImportant = [&](size_t a, size_t b) { return importance(a) > importance(b); };
+	std::priority_queue<size_t, ArenaVector<size_t>, decltype(lessImportant)> candidates(lessImportant, managed);
+	while (total > budget && !candidates.empty()) {
+		size_t i = candidates.top();
+		candidates.pop();
+		Entry& entry = entries[i];
+		if (entry.target + 1 >= int(entry.levelSizes.size())) {
+			continue;
+		}
+		total -= entry.levelSizes[entry.target];
+		entry.target++;
+		candidates.push(i);
+	}
+
+	// Apply: drops first (they are what gets us under budget), then restores
+	// of the most visible textures, within the per-frame upload limit
+	std::sort(managed.begin(), managed.end(), [&](size_t a, size_t b) {
+		const Entry& ea = entries[a];
+		const Entry& eb = entries[b];
+		bool dropA = ea.target > ea.texture->getFinestLevel();
+		bool dropB = eb.target > eb.texture->getFinestLevel();
+		return dropA != dropB ? dropA : ea.screenSize > eb.screenSize;
+	});
+	size_t uploaded = 0;
+	for (size_t i : managed) {
+		Entry& entry = entries[i];
+		if (entry.target == entry.texture->getFinestLevel()) {
+			continue;
+		}
+		size_t bytes = residentBytes(entry, entry.target);
+		if (uploaded > 0 && uploaded + bytes > uploadBytesPerFrame) {
+			break;
+		}
+		entry.texture->reallocate(*entry.source, entry.target);
+		uploaded += bytes;
+		stats.reallocations++;
+	}
+
+	for (Entry& entry : entries) {
+		if (entry.source) {
+			stats.residentBytes += residentBytes(entry, entry.texture->getFinestLevel());
+			stats.droppedLevels += unsigned(entry.texture->getFinestLevel());
+		}
+		else {
+			stats.residentBytes += entry.texture->getSizeInBytes();
+		}
+		entry.screenSize = 0.0f; // reported afresh every frame
+	}
+}
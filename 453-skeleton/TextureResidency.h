@@ -0,0 +1,69 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// This file contains a texture memory budget.
+//
+// Tracked textures report how large they appeared on screen each frame. Once
+// per frame the manager restores levels that became visible again, then,
+// while the total is over budget, drops the top level whose texels are spread
+// over the fewest screen pixels (levels finer than the screen can show and
+// textures that weren't drawn at all go first). Textures whose level changes are
+// reallocated from their memory mapped container (Texture::reallocate), so
+// dropped levels really free GPU memory and restoring them costs a copy from
+// the page cache, not a decode.
+//
+// Textures that weren't loaded from a container can't be restored once
+// dropped; they are counted against the budget at their full size.
+//------------------------------------------------------------------------------
+
+#include "Texture.h"
+#include "TextureContainer.h"
+
+#include <memory>
+#include <vector>
+
+
+class TextureResidency {
+
+public:
+	TextureResidency(size_t budgetBytes, size_t uploadBytesPerFrame = 32u << 20);
+
+	struct Stats {
+		size_t residentBytes = 0;
+		size_t budgetBytes = 0;
+		unsigned int droppedLevels = 0; // summed over all textures
+		unsigned int reallocations = 0; // last update()
+	};
+
+	// Public interface
+	// texture must stay at the same address until remove()
+	void add(Texture& texture);
+	void remove(Texture& texture);
+
+	// screenSize: how many screen pixels the texture's width spans this frame
+	// (e.g. the circumference of a textured sphere), 0 if it wasn't drawn
+	void reportUsage(const Texture& texture, float screenSize);
+
+	void update();
+
+	void setBudget(size_t bytes) { budget = bytes; }
+	const Stats& getStats() const { return stats; }
+
+private:
+	struct Entry {
+		Texture* texture = nullptr;
+		std::unique_ptr<TextureContainer> source; // null if not restorable
+		std::vector<size_t> levelSizes;           // of the source chain
+		float screenSize = 0.0f;
+		int wanted = 0;       // finest level worth showing at screenSize
+		int target = 0; // finest level after the budget is applied
+	};
+
+	size_t budget;
+	size_t uploadBytesPerFrame;
+	std::vector<Entry> entries;
+	Stats stats;
+
+	bool prepare(Entry& entry);
+	size_t residentBytes(const Entry& entry, int finestLevel) const;
+};
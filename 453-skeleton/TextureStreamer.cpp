@@ -0,0 +1,294 @@
+#include "TextureStreamer.h"
+
+#include "GLStats.h"
+#include "Log.h"
+
+#include <algorithm>
+#include <cstring>
+
+
+TextureStreamer::TextureStreamer(ResourceLoader* loader, size_t bytesPerFrame, unsigned int workerCount)
+	: loader(loader)
+	, bytesPerFrame(bytesPerFrame)
+	, inFlight(0)
+	, stopping(false)
+	, nextPixelBuffer(0)
+{
+	if (workerCount == 0) {
+		workerCount = std::max(1u, std::thread::hardware_concurrency() - 1);
+	}
+	for (unsigned int i = 0; i < workerCount; i++) {
+		workers.emplace_back(&TextureStreamer::workerLoop, this);
+	}
+}
+
+
+TextureStreamer::~TextureStreamer() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+}
+
+
+void TextureStreamer::request(GLuint texture, const std::string& path, const TextureSettings& settings, std::weak_ptr<TextureStreamStatus> status) {
+	// Driver support has to be checked here, workers can't talk to GL
+	Job job{ texture, path, supportedSettings(settings), std::move(status) };
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		jobs.push_back(std::move(job));
+	}
+	inFlight++;
+	wake.notify_one();
+}
+
+
+void TextureStreamer::workerLoop() {
+	while (true) {
+		Job job;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [&] { return stopping || !jobs.empty(); });
+			if (stopping) {
+				return;
+			}
+			job = std::move(jobs.front());
+			jobs.pop_front();
+		}
+
+		Upload upload;
+		upload.job = std::move(job);
+		if (!upload.job.status.expired()) {
+			if (isTextureContainer(upload.job.path)) {
+				upload.container = std::make_unique<TextureContainer>();
+				upload.decoded = upload.container->open(upload.job.path);
+				upload.format = upload.container->getFormat();
+				upload.srgb = upload.container->isSrgb();
+				upload.levels = upload.container->getLevels();
+			}
+			else {
+				upload.decoded = decodeTexture(upload.job.path, upload.job.settings, upload.image);
+				upload.format = upload.image.format;
+				upload.srgb = upload.image.srgb;
+				upload.levels = levelViews(upload.image);
+			}
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+		decoded.push_back(std::move(upload));
+	}
+}
+
+
+bool TextureStreamer::allocate(Upload& upload, TextureStreamStatus& status) {
+	GLenum internalFormat, format;
+	if (!textureInternalFormat(upload.format, upload.srgb, internalFormat, format)) {
+		return false;
+	}
+
+	GLStats::bindTexture(GL_TEXTURE_2D, upload.job.texture);
+	const int levels = int(upload.levels.size());
+	status.sizeInBytes = 0;
+	for (int i = 0; i < levels; i++) {
+		const ImageLevelView& level = upload.levels[i];
+		status.sizeInBytes += level.size;
+		if (isCompressed(upload.format)) {
+			glCompressedTexImage2D(GL_TEXTURE_2D, i, internalFormat, level.width, level.height, 0, GLsizei(level.size), nullptr);
+		}
+		else {
+			glTexImage2D(GL_TEXTURE_2D, i, internalFormat, level.width, level.height, 0, format, GL_UNSIGNED_BYTE, nullptr);
+		}
+	}
+	applyTextureSettings(GL_TEXTURE_2D, levels, upload.job.settings);
+
+	// nothing is sampled until the coarsest level has arrived
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, levels - 1);
+
+	status.width = upload.levels[0].width;
+	status.height = upload.levels[0].height;
+	status.levels = levels;
+	status.baseLevel = levels - 1;
+	status.memory.set(MemoryCategory::Textures, upload.job.path, status.sizeInBytes);
+
+	upload.allocated = true;
+	upload.level = levels - 1;
+	upload.row = 0;
+	return true;
+}
+
+
+bool TextureStreamer::load(Upload& upload) {
+	GLenum internalFormat, format;
+	if (!textureInternalFormat(upload.format, upload.srgb, internalFormat, format)) {
+		return false;
+	}
+
+	auto shared = std::make_shared<Upload>(std::move(upload));
+	auto ticket = loader->submit([shared]() {
+		shared->loaded.emplace();
+		GLStats::bindTexture(GL_TEXTURE_2D, *shared->loaded);
+		uploadTextureLevels(shared->format, shared->srgb, shared->levels);
+		applyTextureSettings(GL_TEXTURE_2D, int(shared->levels.size()), shared->job.settings);
+		GLStats::bindTexture(GL_TEXTURE_2D, 0);
+	});
+	loads.push_back({ std::move(shared), std::move(ticket) });
+	return true;
+}
+
+
+void TextureStreamer::finishLoads() {
+	for (auto it = loads.begin(); it != loads.end();) {
+		if (!it->ticket->ready()) {
+			++it;
+			continue;
+		}
+
+		Upload& upload = *it->upload;
+		std::shared_ptr<TextureStreamStatus> status = upload.job.status.lock();
+		if (status && (it->ticket->failed() || !upload.loaded)) {
+			status->failed = true;
+			Log::error("TEXTURE_STREAMER failed to load {}", upload.job.path);
+		}
+		else if (status) {
+			status->width = upload.levels[0].width;
+			status->height = upload.levels[0].height;
+			status->levels = int(upload.levels.size());
+			status->baseLevel = 0;
+			status->sizeInBytes = 0;
+			for (const ImageLevelView& level : upload.levels) {
+				status->sizeInBytes += level.size;
+			}
+			upload.loaded->track(MemoryCategory::Textures, upload.job.path, status->sizeInBytes);
+			status->loaded = std::move(upload.loaded);
+			status->resident = true;
+			Log::info("TEXTURE_STREAMER {} resident ({}x{}, {} levels, loader thread)", upload.job.path, status->width, status->height, status->levels);
+		}
+
+		it = loads.erase(it);
+		inFlight--;
+	}
+}
+
+
+size_t TextureStreamer::uploadSlice(Upload& upload, size_t budget) {
+	const ImageLevelView& level = upload.levels[upload.level];
+	const bool compressed = isCompressed(upload.format);
+
+	GLenum internalFormat, format;
+	textureInternalFormat(upload.format, upload.srgb, internalFormat, format);
+
+	// compressed levels are uploaded in whole rows of 4x4 blocks
+	const size_t rowBytes = compressed
+		? levelSizeInBytes(upload.format, level.width, 4)
+		: size_t(level.width) * bytesPerPixel(upload.format);
+	const int rowCount = compressed ? (level.height + 3) / 4 : level.height;
+	const int rows = std::min(rowCount - upload.row, int(std::max<size_t>(1, budget / rowBytes)));
+	const size_t bytes = size_t(rows) * rowBytes;
+
+	// Orphaning the buffer gives us fresh storage without waiting on the
+	// transfer issued from it a few frames ago
+	VertexBufferHandle& pixelBuffer = pixelBuffers[nextPixelBuffer];
+	nextPixelBuffer = (nextPixelBuffer + 1) % 3;
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer);
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, GLsizeiptr(bytes), nullptr, GL_STREAM_DRAW);
+	pixelBuffer.track(MemoryCategory::TransferBuffers, "texture streaming", bytes);
+	void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, GLsizeiptr(bytes), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	if (mapped != nullptr) {
+		std::memcpy(mapped, level.data + size_t(upload.row) * rowBytes, bytes);
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+	}
+
+	GLStats::bindTexture(GL_TEXTURE_2D, upload.job.texture);
+	if (compressed) {
+		int y = upload.row * 4;
+		int height = std::min(rows * 4, level.height - y);
+		glCompressedTexSubImage2D(GL_TEXTURE_2D, upload.level, 0, y, level.width, height, internalFormat, GLsizei(bytes), nullptr);
+	}
+	else {
+		glPixelStorei(GL_UNPACK_ALIGNMENT, unpackAlignment(rowBytes));
+		glTexSubImage2D(GL_TEXTURE_2D, upload.level, 0, upload.row, level.width, rows, format, GL_UNSIGNED_BYTE, nullptr);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	}
+	GLStats::record(GLCall::TextureUpload, bytes);
+
+	upload.row += rows;
+	return bytes;
+}
+
+
+void TextureStreamer::update() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		while (!decoded.empty()) {
+			uploads.push_back(std::move(decoded.front()));
+			decoded.pop_front();
+		}
+	}
+
+	if (loader != nullptr) {
+		// whole textures go to the loader; nothing is uploaded from here
+		while (!uploads.empty()) {
+			Upload& upload = uploads.front();
+			std::shared_ptr<TextureStreamStatus> status = upload.job.status.lock();
+			if (status && (!upload.decoded || !load(upload))) {
+				status->failed = true;
+				Log::error("TEXTURE_STREAMER failed to load {}", upload.job.path);
+			}
+			if (!status || status->failed) {
+				inFlight--;
+			}
+			uploads.pop_front();
+		}
+		finishLoads();
+		return;
+	}
+
+	size_t budget = bytesPerFrame;
+	while (!uploads.empty() && budget > 0) {
+		Upload& upload = uploads.front();
+		std::shared_ptr<TextureStreamStatus> status = upload.job.status.lock();
+		bool failed = status && (!upload.decoded || (!upload.allocated && !allocate(upload, *status)));
+		if (!status || failed) {
+			// the texture was destroyed, or the file couldn't be decoded or
+			// is in a format this driver can't sample
+			if (failed) {
+				status->failed = true;
+				Log::error("TEXTURE_STREAMER failed to load {}", upload.job.path);
+			}
+			uploads.pop_front();
+			inFlight--;
+			continue;
+		}
+
+		budget -= std::min(budget, uploadSlice(upload, budget));
+
+		const ImageLevelView& level = upload.levels[upload.level];
+		int rowCount = isCompressed(upload.format) ? (level.height + 3) / 4 : level.height;
+		if (upload.row < rowCount) {
+			continue; // budget ran out mid-level
+		}
+
+		// level complete: let the sampler use it
+		GLStats::bindTexture(GL_TEXTURE_2D, upload.job.texture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, upload.level);
+		status->baseLevel = upload.level;
+
+		if (upload.level == 0) {
+			status->resident = true;
+			Log::info("TEXTURE_STREAMER {} resident ({}x{}, {} levels)", upload.job.path, status->width, status->height, status->levels);
+			uploads.pop_front();
+			inFlight--;
+		}
+		else {
+			upload.level--;
+			upload.row = 0;
+		}
+	}
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	GLStats::bindTexture(GL_TEXTURE_2D, 0);
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// This file contains asynchronous texture loading.
+//
+// Decoding (and mip generation / compression) runs on a pool of worker
+// threads; texture containers are only mapped there, they need no decoding.
+//
+// With a ResourceLoader, each decoded texture is built whole on the loader's
+// shared context and swapped in for the placeholder once its fence signals,
+// so the render thread issues no upload commands at all. Without one,
+// decoded images are uploaded from the render thread through a small ring of
+// pixel buffer objects, at most bytesPerFrame per frame, so a large texture
+// is spread over several frames instead of causing a hitch. Levels go up
+// coarsest first and GL_TEXTURE_BASE_LEVEL follows along, so a texture
+// sharpens progressively while it streams in.
+//------------------------------------------------------------------------------
+
+#include "GLHandles.h"
+#include "Image.h"
+#include "ResourceLoader.h"
+#include "Texture.h"
+#include "TextureContainer.h"
+
+#include <GL/glew.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+class TextureStreamer {
+
+public:
+	// workerCount of 0 uses all but one hardware thread. loader, if given,
+	// must outlive the streamer.
+	TextureStreamer(ResourceLoader* loader = nullptr, size_t bytesPerFrame = 8u << 20, unsigned int workerCount = 0);
+	~TextureStreamer();
+
+	// Owns threads
+	TextureStreamer(const TextureStreamer&) = delete;
+	TextureStreamer operator=(const TextureStreamer&) = delete;
+
+	// Public interface
+	void request(GLuint texture, const std::string& path, const TextureSettings& settings, std::weak_ptr<TextureStreamStatus> status);
+
+	// Uploads up to bytesPerFrame of decoded data, or hands decoded textures
+	// to the loader and swaps in the finished ones. Call once per frame on the
+	// thread that owns the GL context.
+	void update();
+
+	// Textures requested but not fully uploaded yet
+	size_t pending() const { return inFlight; }
+
+	void setBytesPerFrame(size_t bytes) { bytesPerFrame = bytes; }
+
+private:
+	struct Job {
+		GLuint texture;
+		std::string path;
+		TextureSettings settings;
+		std::weak_ptr<TextureStreamStatus> status;
+	};
+
+	struct Upload {
+		Job job;
+
+		// what gets uploaded, pointing into either image or container
+		PixelFormat format = PixelFormat::RGBA8;
+		bool srgb = false;
+		std::vector<ImageLevelView> levels;
+		Image image;
+		std::unique_ptr<TextureContainer> container;
+
+		bool decoded = false;
+		bool allocated = false;
+		int level = 0; // level currently uploading
+		int row = 0;   // next row (block row for compressed formats) of that level
+
+		std::optional<TextureHandle> loaded; // built on the loader thread
+	};
+
+	struct Load {
+		std::shared_ptr<Upload> upload;
+		std::shared_ptr<LoadTicket> ticket;
+	};
+
+	ResourceLoader* loader;
+	size_t bytesPerFrame;
+	size_t inFlight;
+
+	// worker side
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::deque<Job> jobs;
+	std::deque<Upload> decoded;
+	bool stopping;
+
+	// render thread side
+	std::deque<Upload> uploads;
+	VertexBufferHandle pixelBuffers[3];
+	unsigned int nextPixelBuffer;
+	std::vector<Load> loads; // waiting on the loader
+
+	void workerLoop();
+	bool load(Upload& upload);
+	void finishLoads();
+	bool allocate(Upload& upload, TextureStreamStatus& status);
+	size_t uploadSlice(Upload& upload, size_t budget);
+};
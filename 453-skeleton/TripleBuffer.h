@@ -0,0 +1,57 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// This file contains a lock-free triple buffer for handing the newest value
+// from one producer thread to one consumer thread.
+//
+// The producer fills its back slot and publishes it by swapping it with the
+// shared middle slot. The consumer swaps the middle slot with its front slot
+// when something new was published. Neither side ever waits for the other:
+// a slow consumer just skips values, and a slow producer leaves the consumer
+// reading the latest one again.
+//
+//	producer:                        consumer:
+//	T& value = buffer.back();        buffer.acquire();
+//	... fill value ...               const T& value = buffer.front();
+//	buffer.publish();
+//------------------------------------------------------------------------------
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+
+template <typename T>
+class TripleBuffer {
+
+public:
+	TripleBuffer() : middle(1), backIndex(0), frontIndex(2) {}
+
+	TripleBuffer(const TripleBuffer&) = delete;
+	TripleBuffer operator=(const TripleBuffer&) = delete;
+
+	// Producer side. The slot keeps whatever it held three publishes ago.
+	T& back() { return slots[backIndex]; }
+	void publish() {
+		backIndex = middle.exchange(uint8_t(backIndex | freshBit), std::memory_order_acq_rel) & indexMask;
+	}
+
+	// Consumer side. Returns true if front() moved to a newer value.
+	bool acquire() {
+		if ((middle.load(std::memory_order_relaxed) & freshBit) == 0) {
+			return false;
+		}
+		frontIndex = middle.exchange(frontIndex, std::memory_order_acq_rel) & indexMask;
+		return true;
+	}
+	T& front() { return slots[frontIndex]; }
+
+private:
+	static constexpr uint8_t indexMask = 0x3;
+	static constexpr uint8_t freshBit = 0x4; // middle holds an unread value
+
+	std::array<T, 3> slots;
+	std::atomic<uint8_t> middle;
+	uint8_t backIndex;  // owned by the producer
+	uint8_t frontIndex; // owned by the consumer
+};
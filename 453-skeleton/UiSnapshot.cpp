@@ -0,0 +1,51 @@
+#include "UiSnapshot.h"
+
+#include <cstring>
+
+
+namespace {
+	// ImVector's assignment frees and reallocates; this keeps the capacity
+	template <typename T>
+	void copyInto(ImVector<T>& destination, const ImVector<T>& source) {
+		destination.resize(source.Size);
+		if (source.Size > 0) {
+			std::memcpy(destination.Data, source.Data, size_t(source.Size) * sizeof(T));
+		}
+	}
+}
+
+
+void UiSnapshot::capture(const ImDrawData* source) {
+	if (source == nullptr || !source->Valid) {
+		drawData.Valid = false;
+		return;
+	}
+
+	while (int(lists.size()) < source->CmdListsCount) {
+		lists.push_back(std::make_unique<ImDrawList>(nullptr));
+	}
+	listPointers.resize(size_t(source->CmdListsCount));
+	for (int i = 0; i < source->CmdListsCount; i++) {
+		const ImDrawList& from = *source->CmdLists[i];
+		ImDrawList& to = *lists[i];
+		copyInto(to.CmdBuffer, from.CmdBuffer);
+		copyInto(to.IdxBuffer, from.IdxBuffer);
+		copyInto(to.VtxBuffer, from.VtxBuffer);
+		to.Flags = from.Flags;
+		listPointers[i] = &to;
+	}
+
+	drawData.Valid = true;
+	drawData.CmdLists = listPointers.data();
+	drawData.CmdListsCount = source->CmdListsCount;
+	drawData.TotalIdxCount = source->TotalIdxCount;
+	drawData.TotalVtxCount = source->TotalVtxCount;
+	drawData.DisplayPos = source->DisplayPos;
+	drawData.DisplaySize = source->DisplaySize;
+	drawData.FramebufferScale = source->FramebufferScale;
+}
+
+
+ImDrawData* UiSnapshot::getDrawData() {
+	return drawData.Valid ? &drawData : nullptr;
+}
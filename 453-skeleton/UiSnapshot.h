@@ -0,0 +1,38 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// This file contains a copy of a finished ImGui frame.
+//
+// The UI is built on the main thread, where GLFW delivers input, but drawn on
+// the render thread. ImDrawData only points into the ImGui context, which the
+// next ImGui::NewFrame() overwrites, so the vertex, index and command buffers
+// are copied out. Buffers are reused between captures, so a steady UI copies
+// without allocating.
+//------------------------------------------------------------------------------
+
+#include "imgui/imgui.h"
+
+#include <memory>
+#include <vector>
+
+
+class UiSnapshot {
+
+public:
+	UiSnapshot() = default;
+
+	UiSnapshot(const UiSnapshot&) = delete;
+	UiSnapshot operator=(const UiSnapshot&) = delete;
+
+	// Copies the output of ImGui::Render()
+	void capture(const ImDrawData* source);
+
+	// Ready for ImGui_ImplOpenGL3_RenderDrawData(), null before the first
+	// capture
+	ImDrawData* getDrawData();
+
+private:
+	ImDrawData drawData;
+	std::vector<std::unique_ptr<ImDrawList>> lists;
+	std::vector<ImDrawList*> listPointers;
+};
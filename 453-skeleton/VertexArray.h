@@ -1,6 +1,7 @@
 #pragma once
 
 #include "GLHandles.h"
+#include "GLStats.h"
 
 #include <GL/glew.h>
 
@@ -18,7 +19,14 @@ public:
 	// https://github.com/isocpp/CppCoreGuidelines/blob/master/CppCoreGuidelines.md#Rc-zero
 
 	// Public interface
-	void bind() const { glBindVertexArray(arrayID); }
+	void bind() const {
+		glBindVertexArray(arrayID);
+		GLStats::record(GLCall::VertexArrayBind);
+	}
+
+	operator GLuint() const {
+		return arrayID;
+	}
 
 private:
 	VertexArrayHandle arrayID;
@@ -1,10 +1,13 @@
 #include "VertexBuffer.h"
 
+#include "GLStats.h"
+
 #include <utility>
 
 
-VertexBuffer::VertexBuffer(GLuint index, GLint size, GLenum dataType)
+VertexBuffer::VertexBuffer(GLuint index, GLint size, GLenum dataType, const char* tag)
 	: bufferID{}
+	, tag(tag)
 {
 	bind();
 	glVertexAttribPointer(index, size, dataType, GL_FALSE, 0, (void*)0);
@@ -15,4 +18,6 @@ VertexBuffer::VertexBuffer(GLuint index, GLint size, GLenum dataType)
 void VertexBuffer::uploadData(GLsizeiptr size, const void* data, GLenum usage) {
 	bind();
 	glBufferData(GL_ARRAY_BUFFER, size, data, usage);
+	GLStats::record(GLCall::BufferUpload, size_t(size));
+	bufferID.track(MemoryCategory::Geometry, tag, size_t(size));
 }
@@ -8,7 +8,8 @@
 class VertexBuffer {
 
 public:
-	VertexBuffer(GLuint index, GLint size, GLenum dataType);
+	// tag names the owner in the memory accounting (see MemoryAccounting.h)
+	VertexBuffer(GLuint index, GLint size, GLenum dataType, const char* tag);
 
 	// Because we're using the VertexBufferHandle to do RAII for the buffer for us
 	// and our other types are trivial or provide their own RAII
@@ -23,5 +24,6 @@ public:
 
 private:
 	VertexBufferHandle bufferID;
+	const char* tag;
 };
 
@@ -0,0 +1,438 @@
+#include "VirtualTexture.h"
+
+#include "Arena.h"
+#include "GLStats.h"
+#include "Log.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+	uint64_t tileKey(int texture, int level, int x, int y) {
+		return uint64_t(texture) << 48 | uint64_t(level) << 40 | uint64_t(y) << 20 | uint64_t(x);
+	}
+
+	int keyTexture(uint64_t key) { return int(key >> 48); }
+	int keyLevel(uint64_t key) { return int((key >> 40) & 0xFF); }
+	int keyY(uint64_t key) { return int((key >> 20) & 0xFFFFF); }
+	int keyX(uint64_t key) { return int(key & 0xFFFFF); }
+
+	int nextPowerOfTwo(int value) {
+		int result = 1;
+		while (result < value) {
+			result *= 2;
+		}
+		return result;
+	}
+}
+
+
+//------------------------------------------------------------------------------
+// VirtualTexture
+
+void VirtualTexture::createIndirection() {
+	const std::vector<VirtualTextureLevel>& levels = file.getLevels();
+
+	tables.resize(levels.size());
+	for (size_t i = 0; i < levels.size(); i++) {
+		size_t tiles = size_t(levels[i].tilesX) * levels[i].tilesY;
+		tables[i].slots.assign(tiles, -1);
+		tables[i].entries.assign(tiles * 4, 0);
+	}
+
+	// Sized as a full mip chain over the next power of two of the level 0
+	// tile counts, so every level's tiles fit in the GL level of the same index
+	int width = nextPowerOfTwo(levels[0].tilesX);
+	int height = nextPowerOfTwo(levels[0].tilesY);
+	int glLevels = 1;
+	while ((width >> (glLevels - 1)) > 1 || (height >> (glLevels - 1)) > 1) {
+		glLevels++;
+	}
+
+	GLStats::bindTexture(GL_TEXTURE_2D, indirection);
+	size_t bytes = 0;
+	for (int i = 0; i < glLevels; i++) {
+		glTexImage2D(GL_TEXTURE_2D, i, GL_RGBA8UI, std::max(1, width >> i), std::max(1, height >> i), 0, GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, nullptr);
+		bytes += size_t(std::max(1, width >> i)) * std::max(1, height >> i) * 4;
+	}
+	indirection.track(MemoryCategory::VirtualTextures, "indirection", bytes);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, glLevels - 1);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	GLStats::bindTexture(GL_TEXTURE_2D, 0);
+}
+
+
+void VirtualTexture::refresh(int level, int x, int y, int atlasTilesPerSide) {
+	const std::vector<VirtualTextureLevel>& levels = file.getLevels();
+
+	// Walk down from the tile, covering its footprint on each finer level.
+	// Tiles without their own slot inherit their parent's entry, which was
+	// already brought up to date one iteration earlier.
+	for (int l = level; l >= 0; l--) {
+		const int shift = level - l;
+		const VirtualTextureLevel& info = levels[l];
+		const int x0 = x << shift, x1 = std::min(((x + 1) << shift), info.tilesX);
+		const int y0 = y << shift, y1 = std::min(((y + 1) << shift), info.tilesY);
+
+		LevelTable& table = tables[l];
+		for (int ty = y0; ty < y1; ty++) {
+			for (int tx = x0; tx < x1; tx++) {
+				size_t index = size_t(ty) * info.tilesX + tx;
+				uint8_t* entry = &table.entries[index * 4];
+				int slot = table.slots[index];
+				if (slot >= 0) {
+					entry[0] = uint8_t(slot % atlasTilesPerSide);
+					entry[1] = uint8_t(slot / atlasTilesPerSide);
+					entry[2] = uint8_t(l);
+					entry[3] = 255;
+				}
+				else if (l + 1 < int(levels.size())) {
+					// a parent index can point past the last tile of an odd
+					// sized level; the shader clamps the same way
+					const VirtualTextureLevel& parent = levels[l + 1];
+					int px = std::min(tx >> 1, parent.tilesX - 1);
+					int py = std::min(ty >> 1, parent.tilesY - 1);
+					const uint8_t* parentEntry = &tables[l + 1].entries[(size_t(py) * parent.tilesX + px) * 4];
+					std::copy(parentEntry, parentEntry + 4, entry);
+				}
+			}
+		}
+		table.dirty = true;
+	}
+}
+
+
+void VirtualTexture::uploadIndirection() {
+	const std::vector<VirtualTextureLevel>& levels = file.getLevels();
+	bool bound = false;
+	for (size_t i = 0; i < tables.size(); i++) {
+		if (!tables[i].dirty) {
+			continue;
+		}
+		if (!bound) {
+			GLStats::bindTexture(GL_TEXTURE_2D, indirection);
+			bound = true;
+		}
+		glTexSubImage2D(GL_TEXTURE_2D, GLint(i), 0, 0, levels[i].tilesX, levels[i].tilesY, GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, tables[i].entries.data());
+		GLStats::record(GLCall::TextureUpload, size_t(levels[i].tilesX) * levels[i].tilesY * 4);
+		tables[i].dirty = false;
+	}
+	if (bound) {
+		GLStats::bindTexture(GL_TEXTURE_2D, 0);
+	}
+}
+
+
+//------------------------------------------------------------------------------
+// VirtualTextureCache
+
+VirtualTextureCache::VirtualTextureCache(int atlasTilesPerSide, int feedbackDivisor, int tilesPerFrame)
+	: atlasTilesPerSide(std::clamp(atlasTilesPerSide, 2, 255))
+	, feedbackDivisor(std::max(1, feedbackDivisor))
+	, tilesPerFrame(std::max(1, tilesPerFrame))
+	, feedbackWidth(0)
+	, feedbackHeight(0)
+	, savedViewport{ 0, 0, 0, 0 }
+	, savedFramebuffer(0)
+	, nextReadback(0)
+	, frame(1)
+{
+	const int size = this->atlasTilesPerSide * VirtualTextureFile::paddedTileSize;
+	GLStats::bindTexture(GL_TEXTURE_2D, atlas);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_SRGB8_ALPHA8, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	atlas.track(MemoryCategory::VirtualTextures, "atlas", size_t(size) * size * 4);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	GLStats::bindTexture(GL_TEXTURE_2D, 0);
+
+	const int slotCount = this->atlasTilesPerSide * this->atlasTilesPerSide;
+	slots.resize(slotCount);
+	for (int i = slotCount - 1; i >= 0; i--) {
+		freeSlots.push_back(i);
+	}
+
+	Log::info("VIRTUAL_TEXTURE atlas {}x{} ({} tiles, {} MB)", size, size, slotCount, getAtlasSizeInBytes() >> 20);
+}
+
+
+VirtualTextureCache::~VirtualTextureCache() {
+	for (Readback& readback : readbacks) {
+		if (readback.fence != nullptr) {
+			glDeleteSync(readback.fence);
+		}
+	}
+}
+
+
+VirtualTexture* VirtualTextureCache::load(const std::string& path) {
+	std::unique_ptr<VirtualTexture> texture(new VirtualTexture());
+	if (!texture->file.open(path)) {
+		return nullptr;
+	}
+	if (!texture->file.isSrgb()) {
+		Log::error("VIRTUAL_TEXTURE {} is not sRGB, the atlas only holds color maps", path);
+		return nullptr;
+	}
+
+	const VirtualTextureFile& file = texture->file;
+	const int id = int(textures.size());
+	texture->atlas = atlas;
+	texture->parameters = glm::vec4(file.getWidth(), file.getHeight(), file.getLevels().size(), id + 1);
+	texture->createIndirection();
+	textures.push_back(std::move(texture));
+
+	// The coarsest tile is the fallback for everything else
+	int top = int(file.getLevels().size()) - 1;
+	if (!uploadTile(id, top, 0, 0, true)) {
+		Log::error("VIRTUAL_TEXTURE atlas is full, can't load {}", path);
+		textures.pop_back();
+		return nullptr;
+	}
+	textures.back()->uploadIndirection();
+
+	Log::info("VIRTUAL_TEXTURE {} ({}x{}, {} levels)", path, file.getWidth(), file.getHeight(), file.getLevels().size());
+	return textures.back().get();
+}
+
+
+void VirtualTextureCache::setUniforms(GLuint program, bool feedback) const {
+	GLStats::uniform(glGetUniformLocation(program, "indirection"), 1);
+	GLStats::uniform(glGetUniformLocation(program, "vtAtlasTiles"), float(atlasTilesPerSide));
+
+	// Feedback pixels cover feedbackDivisor^2 screen pixels, so their UV
+	// derivatives are that much larger; bias the level back to what the
+	// full resolution pass will pick
+	float bias = feedback ? -std::log2(float(feedbackDivisor)) : 0.0f;
+	GLStats::uniform(glGetUniformLocation(program, "vtLodBias"), bias);
+}
+
+
+void VirtualTextureCache::beginFeedback() {
+	glGetIntegerv(GL_VIEWPORT, savedViewport);
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &savedFramebuffer);
+	int width = std::max(1, savedViewport[2] / feedbackDivisor);
+	int height = std::max(1, savedViewport[3] / feedbackDivisor);
+
+	if (width != feedbackWidth || height != feedbackHeight) {
+		feedbackWidth = width;
+		feedbackHeight = height;
+
+		GLStats::bindTexture(GL_TEXTURE_2D, feedbackColor);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16UI, width, height, 0, GL_RGBA_INTEGER, GL_UNSIGNED_SHORT, nullptr);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		GLStats::bindTexture(GL_TEXTURE_2D, 0);
+
+		glBindRenderbuffer(GL_RENDERBUFFER, feedbackDepth);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+		glBindRenderbuffer(GL_RENDERBUFFER, 0);
+		feedbackColor.track(MemoryCategory::RenderTargets, "virtual texture feedback", size_t(width) * height * 4 * sizeof(uint16_t));
+		feedbackDepth.track(MemoryCategory::RenderTargets, "virtual texture feedback", size_t(width) * height * 4);
+
+		glBindFramebuffer(GL_FRAMEBUFFER, feedbackFramebuffer);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, feedbackColor, 0);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, feedbackDepth);
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+			Log::error("VIRTUAL_TEXTURE feedback framebuffer incomplete");
+		}
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, feedbackFramebuffer);
+	glViewport(0, 0, width, height);
+
+	const GLuint none[4] = { 0, 0, 0, 0 };
+	glClearBufferuiv(GL_COLOR, 0, none);
+	glClear(GL_DEPTH_BUFFER_BIT);
+}
+
+
+void VirtualTextureCache::endFeedback() {
+	// Skip a frame of feedback rather than stall if the ring is still busy
+	Readback& readback = readbacks[nextReadback];
+	if (readback.fence == nullptr) {
+		size_t bytes = size_t(feedbackWidth) * feedbackHeight * 4 * sizeof(uint16_t);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+		glBufferData(GL_PIXEL_PACK_BUFFER, GLsizeiptr(bytes), nullptr, GL_STREAM_READ);
+		readback.buffer.track(MemoryCategory::TransferBuffers, "virtual texture feedback", bytes);
+		glReadPixels(0, 0, feedbackWidth, feedbackHeight, GL_RGBA_INTEGER, GL_UNSIGNED_SHORT, nullptr);
+		GLStats::record(GLCall::Readback, bytes);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+		readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		readback.width = feedbackWidth;
+		readback.height = feedbackHeight;
+		nextReadback = (nextReadback + 1) % 3;
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, GLuint(savedFramebuffer));
+	glViewport(savedViewport[0], savedViewport[1], savedViewport[2], savedViewport[3]);
+}
+
+
+void VirtualTextureCache::collectRequests(const uint16_t* pixels, size_t count) {
+	for (size_t i = 0; i < count; i++) {
+		const uint16_t* p = &pixels[i * 4];
+		if (p[3] == 0 || p[3] > textures.size()) {
+			continue; // background, or garbage
+		}
+		int texture = p[3] - 1;
+		const std::vector<VirtualTextureLevel>& levels = textures[texture]->file.getLevels();
+		int level = std::min<int>(p[2], int(levels.size()) - 1);
+		int x = std::min<int>(p[0], levels[level].tilesX - 1);
+		int y = std::min<int>(p[1], levels[level].tilesY - 1);
+		requests.push_back(tileKey(texture, level, x, y));
+	}
+}
+
+
+int VirtualTextureCache::acquireSlot() {
+	if (!freeSlots.empty()) {
+		int slot = freeSlots.back();
+		freeSlots.pop_back();
+		return slot;
+	}
+
+	// Least recently used tile, unless it was needed by this frame's
+	// feedback too: then the atlas is too small for the view and evicting
+	// would only thrash
+	if (lru.empty() || slots[lru.back()].lastUsed == frame) {
+		return -1;
+	}
+	int slot = lru.back();
+	lru.pop_back();
+
+	Slot& old = slots[slot];
+	VirtualTexture& owner = *textures[old.texture];
+	const VirtualTextureLevel& level = owner.file.getLevels()[old.level];
+	owner.tables[old.level].slots[size_t(old.y) * level.tilesX + old.x] = -1;
+	owner.refresh(old.level, old.x, old.y, atlasTilesPerSide);
+	residentTiles.erase(tileKey(old.texture, old.level, old.x, old.y));
+	old.texture = -1;
+	stats.evictedTiles++;
+	return slot;
+}
+
+
+bool VirtualTextureCache::uploadTile(int texture, int level, int x, int y, bool pinned) {
+	int slot = acquireSlot();
+	if (slot < 0) {
+		return false;
+	}
+
+	VirtualTexture& owner = *textures[texture];
+	const int size = VirtualTextureFile::paddedTileSize;
+	GLStats::bindTexture(GL_TEXTURE_2D, atlas);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, (slot % atlasTilesPerSide) * size, (slot / atlasTilesPerSide) * size,
+		size, size, GL_RGBA, GL_UNSIGNED_BYTE, owner.file.getTile(level, x, y));
+	GLStats::record(GLCall::TextureUpload, size_t(size) * size * 4);
+	GLStats::bindTexture(GL_TEXTURE_2D, 0);
+
+	Slot& s = slots[slot];
+	s.texture = texture;
+	s.level = level;
+	s.x = x;
+	s.y = y;
+	s.lastUsed = frame;
+	s.pinned = pinned;
+	if (!pinned) {
+		lru.push_front(slot);
+		s.lru = lru.begin();
+	}
+	residentTiles[tileKey(texture, level, x, y)] = slot;
+
+	const VirtualTextureLevel& info = owner.file.getLevels()[level];
+	owner.tables[level].slots[size_t(y) * info.tilesX + x] = slot;
+	owner.refresh(level, x, y, atlasTilesPerSide);
+	stats.uploadedTiles++;
+	return true;
+}
+
+
+void VirtualTextureCache::update() {
+	stats.uploadedTiles = 0;
+	stats.evictedTiles = 0;
+
+	// Oldest readback first; each one still in flight ends the scan
+	requests.clear();
+	bool received = false;
+	for (unsigned int i = 0; i < 3; i++) {
+		Readback& readback = readbacks[(nextReadback + i) % 3];
+		if (readback.fence == nullptr) {
+			continue;
+		}
+		GLenum result = glClientWaitSync(readback.fence, 0, 0);
+		if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED) {
+			break;
+		}
+		glDeleteSync(readback.fence);
+		readback.fence = nullptr;
+
+		size_t count = size_t(readback.width) * readback.height;
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+		const void* pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, GLsizeiptr(count * 4 * sizeof(uint16_t)), GL_MAP_READ_BIT);
+		if (pixels != nullptr) {
+			collectRequests(static_cast<const uint16_t*>(pixels), count);
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+			received = true;
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	}
+
+	if (received) {
+		std::sort(requests.begin(), requests.end());
+		requests.erase(std::unique(requests.begin(), requests.end()), requests.end());
+		stats.requestedTiles = unsigned(requests.size());
+
+		// Touch what is already resident; queue the rest together with their
+		// missing ancestors, so detail refines progressively instead of
+		// jumping straight from the coarsest tile to the finest. Requests
+		// share ancestors, so the list is deduplicated afterwards.
+		ScratchScope scratch;
+		ArenaVector<uint64_t> missing;
+		missing.reserve(requests.size() * 2);
+		for (uint64_t key : requests) {
+			int texture = keyTexture(key), level = keyLevel(key), x = keyX(key), y = keyY(key);
+			const std::vector<VirtualTextureLevel>& levels = textures[texture]->file.getLevels();
+			while (level < int(levels.size())) {
+				auto resident = residentTiles.find(tileKey(texture, level, x, y));
+				if (resident != residentTiles.end()) {
+					Slot& slot = slots[resident->second];
+					slot.lastUsed = frame;
+					if (!slot.pinned) {
+						lru.splice(lru.begin(), lru, slot.lru);
+					}
+					break;
+				}
+				missing.push_back(tileKey(texture, level, x, y));
+				level++;
+				if (level < int(levels.size())) {
+					x = std::min(x >> 1, levels[level].tilesX - 1);
+					y = std::min(y >> 1, levels[level].tilesY - 1);
+				}
+			}
+		}
+
+		// coarse tiles first, they cover the most screen
+		std::sort(missing.begin(), missing.end(), [](uint64_t a, uint64_t b) {
+			return keyLevel(a) != keyLevel(b) ? keyLevel(a) > keyLevel(b) : a < b;
+		});
+		missing.erase(std::unique(missing.begin(), missing.end()), missing.end());
+		int budget = tilesPerFrame;
+		for (uint64_t key : missing) {
+			if (budget-- == 0 || !uploadTile(keyTexture(key), keyLevel(key), keyX(key), keyY(key), false)) {
+				break;
+			}
+		}
+	}
+
+	for (std::unique_ptr<VirtualTexture>& texture : textures) {
+		texture->uploadIndirection();
+	}
+	stats.residentTiles = unsigned(residentTiles.size());
+	frame++;
+}
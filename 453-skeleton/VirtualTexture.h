@@ -0,0 +1,163 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// This file contains sparse virtual texturing.
+//
+// A virtual texture is a tile pyramid on disk (see VirtualTextureFile.h) of
+// which only the tiles currently needed on screen are resident. They live in
+// one physical atlas shared by every virtual texture, so VRAM use is fixed by
+// the atlas size no matter how large the source maps are.
+//
+// Each frame:
+//  1. the virtual textured bodies are drawn into a small feedback buffer with
+//     the VT_FEEDBACK shader variant, which writes the tile (x, y, level,
+//     texture) every pixel wants;
+//  2. the buffer is read back asynchronously through a ring of PBOs;
+//  3. update() consumes finished readbacks, keeps requested tiles in an LRU,
+//     streams missing ones from the mapped file into free or least recently
+//     used atlas slots, and rewrites the indirection tables.
+//
+// The indirection table of a texture is a mipmapped RGBA8UI texture with one
+// texel per tile: atlas slot x, y and the level of the tile actually resident
+// for it, which is the tile itself or its closest resident ancestor. The
+// single coarsest tile of every texture is pinned, so every lookup resolves.
+//------------------------------------------------------------------------------
+
+#include "GLHandles.h"
+#include "VirtualTextureFile.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+class VirtualTexture {
+
+public:
+	// Public interface
+	const VirtualTextureFile& getFile() const { return file; }
+	GLuint getAtlas() const { return atlas; }
+	GLuint getIndirection() const { return indirection; }
+
+	// (width, height, levels, feedback id) for DrawPacket::parameters
+	const glm::vec4& getParameters() const { return parameters; }
+
+private:
+	friend class VirtualTextureCache;
+
+	struct LevelTable {
+		std::vector<int> slots;      // atlas slot of each tile, or -1
+		std::vector<uint8_t> entries; // RGBA8UI indirection texels
+		bool dirty = true;
+	};
+
+	VirtualTextureFile file;
+	GLuint atlas = 0;
+	TextureHandle indirection;
+	glm::vec4 parameters;
+	std::vector<LevelTable> tables;
+
+	void createIndirection();
+
+	// Recomputes the indirection entries of a tile and everything below it
+	void refresh(int level, int x, int y, int atlasTilesPerSide);
+	void uploadIndirection();
+};
+
+
+class VirtualTextureCache {
+
+public:
+	// The atlas holds atlasTilesPerSide^2 tiles. Feedback is rendered at
+	// 1/feedbackDivisor of the viewport resolution. At most tilesPerFrame tiles
+	// are streamed into the atlas per update().
+	VirtualTextureCache(int atlasTilesPerSide = 16, int feedbackDivisor = 8, int tilesPerFrame = 16);
+	~VirtualTextureCache();
+
+	// Owns GL sync objects
+	VirtualTextureCache(const VirtualTextureCache&) = delete;
+	VirtualTextureCache operator=(const VirtualTextureCache&) = delete;
+
+	struct Stats {
+		unsigned int residentTiles = 0;
+		unsigned int requestedTiles = 0; // distinct tiles in the last feedback
+		unsigned int uploadedTiles = 0;  // last update()
+		unsigned int evictedTiles = 0;   // last update()
+	};
+
+	// Public interface
+	// Maps a .vtx file and pins its coarsest tile. Returns nullptr (and logs)
+	// on failure. The texture lives as long as the cache.
+	VirtualTexture* load(const std::string& path);
+
+	// Sets the sampler unit, atlas layout and LOD bias uniforms of a program
+	// using the VIRTUAL_TEXTURE (and VT_FEEDBACK) variant
+	void setUniforms(GLuint program, bool feedback) const;
+
+	// Draws between these two go to the feedback buffer instead of the
+	// current framebuffer. endFeedback() restores the framebuffer and viewport
+	// that were current in beginFeedback().
+	void beginFeedback();
+	void endFeedback();
+
+	// Consumes finished feedback and streams tiles. Call once per frame.
+	void update();
+
+	const Stats& getStats() const { return stats; }
+	size_t getAtlasSizeInBytes() const { return size_t(atlasTilesPerSide) * atlasTilesPerSide * VirtualTextureFile::tileSizeInBytes; }
+
+private:
+	struct Slot {
+		int texture = -1; // index into textures, -1 when free
+		int level = 0;
+		int x = 0;
+		int y = 0;
+		uint64_t lastUsed = 0;
+		bool pinned = false;
+		std::list<int>::iterator lru;
+	};
+
+	struct Readback {
+		VertexBufferHandle buffer;
+		GLsync fence = nullptr;
+		int width = 0;
+		int height = 0;
+	};
+
+	int atlasTilesPerSide;
+	int feedbackDivisor;
+	int tilesPerFrame;
+
+	TextureHandle atlas;
+	std::vector<std::unique_ptr<VirtualTexture>> textures;
+
+	std::vector<Slot> slots;
+	std::list<int> lru;           // slot indices, most recently used first
+	std::vector<int> freeSlots;
+	std::unordered_map<uint64_t, int> residentTiles; // tile key -> slot
+
+	FramebufferHandle feedbackFramebuffer;
+	TextureHandle feedbackColor;
+	RenderbufferHandle feedbackDepth;
+	int feedbackWidth;
+	int feedbackHeight;
+	GLint savedViewport[4];
+	GLint savedFramebuffer;
+
+	Readback readbacks[3];
+	unsigned int nextReadback;
+
+	std::vector<uint64_t> requests;
+	uint64_t frame;
+	Stats stats;
+
+	bool uploadTile(int texture, int level, int x, int y, bool pinned);
+	int acquireSlot();
+	void collectRequests(const uint16_t* pixels, size_t count);
+};
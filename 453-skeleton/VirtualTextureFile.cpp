@@ -0,0 +1,138 @@
+#include "VirtualTextureFile.h"
+
+#include "Log.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace {
+	constexpr uint32_t magic = 0x31585456; // "VTX1"
+	constexpr uint32_t flagSrgb = 1u << 0;
+
+	struct FileHeader {
+		uint32_t magic;
+		uint32_t flags;
+		uint32_t width;
+		uint32_t height;
+		uint32_t levelCount;
+		uint32_t tileSize;
+		uint32_t tileBorder;
+		uint32_t reserved;
+	};
+
+	// Copies tile (tx, ty) of level plus its border into tile
+	void extractTile(const ImageLevel& level, int tx, int ty, uint8_t* tile) {
+		const int size = VirtualTextureFile::paddedTileSize;
+		for (int y = 0; y < size; y++) {
+			int sy = std::clamp(ty * VirtualTextureFile::tileSize - VirtualTextureFile::tileBorder + y, 0, level.height - 1);
+			for (int x = 0; x < size; x++) {
+				int sx = tx * VirtualTextureFile::tileSize - VirtualTextureFile::tileBorder + x;
+				sx = ((sx % level.width) + level.width) % level.width;
+				std::memcpy(&tile[(size_t(y) * size + x) * 4], &level.data[(size_t(sy) * level.width + sx) * 4], 4);
+			}
+		}
+	}
+}
+
+
+std::vector<VirtualTextureLevel> virtualTextureLevels(int width, int height) {
+	auto tiles = [](int texels) { return (texels + VirtualTextureFile::tileSize - 1) / VirtualTextureFile::tileSize; };
+
+	std::vector<VirtualTextureLevel> levels;
+	size_t firstTile = 0;
+	while (true) {
+		VirtualTextureLevel level{ width, height, tiles(width), tiles(height), firstTile };
+		levels.push_back(level);
+		firstTile += size_t(level.tilesX) * level.tilesY;
+		if (level.tilesX == 1 && level.tilesY == 1) {
+			break;
+		}
+		width = std::max(1, width / 2);
+		height = std::max(1, height / 2);
+	}
+	return levels;
+}
+
+
+bool VirtualTextureFile::open(const std::string& path) {
+	levels.clear();
+	if (!file.open(path)) {
+		return false;
+	}
+
+	FileHeader header{};
+	if (file.size() < sizeof(header)) {
+		Log::error("VIRTUAL_TEXTURE {} is truncated", path);
+		return false;
+	}
+	std::memcpy(&header, file.data(), sizeof(header));
+	if (header.magic != magic || header.tileSize != tileSize || header.tileBorder != tileBorder || header.width == 0 || header.height == 0) {
+		Log::error("VIRTUAL_TEXTURE {} is not a virtual texture with {}px tiles", path, tileSize);
+		return false;
+	}
+
+	width = int(header.width);
+	height = int(header.height);
+	srgb = (header.flags & flagSrgb) != 0;
+	levels = virtualTextureLevels(width, height);
+	dataOffset = sizeof(header);
+
+	size_t tileCount = levels.back().firstTile + 1;
+	if (header.levelCount != levels.size() || file.size() < dataOffset + tileCount * tileSizeInBytes) {
+		Log::error("VIRTUAL_TEXTURE {} is truncated", path);
+		levels.clear();
+		return false;
+	}
+	return true;
+}
+
+
+const uint8_t* VirtualTextureFile::getTile(int level, int x, int y) const {
+	const VirtualTextureLevel& l = levels[level];
+	size_t index = l.firstTile + size_t(y) * l.tilesX + x;
+	return file.data() + dataOffset + index * tileSizeInBytes;
+}
+
+
+bool writeVirtualTexture(const std::string& path, const Image& image) {
+	std::vector<VirtualTextureLevel> levels = virtualTextureLevels(image.getWidth(), image.getHeight());
+	if (image.format != PixelFormat::RGBA8 || image.levels.size() < levels.size()) {
+		Log::error("VIRTUAL_TEXTURE {} needs an uncompressed RGBA8 image with a full mip chain", path);
+		return false;
+	}
+
+	FileHeader header{ magic, image.srgb ? flagSrgb : 0u, uint32_t(image.getWidth()), uint32_t(image.getHeight()),
+		uint32_t(levels.size()), VirtualTextureFile::tileSize, VirtualTextureFile::tileBorder, 0 };
+
+	// write to a temporary and rename, so a crash never leaves a half-written file
+	std::filesystem::path temporary = path;
+	temporary += ".tmp";
+	{
+		std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+		std::vector<uint8_t> tile(VirtualTextureFile::tileSizeInBytes);
+		for (size_t i = 0; i < levels.size(); i++) {
+			for (int y = 0; y < levels[i].tilesY; y++) {
+				for (int x = 0; x < levels[i].tilesX; x++) {
+					extractTile(image.levels[i], x, y, tile.data());
+					out.write(reinterpret_cast<const char*>(tile.data()), tile.size());
+				}
+			}
+		}
+		if (!out) {
+			Log::error("VIRTUAL_TEXTURE could not write {}", temporary.string());
+			return false;
+		}
+	}
+
+	std::error_code ec;
+	std::filesystem::rename(temporary, path, ec);
+	if (ec) {
+		Log::error("VIRTUAL_TEXTURE could not write {}: {}", path, ec.message());
+		return false;
+	}
+	return true;
+}
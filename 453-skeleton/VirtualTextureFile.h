@@ -0,0 +1,76 @@
+#pragma once
+
+//------------------------------------------------------------------------------
+// On-disk tile pyramid of a virtual texture (.vtx).
+//
+// Every mip level of the source map is cut into tileSize x tileSize RGBA8
+// tiles, each stored with a tileBorder texel border so it can be bilinearly
+// filtered on its own once copied into the physical atlas. Tiles are fixed
+// size and stored densely, level 0 first and row-major within a level, so a
+// tile's location is a simple computation and the file can be memory mapped
+// and read one tile at a time. Borders wrap horizontally and clamp vertically,
+// which is right for the equirectangular planet maps this is used for.
+//
+// The pyramid stops at the first level that fits in a single tile. Tile
+// counts per level are laid out like a GL mip chain over the next power of
+// two of the level 0 tile count, so the indirection table can be an ordinary
+// mipmapped texture.
+//
+// Like TextureContainer this doesn't touch OpenGL; texture-import writes it.
+//------------------------------------------------------------------------------
+
+#include "Image.h"
+#include "MappedFile.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+struct VirtualTextureLevel {
+	int width = 0;  // in texels
+	int height = 0;
+	int tilesX = 0; // tiles actually stored for this level
+	int tilesY = 0;
+	size_t firstTile = 0;
+};
+
+
+class VirtualTextureFile {
+
+public:
+	static constexpr const char* extension = ".vtx";
+	static constexpr int tileSize = 128;
+	static constexpr int tileBorder = 4;
+	static constexpr int paddedTileSize = tileSize + 2 * tileBorder;
+	static constexpr size_t tileSizeInBytes = size_t(paddedTileSize) * paddedTileSize * 4;
+
+	// Public interface
+	// Maps and validates the file. Logs and returns false on failure.
+	bool open(const std::string& path);
+
+	int getWidth() const { return width; }
+	int getHeight() const { return height; }
+	bool isSrgb() const { return srgb; }
+	const std::vector<VirtualTextureLevel>& getLevels() const { return levels; }
+
+	// Padded RGBA8 texels of a tile, pointing into the mapping
+	const uint8_t* getTile(int level, int x, int y) const;
+
+private:
+	MappedFile file;
+	int width = 0;
+	int height = 0;
+	bool srgb = false;
+	std::vector<VirtualTextureLevel> levels;
+	size_t dataOffset = 0;
+};
+
+
+// Levels of the tile pyramid for a width x height map, see above
+std::vector<VirtualTextureLevel> virtualTextureLevels(int width, int height);
+
+// Writes the tile pyramid of an RGBA8 image. The image needs its full mip
+// chain (generateMipChain).
+bool writeVirtualTexture(const std::string& path, const Image& image);
@@ -42,6 +42,12 @@ void Window::windowSizeMetaCallback(GLFWwindow* window, int width, int height) {
 }
 
 
+void Window::windowRefreshMetaCallback(GLFWwindow* window) {
+	CallbackInterface* callbacks = static_cast<CallbackInterface*>(glfwGetWindowUserPointer(window));
+	callbacks->windowRefreshCallback();
+}
+
+
 // ----------------------
 // non-static definitions
 // ----------------------
@@ -106,6 +112,7 @@ void Window::connectCallbacks() {
 	glfwSetCursorPosCallback(window.get(), cursorPosMetaCallback);
 	glfwSetScrollCallback(window.get(), scrollMetaCallback);
 	glfwSetWindowSizeCallback(window.get(), windowSizeMetaCallback);
+	glfwSetWindowRefreshCallback(window.get(), windowRefreshMetaCallback);
 }
 
 
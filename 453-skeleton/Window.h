@@ -23,6 +23,7 @@ public:
 	virtual void cursorPosCallback(double xpos, double ypos) {}
 	virtual void scrollCallback(double xoffset, double yoffset) {}
 	virtual void windowSizeCallback(int width, int height) { glViewport(0, 0, width, height); }
+	virtual void windowRefreshCallback() {} // contents damaged, e.g. uncovered
 };
 
 
@@ -63,6 +64,9 @@ public:
 	void makeContextCurrent() { glfwMakeContextCurrent(window.get()); }
 	void swapBuffers() { glfwSwapBuffers(window.get()); }
 
+	// e.g. to create contexts sharing this one's objects
+	GLFWwindow* getGLFWwindow() const { return window.get(); }
+
 private:
 	std::unique_ptr<GLFWwindow, WindowDeleter> window; // owning ptr (from GLFW)
 	std::shared_ptr<CallbackInterface> callbacks;      // optional shared owning ptr (user provided)
@@ -78,5 +82,6 @@ private:
 	static void cursorPosMetaCallback(GLFWwindow* window, double xpos, double ypos);
 	static void scrollMetaCallback(GLFWwindow* window, double xoffset, double yoffset);
 	static void windowSizeMetaCallback(GLFWwindow* window, int width, int height);
+	static void windowRefreshMetaCallback(GLFWwindow* window);
 };
 
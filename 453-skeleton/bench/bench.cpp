@@ -0,0 +1,529 @@
+//------------------------------------------------------------------------------
+// bench: micro-benchmarks over the GL-free core library (solar-core).
+//
+//	bench [--filter TEXT] [--min-time SECONDS] [--repetitions N]
+//	      [--json PATH] [--texture PATH]
+//
+//	--filter       only run benchmarks whose name contains TEXT
+//	--min-time     seconds each repetition runs for at least (default 0.2)
+//	--repetitions  repetitions per benchmark; the median is reported (default 5)
+//	--json         also write the results to PATH
+//	--texture      image used by the decode benchmarks
+//	               (default textures/2k_moon.jpg)
+//
+// Every benchmark is parameterized (tessellation step, body count, thread
+// count) and reports ns/op and items per second. The JSON uses Google
+// Benchmark's field names (name, iterations, real_time, cpu_time, time_unit,
+// items_per_second), so its compare.py can diff two runs. Build in Release
+// for meaningful numbers.
+//------------------------------------------------------------------------------
+
+#include "BodyBvh.h"
+#include "BodyCatalog.h"
+#include "BodyMotion.h"
+#include "BodyStore.h"
+#include "Image.h"
+#include "Log.h"
+#include "Sphere.h"
+
+#include <argh.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtx/transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace {
+
+	// Keeps the compiler from optimizing away a result nobody reads
+	template <typename T>
+	void keep(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+		asm volatile("" : : "g"(&value) : "memory");
+#else
+		static volatile const void* sink;
+		sink = &value;
+#endif
+	}
+
+
+	struct Result {
+		std::string name;
+		uint64_t iterations = 0;
+		double realNs = 0.0; // per iteration
+		double cpuNs = 0.0;
+		double itemsPerSecond = 0.0;
+	};
+
+
+	// Runs one operation in a loop until a repetition takes at least minTime,
+	// repeats that, and keeps the median repetition
+	class Runner {
+
+	public:
+		// body(iterations) performs the operation that many times and returns
+		// the number of items it processed
+		using Body = std::function<uint64_t(uint64_t)>;
+
+		Runner(std::string filter, double minTime, int repetitions)
+			: filter(std::move(filter)), minTime(minTime), repetitions(repetitions)
+		{}
+
+		void run(const std::string& name, const Body& body) {
+			if (!filter.empty() && name.find(filter) == std::string::npos) {
+				return;
+			}
+
+			// grow the iteration count until one run is long enough
+			uint64_t iterations = 1;
+			while (true) {
+				double seconds = measure(body, iterations).first;
+				if (seconds >= minTime || iterations >= (uint64_t(1) << 40)) {
+					break;
+				}
+				double scale = seconds > 0.0 ? 1.4 * minTime / seconds : 10.0;
+				iterations = std::max(iterations + 1, uint64_t(double(iterations) * std::min(scale, 10.0)));
+			}
+
+			std::vector<Result> runs;
+			for (int i = 0; i < repetitions; i++) {
+				uint64_t items = 0;
+				auto [seconds, cpuSeconds] = measure(body, iterations, &items);
+				Result run;
+				run.name = name;
+				run.iterations = iterations;
+				run.realNs = seconds * 1e9 / double(iterations);
+				run.cpuNs = cpuSeconds * 1e9 / double(iterations);
+				run.itemsPerSecond = seconds > 0.0 ? double(items) / seconds : 0.0;
+				runs.push_back(run);
+			}
+			std::sort(runs.begin(), runs.end(), [](const Result& a, const Result& b) { return a.realNs < b.realNs; });
+			const Result& median = runs[runs.size() / 2];
+
+			Log::info("{:<40} {:>12} it {:>14.1f} ns/op {:>14.4g} items/s",
+				name, median.iterations, median.realNs, median.itemsPerSecond);
+			results.push_back(median);
+		}
+
+		const std::vector<Result>& getResults() const { return results; }
+
+	private:
+		std::string filter;
+		double minTime;
+		int repetitions;
+		std::vector<Result> results;
+
+		// wall and process CPU seconds
+		static std::pair<double, double> measure(const Body& body, uint64_t iterations, uint64_t* items = nullptr) {
+			std::clock_t cpuStart = std::clock();
+			auto start = std::chrono::steady_clock::now();
+			uint64_t processed = body(iterations);
+			std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+			std::clock_t cpuEnd = std::clock();
+			if (items != nullptr) {
+				*items = processed;
+			}
+			return { elapsed.count(), double(cpuEnd - cpuStart) / double(CLOCKS_PER_SEC) };
+		}
+	};
+
+
+	// Fixed set of threads that split a loop between them and the caller
+	class WorkerPool {
+
+	public:
+		explicit WorkerPool(int threadCount)
+			: generation(0), remaining(0), stopping(false)
+		{
+			for (int i = 1; i < threadCount; i++) {
+				threads.emplace_back([this, i] { work(i); });
+			}
+		}
+
+		~WorkerPool() {
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				stopping = true;
+			}
+			wake.notify_all();
+			for (std::thread& thread : threads) {
+				thread.join();
+			}
+		}
+
+		WorkerPool(const WorkerPool&) = delete;
+		WorkerPool operator=(const WorkerPool&) = delete;
+
+		int size() const { return int(threads.size()) + 1; }
+
+		// Calls job(begin, end) on contiguous slices of [0, count)
+		void parallelFor(size_t count, const std::function<void(size_t, size_t)>& job) {
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				current = &job;
+				currentCount = count;
+				remaining = int(threads.size());
+				generation++;
+			}
+			wake.notify_all();
+			runSlice(0, job, count);
+
+			std::unique_lock<std::mutex> lock(mutex);
+			done.wait(lock, [this] { return remaining == 0; });
+		}
+
+	private:
+		std::vector<std::thread> threads;
+		std::mutex mutex;
+		std::condition_variable wake;
+		std::condition_variable done;
+		const std::function<void(size_t, size_t)>* current = nullptr;
+		size_t currentCount = 0;
+		uint64_t generation;
+		int remaining;
+		bool stopping;
+
+		void runSlice(int index, const std::function<void(size_t, size_t)>& job, size_t count) const {
+			size_t begin = count * size_t(index) / size_t(size());
+			size_t end = count * size_t(index + 1) / size_t(size());
+			if (begin < end) {
+				job(begin, end);
+			}
+		}
+
+		void work(int index) {
+			uint64_t seen = 0;
+			while (true) {
+				const std::function<void(size_t, size_t)>* job;
+				size_t count;
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+					wake.wait(lock, [&] { return stopping || generation != seen; });
+					if (stopping) {
+						return;
+					}
+					seen = generation;
+					job = current;
+					count = currentCount;
+				}
+				runSlice(index, *job, count);
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					remaining--;
+				}
+				done.notify_one();
+			}
+		}
+	};
+
+
+	// Bodies in a tree (the parent of i is (i - 1) / 2), so every parent comes
+	// before its children like the sun, earth and moon in the application
+	std::vector<std::unique_ptr<BodyMotion>> makeBodies(size_t count) {
+		std::vector<std::unique_ptr<BodyMotion>> bodies;
+		bodies.reserve(count);
+		for (size_t i = 0; i < count; i++) {
+			const BodyMotion* parent = i == 0 ? nullptr : bodies[(i - 1) / 2].get();
+			float f = float(i % 97) / 97.0f;
+			bodies.push_back(std::make_unique<BodyMotion>(
+				0.5f + f, 0.1f + 0.2f * f, 0.4f * f, 0.3f * f, parent, parent ? 1.0f + f : 0.0f));
+		}
+		return bodies;
+	}
+
+
+	void sphereBenchmarks(Runner& runner) {
+		for (float step : { 0.1f, 0.05f, 0.025f }) {
+			runner.run(fmt::format("sphere/generate/step:{}", step), [step](uint64_t iterations) {
+				std::vector<glm::vec3> verts;
+				std::vector<glm::vec2> texCoords;
+				uint64_t items = 0;
+				for (uint64_t i = 0; i < iterations; i++) {
+					generateSphere(1.0f, step, verts, texCoords);
+					keep(verts.data());
+					items += verts.size();
+				}
+				return items;
+			});
+		}
+
+		// the per-frame normal update of every body, split across threads
+		int hardwareThreads = std::max(1, int(std::thread::hardware_concurrency()));
+		std::vector<int> threadCounts = { 1, 2, 4 };
+		if (hardwareThreads > 4) {
+			threadCounts.push_back(hardwareThreads);
+		}
+		for (float step : { 0.1f, 0.025f }) {
+			for (size_t bodyCount : { size_t(3), size_t(64) }) {
+				std::vector<glm::vec3> verts;
+				std::vector<glm::vec2> texCoords;
+				generateSphere(1.0f, step, verts, texCoords);
+
+				for (int threads : threadCounts) {
+					std::string name = fmt::format("sphere/normals/step:{}/bodies:{}/threads:{}", step, bodyCount, threads);
+					runner.run(name, [&, bodyCount, threads](uint64_t iterations) {
+						WorkerPool pool(threads);
+						std::vector<std::vector<glm::vec3>> normals(bodyCount);
+						for (uint64_t i = 0; i < iterations; i++) {
+							pool.parallelFor(bodyCount, [&](size_t begin, size_t end) {
+								for (size_t b = begin; b < end; b++) {
+									sphereNormals(verts, glm::vec3(float(b), 0.0f, 0.0f), normals[b]);
+									keep(normals[b].data());
+								}
+							});
+						}
+						return iterations * bodyCount * verts.size();
+					});
+				}
+			}
+		}
+	}
+
+
+	void motionBenchmarks(Runner& runner) {
+		for (size_t bodyCount : { size_t(3), size_t(1000), size_t(100000) }) {
+			runner.run(fmt::format("motion/advance/bodies:{}", bodyCount), [bodyCount](uint64_t iterations) {
+				auto bodies = makeBodies(bodyCount);
+				for (uint64_t i = 0; i < iterations; i++) {
+					for (auto& body : bodies) {
+						body->advance(1.0f / 60.0f, 1.0f);
+					}
+					keep(bodies.back()->getTranslation());
+				}
+				return iterations * bodyCount;
+			});
+
+			// model-view-projection of every body, as a CPU side renderer
+			// would upload it
+			runner.run(fmt::format("motion/compose/bodies:{}", bodyCount), [bodyCount](uint64_t iterations) {
+				auto bodies = makeBodies(bodyCount);
+				glm::mat4 PV = glm::perspective(0.8f, 1.0f, 0.01f, 1000.0f)
+					* glm::lookAt(glm::vec3(0.0f, 1.0f, 3.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+				std::vector<glm::mat4> mvp(bodyCount);
+				for (uint64_t i = 0; i < iterations; i++) {
+					for (size_t b = 0; b < bodyCount; b++) {
+						mvp[b] = PV * bodies[b]->getTranslation() * bodies[b]->getRotation();
+					}
+					keep(mvp.data());
+				}
+				return iterations * bodyCount;
+			});
+		}
+	}
+
+
+	// Opening a catalog and placing all of its bodies, as a scene load does
+	void catalogBenchmarks(Runner& runner) {
+		for (size_t bodyCount : { size_t(1000), size_t(1000000) }) {
+			std::string name = fmt::format("catalog/load/bodies:{}", bodyCount);
+			std::filesystem::path path = std::filesystem::temp_directory_path() / fmt::format("bench-{}{}", bodyCount, BodyCatalog::extension);
+			runner.run(name, [&path, bodyCount](uint64_t iterations) {
+				if (!std::filesystem::exists(path)) {
+					std::mt19937 random(1);
+					std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+					BodyCatalogData data;
+					for (size_t i = 0; i < bodyCount; i++) {
+						data.semiMajorAxis.push_back(3e6f + 2e6f * unit(random));
+						data.eccentricity.push_back(0.2f * unit(random));
+						data.inclination.push_back(0.1f * unit(random));
+						data.ascendingNode.push_back(6.28f * unit(random));
+						data.argumentOfPeriapsis.push_back(6.28f * unit(random));
+						data.meanAnomaly.push_back(6.28f * unit(random));
+						data.meanMotion.push_back(1e-6f);
+						data.radius.push_back(1000.0f);
+						data.texture.push_back(BodyCatalog::noTexture);
+						data.parent.push_back(-1);
+					}
+					writeBodyCatalog(path.string(), data);
+				}
+
+				for (uint64_t i = 0; i < iterations; i++) {
+					BodyCatalog catalog;
+					BodyStore store;
+					if (catalog.open(path.string())) {
+						store.append(catalog, 0.0, 1e-6f);
+					}
+					keep(store.x.data());
+				}
+				return iterations * bodyCount;
+			});
+			std::filesystem::remove(path);
+		}
+	}
+
+
+	// Bodies scattered through a disc, like a belt seen from the scene
+	BodyStore makeBelt(size_t bodyCount) {
+		std::mt19937 random(1);
+		std::uniform_real_distribution<float> radius(2.0f, 3.5f);
+		std::uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+		std::normal_distribution<float> height(0.0f, 0.05f);
+		BodyStore store;
+		for (size_t i = 0; i < bodyCount; i++) {
+			float r = radius(random), a = angle(random);
+			store.add(glm::vec3(r * std::cos(a), height(random), r * std::sin(a)), 0.001f);
+		}
+		return store;
+	}
+
+
+	void bvhBenchmarks(Runner& runner) {
+		for (size_t bodyCount : { size_t(1000), size_t(1000000) }) {
+			BodyStore store = makeBelt(bodyCount);
+
+			for (unsigned threads : { 1u, 0u }) {
+				runner.run(fmt::format("bvh/build/bodies:{}/threads:{}", bodyCount, threads == 0 ? "all" : "1"), [&store, threads](uint64_t iterations) {
+					for (uint64_t i = 0; i < iterations; i++) {
+						BodyBvh bvh;
+						bvh.build(store, threads);
+						keep(bvh.getNodeCount());
+					}
+					return iterations * store.size();
+				});
+			}
+
+			BodyBvh bvh;
+			bvh.build(store);
+
+			// three planets moving every step, the rest static
+			runner.run(fmt::format("bvh/refit/bodies:{}/moved:3", bodyCount), [&store, &bvh](uint64_t iterations) {
+				std::vector<size_t> moved = { 0, 1, 2 };
+				for (uint64_t i = 0; i < iterations; i++) {
+					for (size_t b : moved) {
+						store.x[b] += (i & 1) ? -0.001f : 0.001f;
+					}
+					bvh.refit(store, moved);
+				}
+				return iterations * moved.size();
+			});
+
+			// rays from a camera above the belt towards random points on it
+			runner.run(fmt::format("bvh/pick/bodies:{}", bodyCount), [&store, &bvh](uint64_t iterations) {
+				std::mt19937 random(2);
+				std::uniform_real_distribution<float> target(-3.5f, 3.5f);
+				glm::vec3 origin(0.0f, 2.0f, 6.0f);
+				for (uint64_t i = 0; i < iterations; i++) {
+					float distance;
+					glm::vec3 direction = glm::vec3(target(random), 0.0f, target(random)) - origin;
+					keep(bvh.intersect(store, origin, direction, 0.002f, distance));
+				}
+				return iterations;
+			});
+		}
+	}
+
+
+	void imageBenchmarks(Runner& runner, const std::string& path) {
+		if (!std::filesystem::exists(path)) {
+			Log::warning("BENCH {} not found, skipping image benchmarks", path);
+			return;
+		}
+
+		runner.run("image/decode", [&path](uint64_t iterations) {
+			uint64_t items = 0;
+			for (uint64_t i = 0; i < iterations; i++) {
+				Image image;
+				if (loadImage(path, image, true)) {
+					items += uint64_t(image.getWidth()) * uint64_t(image.getHeight());
+				}
+				keep(image.levels.data());
+			}
+			return items;
+		});
+
+		Image source;
+		if (!loadImage(path, source, true)) {
+			return;
+		}
+		runner.run("image/mips", [&source](uint64_t iterations) {
+			uint64_t items = 0;
+			for (uint64_t i = 0; i < iterations; i++) {
+				Image image = source;
+				generateMipChain(image);
+				keep(image.levels.data());
+				items += uint64_t(source.getWidth()) * uint64_t(source.getHeight());
+			}
+			return items;
+		});
+	}
+
+
+	bool writeJson(const std::string& path, const std::string& executable, const std::vector<Result>& results) {
+		std::ofstream out(path, std::ios::trunc);
+		if (!out) {
+			Log::error("BENCH could not write {}", path);
+			return false;
+		}
+
+		std::time_t now = std::time(nullptr);
+		char date[32];
+		std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+#ifdef NDEBUG
+		const char* buildType = "release";
+#else
+		const char* buildType = "debug";
+#endif
+
+		out << fmt::format("{{\n  \"context\": {{\n    \"date\": \"{}\",\n    \"executable\": \"{}\",\n    \"num_cpus\": {},\n    \"library_build_type\": \"{}\"\n  }},\n",
+			date, executable, std::thread::hardware_concurrency(), buildType);
+		out << "  \"benchmarks\": [";
+		for (size_t i = 0; i < results.size(); i++) {
+			const Result& result = results[i];
+			out << fmt::format("{}\n    {{\"name\": \"{}\", \"run_name\": \"{}\", \"run_type\": \"iteration\", \"iterations\": {}, \"real_time\": {:.3f}, \"cpu_time\": {:.3f}, \"time_unit\": \"ns\", \"items_per_second\": {:.6g}}}",
+				i == 0 ? "" : ",", result.name, result.name, result.iterations, result.realNs, result.cpuNs, result.itemsPerSecond);
+		}
+		out << "\n  ]\n}\n";
+		return bool(out);
+	}
+}
+
+
+int main(int argc, char* argv[]) {
+	argh::parser cmdl;
+	cmdl.add_params({ "--filter", "--min-time", "--repetitions", "--json", "--texture" });
+	cmdl.parse(argc, argv);
+
+	std::string filter, json;
+	std::string texture = "textures/2k_moon.jpg";
+	double minTime = 0.2;
+	int repetitions = 5;
+	cmdl("--filter") >> filter;
+	cmdl("--json") >> json;
+	cmdl("--texture", texture) >> texture;
+	cmdl("--min-time", minTime) >> minTime;
+	cmdl("--repetitions", repetitions) >> repetitions;
+	if (!(minTime > 0.0) || repetitions <= 0) {
+		Log::error("usage: bench [--filter TEXT] [--min-time SECONDS] [--repetitions N] [--json PATH] [--texture PATH]");
+		return 1;
+	}
+
+	Runner runner(filter, minTime, repetitions);
+	sphereBenchmarks(runner);
+	motionBenchmarks(runner);
+	catalogBenchmarks(runner);
+	bvhBenchmarks(runner);
+	imageBenchmarks(runner, texture);
+
+	if (!json.empty()) {
+		if (!writeJson(json, argv[0], runner.getResults())) {
+			return 1;
+		}
+		Log::info("BENCH wrote {} results to {}", runner.getResults().size(), json);
+	}
+	return 0;
+}
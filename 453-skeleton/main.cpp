@@ -1,22 +1,60 @@
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 
+#include <array>
+#include <cassert>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
 #include <iostream>
 #include <string>
 #include <list>
 #include <vector>
 #include <limits>
 #include <functional>
-
+#include <optional>
+#include <thread>
+
+#include "AllocationCounter.h"
+#include "Arena.h"
+#include "Benchmark.h"
+#include "BodyBvh.h"
+#include "BodyCatalog.h"
+#include "BodyMotion.h"
+#include "BodyStore.h"
+#include "CatalogPoints.h"
+#include "Culling.h"
+#include "FramePacing.h"
 #include "Geometry.h"
 #include "GLDebug.h"
+#include "GLStats.h"
 #include "Log.h"
+#include "MemoryAccounting.h"
+#include "MemoryPanel.h"
+#include "Profiler.h"
+#include "RenderQueue.h"
+#include "RenderTarget.h"
+#include "ResourceLoader.h"
+#include "SceneDescription.h"
+#include "ShaderCache.h"
 #include "ShaderProgram.h"
 #include "Shader.h"
+#include "ShaderWatcher.h"
+#include "Skybox.h"
+#include "Sphere.h"
+#include "StarField.h"
 #include "Texture.h"
+#include "TextureContainer.h"
+#include "TextureResidency.h"
+#include "TextureStreamer.h"
+#include "TripleBuffer.h"
+#include "UiSnapshot.h"
+#include "VirtualTexture.h"
 #include "Window.h"
 #include "Camera.h"
 
+#include <argh.h>
+
 #include "imgui/imgui.h"
 #include "imgui/imgui_impl_glfw.h"
 #include "imgui/imgui_impl_opengl3.h"
@@ -30,243 +68,254 @@ using namespace glm;
 
 constexpr float PI = 3.14159265359f;
 
-/*
-Axial rotation is the rotation of the planet about its axis, independent of other planets.
-Orbital rotation is the rotation of the entire planet about its parent (in orbit).
-*/
+// projection
+const float nearPlane = 0.01f;
+const float farPlane = 1000.0f;
 
-// global constants -- scaled manually to fit the scene
+float modelScale = 1.0f; // km to scene units, set from the scene so its first body is unit size
+const float uvInc = 0.1f;
+float axialInc = 0.01f; // adjustable by animation speed
+float animationSpeed = 1.0f;
+bool isAnimating = true;
+bool restartAnimation = false;
+bool occlusionCulling = true;
+float starMagnitudeLimit = 6.5f; // faintest star drawn, about what the naked eye sees
+bool showProfiler = false;
+bool showMemory = false;
+string memoryReportPath = "memory-report.json";
+std::atomic<bool> dumpTrace(false); // set by input, handled by the render thread
 
-// radius: km
-const float sunRadius = 696340.0f;
-const float earthRadius = 6371.0f * 30.0f;
-const float moonRadius = 1737.4f * 60.0f;
-const float backgroundRadius = sunRadius * 100.0f;
+// Block compression makes loading slower but cuts texture memory and
+// sampling bandwidth by 4x (BC7) to 8x (BC1)
+TextureCompression textureCompression = TextureCompression::None;
 
-// distance btwn planets: km
-const float earthToSun = 147.72e6f * 0.01f;
-const float moonToEarth = 384400.0f * 1.10f;
+// GPU memory body textures may use; top mip levels of the least visible ones
+// are dropped to stay under it
+size_t textureBudget = size_t(256) << 20;
 
-// orbital inclination: radian
-const float earthOrbitalInclination = (float)radians(23.4); // wrt sun
-const float moonOrbitalInclination = (float)radians(5.15); // wrt earth
+double lastUpdateTime;
+double currUpdateTime;
 
-// axial tilt: radian
-const float earthAxialTilt = (float)radians(23.4f); // wrt sun
-const float moonAxialTilt = (float)radians(1.5); // wrt earth
+TextureSettings bodyTextureSettings() {
+	TextureSettings settings; // trilinear, anisotropic, sRGB
+	settings.compression = textureCompression;
+	return settings;
+}
 
-// rotation speed: km/s
-const float sunRotationSpeed = 1.997f;
-const float earthRotationSpeed = 0.47f * 60.0f;
-const float moonRotationSpeed = 0.004639f * 600.0f;
+// Prefers the container the build imported for textures/<name>, which maps
+// straight into the driver, and falls back to decoding the source JPEG
+string bodyTexturePath(const string& name) {
+	string container = "textures/" + name + TextureContainer::extension;
+	return std::filesystem::exists(container) ? container : "textures/" + name + ".jpg";
+}
 
-// orbit speed: km/s
-const float earthOrbitSpeed = 30.0f / 10.0f;
-const float moonOrbitSpeed = 1.022f * 10.0f;
+// Tile pyramid the build imported for textures/<name>, if there is one
+VirtualTexture* loadVirtualTexture(VirtualTextureCache& cache, const string& name) {
+	string path = "textures/" + name + VirtualTextureFile::extension;
+	return std::filesystem::exists(path) ? cache.load(path) : nullptr;
+}
 
-vec3 xAxisOfRotation = vec3(1.0f, 0.0f, 0.0f);
-vec3 yAxisOfRotation = vec3(0.0f, 1.0f, 0.0f);
-vec4 xAxisMatrix = vec4(1.0f, 0.0f, 0.0f, 0.0f);
-vec4 yAxisMatrix = vec4(0.0f, 1.0f, 0.0f, 0.0f);
+// Ordinary streamed texture, unless the body samples a virtual texture instead
+// or has none at all
+std::optional<Texture> bodyTexture(const string& name, TextureStreamer& streamer, const VirtualTexture* surface = nullptr) {
+	if (surface != nullptr || name.empty()) {
+		return std::nullopt;
+	}
+	return Texture(bodyTexturePath(name), bodyTextureSettings(), streamer);
+}
 
-const float modelScale = 0.5f / sunRadius; // let sun be unit size
-const float uvInc = 0.1f;
-float axialInc = 0.01f; // adjustable by animation speed
-float animationSpeed = 1.0f;
-bool isAnimating = true;
-bool restartAnimation = false;
+// Placement of one body for one frame, computed by the simulation
+struct BodySnapshot {
+	vec3 position = vec3(0.0f);
+	mat4 translation = mat4(1.0f);
+	mat4 rotation = mat4(1.0f);
+	mat4 negRotation = mat4(1.0f);
+};
 
-double lastUpdateTime;
-double currUpdateTime;
+// Everything the renderer needs from the main thread to draw a frame. The
+// main thread publishes one per step through a TripleBuffer, the renderer
+// always draws the newest.
+struct SceneSnapshot {
+	uint64_t sequence = 0; // 0 until the first publish
+	std::vector<BodySnapshot> bodies; // in scene order
+	vec3 cameraPos = vec3(0.0f);
+	mat4 view = mat4(1.0f);
+	mat4 projection = mat4(1.0f);
+	int width = 0;
+	int height = 0;
+	bool occlusionCulling = true;
+	float starMagnitudeLimit = 6.5f;
+	UiSnapshot ui;
+};
 
-class Planet {
+// How the bodies move. Runs on the main thread next to input handling, so
+// neither waits on the renderer.
+class Simulation {
 public:
-	Planet(float actualRadius, const string texturePath, float axialSpeed = 0.0f, float orbitSpeed = 0.0f, float orbitalIncl = 0.0f, float tilt = PI / 2, Planet* parentPtr = nullptr, float actualDistanceFromParent = 0.0f) :
-		radius(actualRadius* modelScale), // scale -- constant
-		texture(texturePath, GL_NEAREST),
-		rotationSpeed(axialSpeed),
-		orbitalSpeed(orbitSpeed),
-		orbitalInclination(orbitalIncl), // constant
-		axialTilt(tilt), // constant
-		parent(parentPtr),
-		distanceFromParent(actualDistanceFromParent* modelScale)
-	{
-		modelMatrix = mat4(1.0f);
-
-		resetOrientation();
-		updateLocation();
-		updateTranslationMatrix();
-		generateSphere();
+	explicit Simulation(const SceneDescription& scene) {
+		// reserved up front: children keep pointers to their parents
+		motions.reserve(scene.bodies.size());
+		for (const BodyDescription& body : scene.bodies) {
+			const BodyMotion* parent = body.parent >= 0 ? &motions[body.parent] : nullptr;
+			motions.emplace_back(body.rotationSpeed, body.orbitSpeed, body.orbitalInclination, body.axialTilt,
+				parent, body.distance * modelScale);
+		}
 	}
 
+	// Steps every body by the real time since the previous step
 	void animate() {
 		currUpdateTime = glfwGetTime(); // scaled to real time
-		updateAxialRotation();
-		updateOrbitalRotation();
+		advance((float)(currUpdateTime - lastUpdateTime));
 		lastUpdateTime = currUpdateTime;
 	}
 
-	void draw(ShaderProgram& shader)
-	{
-		gpuGeom.bind();
-		texture.bind();
-
-		GLint uniformTransformationMatrix = glGetUniformLocation(shader, "transformationMatrix");
-		glUniformMatrix4fv(uniformTransformationMatrix, 1, GL_FALSE, &translationMatrix[0][0]);
-
-		GLint uniformRotationMatrix = glGetUniformLocation(shader, "rotationMatrix");
-		glUniformMatrix4fv(uniformRotationMatrix, 1, GL_FALSE, &axialRotationMatrix[0][0]);
-
-		GLint uniformNegRotationMatrix = glGetUniformLocation(shader, "negRotationMatrix");
-		glUniformMatrix4fv(uniformNegRotationMatrix, 1, GL_FALSE, &negAxialRotationMatrix[0][0]);
-
-		glDrawArrays(GL_TRIANGLES, 0, GLsizei(cpuGeom.verts.size()));
-
-		texture.unbind();
+	// Steps every body by a fixed amount of simulated time. Parents come
+	// first, so children see where they moved to.
+	void advance(float elapsed) {
+		for (BodyMotion& motion : motions) {
+			motion.advance(elapsed, animationSpeed);
+		}
 	}
 
 	void resetOrientation() {
-		orbitalAngle = PI / 2;
-		axialAngle = PI / 2;
-
-		float initAxialAngle = orbitalInclination + axialAngle + axialTilt;
-		axialRotationMatrix = rotate(modelMatrix, initAxialAngle, xAxisOfRotation);
-		negAxialRotationMatrix = modelMatrix;
-		rotationAxis = vec3(axialRotationMatrix * yAxisMatrix);
+		for (BodyMotion& motion : motions) {
+			motion.resetOrientation();
+		}
 	}
 
-private:
-	float getElapsedTime() {
-		return (float)(currUpdateTime - lastUpdateTime);
+	// Moves the first bodies of store, one per scene body, to where their
+	// bodies are now
+	void place(BodyStore& store) const {
+		for (size_t i = 0; i < motions.size(); i++) {
+			store.setBounds(i, motions[i].getPosition(), store.radius[i]);
+		}
 	}
 
-	vec3 getPosition() {
-		return position;
+	void fill(std::vector<BodySnapshot>& bodies) const {
+		bodies.resize(motions.size());
+		for (size_t i = 0; i < bodies.size(); i++) {
+			bodies[i].position = motions[i].getPosition();
+			bodies[i].translation = motions[i].getTranslation();
+			bodies[i].rotation = motions[i].getRotation();
+			bodies[i].negRotation = motions[i].getNegRotation();
+		}
 	}
 
-	void updateGPUGeom(GPU_Geometry& gpuGeom, CPU_Geometry const& cpuGeom) {
+private:
+	std::vector<BodyMotion> motions;
+};
+
+// Render side of a body: its geometry, surface and draws. Where it is comes
+// from the simulation through update().
+class Planet {
+public:
+	Planet(float actualRadius, std::optional<Texture> bodyTexture) :
+		radius(actualRadius* modelScale), // scale -- constant
+		texture(std::move(bodyTexture))
+	{
+		generateSphere(radius, uvInc, cpuGeom.verts, cpuGeom.texCoords);
 		gpuGeom.bind();
 		gpuGeom.setVerts(cpuGeom.verts);
 		gpuGeom.setTexCoords(cpuGeom.texCoords);
-		gpuGeom.setNormals(cpuGeom.normals);
 	}
 
-	void updateAxialRotation() {
-		axialAngle += rotationSpeed * animationSpeed * getElapsedTime();
-		axialRotationMatrix = rotate(modelMatrix, axialAngle, rotationAxis);
-		negAxialRotationMatrix = rotate(modelMatrix, -axialAngle, rotationAxis);
+	// Takes over this frame's placement. Normals point away from the
+	// body's position, so they only need updating when it moved.
+	void update(const BodySnapshot& body) {
+		bool moved = !placed || body.position != state.position;
+		state = body;
+		placed = true;
+		if (moved) {
+			updateNormals();
+		}
 	}
 
-	void updateOrbitalRotation() {
-		orbitalAngle += orbitalSpeed * animationSpeed * getElapsedTime();
-		updateLocation();
-		updateNormals();
-		updateTranslationMatrix();
+	// Picks the shader variant this body is drawn with
+	void setProgram(const ShaderProgram& shader) {
+		program = &shader;
 	}
 
-	void updateTranslationMatrix() {
-		if (parent == nullptr) {
-			translationMatrix = modelMatrix;
-		}
-		else {
-			translationMatrix = translate(modelMatrix, position);
-		}
+	// Samples surface instead of the body texture. Needs a VIRTUAL_TEXTURE
+	// program.
+	void setVirtualTexture(VirtualTexture* surface) {
+		virtualTexture = surface;
 	}
 
-	void updateLocation() {
-		if (parent == nullptr) {
-			position = vec3(0.0f);
-		}
-		else {
-			vec3 relativePositionFromParent = distanceFromParent * vec3(sin(orbitalAngle), sin(orbitalAngle) * sin(orbitalInclination), cos(orbitalAngle));
-			position = parent->getPosition() + relativePositionFromParent;
-		}
+	void submit(RenderQueue& queue, vec3 cameraPos, GLuint condition = 0)
+	{
+		DrawPacket packet = makePacket(*program);
+		packet.condition = condition;
+		queue.submit(makeKey(packet, cameraPos), packet);
 	}
 
-	void updateNormals() {
-		cpuGeom.normals.clear();
-		for (vec3 vertex : cpuGeom.verts) {
-			cpuGeom.normals.push_back(getNormal(vertex));
+	// Draws the body into the virtual texture feedback buffer, if it has a
+	// virtual texture at all
+	void submitFeedback(RenderQueue& queue, const ShaderProgram& feedbackProgram, vec3 cameraPos)
+	{
+		if (virtualTexture != nullptr) {
+			DrawPacket packet = makePacket(feedbackProgram);
+			queue.submit(makeKey(packet, cameraPos), packet);
 		}
-		updateGPUGeom(gpuGeom, cpuGeom);
 	}
 
-	vec3 getNormal(vec3 vertex) { // simpler for spheres
-		return normalize(vertex - position);
+	vec3 getPosition() const {
+		return state.position;
 	}
 
-	//vec3 getVertexNormal(float phi, float theta) { // unused
-	//	/*
-	//	Qu(u,v) = [rcos(u)cos(v), rcos(u)sin(v), -rsin(u)]
-	//	Qv(u,v) = [-rsin(u)sin(v), rsin(u)cos(v), 0]
-	//	n(u, v) = Qu(u, v) x Qv(u, v)
-	//	*/
-	//	vec3 Qu = vec3(radius * cos(phi) * cos(theta), radius * cos(phi) * sin(theta), -radius * sin(phi));
-	//	vec3 Qv = vec3(-radius * sin(phi) * sin(theta), radius * sin(phi) * cos(theta), 0);
-	//	return normalize(cross(Qu, Qv));
-	//}
-
-	vec3 getVertexCoord(float phi, float theta) {
-		/* sphere parametric representation:
-		Q(u,v) = [rsin(u)cos(v), rsin(u)sin(v), rcos(u)] , 0 <= u <= PI, 0 <= v <= 2PI
-		u = phi, v = theta
-		*/
-		return radius * vec3(sin(phi) * cos(theta), sin(phi) * sin(theta), cos(phi));
+	float getRadius() const {
+		return radius;
 	}
 
-	vec2 getTextureCoord(float phi, float theta) {
-		return vec2(theta / (2 * PI), phi / PI);
+	// null for virtual textured and untextured bodies
+	Texture* getTexture() {
+		return texture ? &*texture : nullptr;
 	}
 
-	void drawPoint(float phi, float theta) {
-		cpuGeom.verts.push_back(getVertexCoord(phi, theta));
-		cpuGeom.texCoords.push_back(getTextureCoord(phi, theta));
+private:
+	DrawPacket makePacket(const ShaderProgram& shader) const {
+		DrawPacket packet;
+		packet.program = shader;
+		packet.vao = gpuGeom.getVAO();
+		packet.count = GLsizei(cpuGeom.verts.size());
+		packet.transformation = &state.translation;
+		packet.rotation = &state.rotation;
+		packet.negRotation = &state.negRotation;
+		if (virtualTexture != nullptr) {
+			packet.texture = virtualTexture->getAtlas();
+			packet.secondaryTexture = virtualTexture->getIndirection();
+			packet.parameters = &virtualTexture->getParameters();
+		}
+		else if (texture) {
+			packet.texture = *texture;
+		}
+		return packet;
 	}
 
-	void generateSphere() { // init verts, textures, normals
-		cpuGeom.verts.clear();
-		cpuGeom.texCoords.clear();
-
-		for (float u = 0.0f; u <= PI; u += uvInc) { // u
-			for (float v = 0.0f; v <= 2 * PI; v += uvInc) { // v
-				// triangle #1: |\ 
-				drawPoint(u, v); // u, v
-				drawPoint(u + uvInc, v); // u + 1, v
-				drawPoint(u, v + uvInc); // u, v + 1
-
-				// triangle #2: \|
-				drawPoint(u + uvInc, v); // u + 1, v
-				drawPoint(u + uvInc, v + uvInc); // u + 1, v + 1
-				drawPoint(u, v + uvInc); // u, v + 1
-			}
-		}
-		updateNormals();
-		updateGPUGeom(gpuGeom, cpuGeom);
+	uint64_t makeKey(const DrawPacket& packet, vec3 cameraPos) const {
+		// distance to the closest point of the sphere, for front-to-back ordering
+		float depth = std::max(0.0f, length(getPosition() - cameraPos) - radius) / farPlane;
+		return RenderQueue::makeKey(RenderPass::Opaque, packet.program, packet.texture, packet.vao, depth);
 	}
 
-	const float orbitalInclination;
-	const float axialTilt;
-	const float distanceFromParent;
-	const float orbitalSpeed;
-	const float rotationSpeed;
+	// Only the normals depend on the position; the vertices and texture
+	// coordinates went up once in the constructor
+	void updateNormals() {
+		ProfileScope scope("updateNormals");
+		sphereNormals(cpuGeom.verts, getPosition(), cpuGeom.normals);
+		gpuGeom.bind();
+		gpuGeom.setNormals(cpuGeom.normals);
+	}
 
 	float radius;
-	float orbitalAngle;
-	float axialAngle;
-
-	Planet* parent;
+	const ShaderProgram* program = nullptr;
 
-	vec3 position;
-	vec3 rotationAxis;
+	BodySnapshot state;
+	bool placed = false;
 
 	CPU_Geometry cpuGeom;
 	GPU_Geometry gpuGeom;
-	Texture texture;
-
-	mat4 modelMatrix;
-	mat4 translationMatrix;
-	mat4 axialRotationMatrix;
-	mat4 negAxialRotationMatrix;
+	std::optional<Texture> texture;
+	VirtualTexture* virtualTexture = nullptr;
 };
 
 // EXAMPLE CALLBACKS
@@ -276,12 +325,15 @@ public:
 	Assignment4()
 		: camera(glm::radians(45.f), glm::radians(45.f), 3.0)
 		, aspect(1.0f)
+		, width(1)
+		, height(1)
 		, rightMouseDown(false)
 		, mouseOldX(0.0)
 		, mouseOldY(0.0)
 	{}
 
 	virtual void keyCallback(int key, int scancode, int action, int mods) {
+		dirty = true;
 		if (key == GLFW_KEY_SPACE && action == GLFW_PRESS) {
 			// pause/unpause animation
 			isAnimating = !isAnimating;
@@ -298,157 +350,780 @@ public:
 			// restart animation
 			restartAnimation = true;
 		}
+		else if (key == GLFW_KEY_O && action == GLFW_PRESS) {
+			// toggle occlusion queries
+			occlusionCulling = !occlusionCulling;
+		}
+		else if (key == GLFW_KEY_RIGHT_BRACKET && (action == GLFW_PRESS || action == GLFW_REPEAT)) {
+			// show fainter stars
+			starMagnitudeLimit = std::min(starMagnitudeLimit + 0.5f, 20.0f);
+		}
+		else if (key == GLFW_KEY_LEFT_BRACKET && (action == GLFW_PRESS || action == GLFW_REPEAT)) {
+			// show only brighter stars
+			starMagnitudeLimit = std::max(starMagnitudeLimit - 0.5f, -2.0f);
+		}
+		else if (key == GLFW_KEY_P && action == GLFW_PRESS) {
+			// toggle the profiler overlay
+			showProfiler = !showProfiler;
+		}
+		else if (key == GLFW_KEY_M && action == GLFW_PRESS) {
+			// toggle the memory panel
+			showMemory = !showMemory;
+		}
+		else if (key == GLFW_KEY_T && action == GLFW_PRESS) {
+			// write the recent frames as a Chrome trace
+			dumpTrace = true;
+		}
+		else if (key == GLFW_KEY_C && action == GLFW_PRESS) {
+			// orbit the origin again
+			recenter = true;
+		}
 	}
 	virtual void mouseButtonCallback(int button, int action, int mods) {
+		dirty = true;
 		if (button == GLFW_MOUSE_BUTTON_RIGHT) {
 			if (action == GLFW_PRESS)			rightMouseDown = true;
 			else if (action == GLFW_RELEASE)	rightMouseDown = false;
 		}
+		else if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS) {
+			// picked on the next simulation step
+			click = dvec2(mouseOldX, mouseOldY);
+		}
 	}
 	
 	virtual void cursorPosCallback(double xpos, double ypos) {
 		if (rightMouseDown) {
 			camera.incrementTheta((float)(ypos - mouseOldY));
 			camera.incrementPhi((float)(xpos - mouseOldX));
+			dirty = true;
+		}
+		else if (ImGui::GetIO().WantCaptureMouse) {
+			dirty = true; // hovering the UI
 		}
 		mouseOldX = xpos;
 		mouseOldY = ypos;
 	}
 	virtual void scrollCallback(double xoffset, double yoffset) {
 		camera.incrementR((float)yoffset);
+		dirty = true;
 	}
-	virtual void windowSizeCallback(int width, int height) {
-		// The CallbackInterface::windowSizeCallback will call glViewport for us
-		CallbackInterface::windowSizeCallback(width,  height);
+
+	virtual void windowSizeCallback(int newWidth, int newHeight) {
+		// The renderer sets the viewport from the snapshot, on the thread
+		// that owns the context
+		width = newWidth;
+		height = newHeight;
 		aspect = float(width)/float(height);
+		dirty = true;
 	}
 
-	void viewPipeline(ShaderProgram &sp) {
-		mat4 M = mat4(1.0);
-		mat4 V = camera.getView();
-		mat4 P = perspective(radians(45.0f), aspect, 0.01f, 1000.f);
+	virtual void windowRefreshCallback() {
+		dirty = true;
+	}
 
-		GLint location = glGetUniformLocation(sp, "lightPos");
-		vec3 lightPos = { 0.0f, 0.0f, 0.0f };
-		glUniform3fv(location, 1, value_ptr(lightPos));
+	// True if input changed anything on screen since the last call
+	bool takeDirty() {
+		bool wasDirty = dirty;
+		dirty = false;
+		return wasDirty;
+	}
 
-		GLint viewLocation = glGetUniformLocation(sp, "viewPos");
-		glUniform3fv(viewLocation, 1, value_ptr(camera.getPos()));
+	mat4 getProjection() const {
+		return perspective(radians(45.0f), aspect, nearPlane, farPlane);
+	}
 
-		GLint uniMat = glGetUniformLocation(sp, "M");
-		glUniformMatrix4fv(uniMat, 1, GL_FALSE, value_ptr(M));
-		uniMat = glGetUniformLocation(sp, "V");
-		glUniformMatrix4fv(uniMat, 1, GL_FALSE, value_ptr(V));
-		uniMat = glGetUniformLocation(sp, "P");
-		glUniformMatrix4fv(uniMat, 1, GL_FALSE, value_ptr(P));
+	int getWidth() const { return width; }
+	int getHeight() const { return height; }
+
+	// Cursor position of the last left click not handled yet
+	std::optional<dvec2> takeClick() {
+		std::optional<dvec2> position = click;
+		click.reset();
+		return position;
+	}
+
+	// World space ray through a cursor position
+	void cursorRay(dvec2 cursor, vec3& origin, vec3& direction) {
+		vec2 ndc(2.0 * cursor.x / width - 1.0, 1.0 - 2.0 * cursor.y / height);
+		mat4 inverseViewProjection = inverse(getProjection() * camera.getView());
+		vec4 near = inverseViewProjection * vec4(ndc, -1.0f, 1.0f);
+		vec4 far = inverseViewProjection * vec4(ndc, 1.0f, 1.0f);
+		origin = camera.getPos();
+		direction = normalize(vec3(far) / far.w - vec3(near) / near.w);
 	}
 
 	Camera camera;
+	bool recenter = false;
 
 private:
-	bool rightMouseDown = false;
 	float aspect;
+	int width;
+	int height;
+	bool rightMouseDown = false;
 	double mouseOldX;
 	double mouseOldY;
+	std::optional<dvec2> click;
+	bool dirty = true;
 };
 
-int main() {
-	Log::debug("Starting main");
+// Camera and light uniforms, set once per program
+void viewPipeline(GLuint sp, const SceneSnapshot& scene) {
+	mat4 M = mat4(1.0);
 
-	// WINDOW
-	glfwInit();
-	Window window(800, 800, "CPSC 453"); // can set callbacks at construction if desired
+	GLint location = glGetUniformLocation(sp, "lightPos");
+	vec3 lightPos = { 0.0f, 0.0f, 0.0f };
+	GLStats::uniform(location, lightPos);
 
+	GLint viewLocation = glGetUniformLocation(sp, "viewPos");
+	GLStats::uniform(viewLocation, scene.cameraPos);
 
-	GLDebug::enable();
+	GLint uniMat = glGetUniformLocation(sp, "M");
+	GLStats::uniform(uniMat, M);
+	uniMat = glGetUniformLocation(sp, "V");
+	GLStats::uniform(uniMat, scene.view);
+	uniMat = glGetUniformLocation(sp, "P");
+	GLStats::uniform(uniMat, scene.projection);
+}
 
-	// CALLBACKS
-	//auto a4 = make_shared<Assignment4>(&earthOrbitalRotationIncrement, &moonOrbitalRotationIncrement);
-	auto a4 = make_shared<Assignment4>();
-	window.setCallbacks(a4);
+// Owns every GL object of the scene and draws snapshots of it. Must be
+// created, used and destroyed on the thread the context is current on.
+class SceneRenderer {
+public:
+	// width and height size an offscreen target; 0 draws to the window.
+	// Textures and shader rebuilds are created on loader's context.
+	// sceneBodies holds the scene's bodies followed by its catalog bodies;
+	// only the construction reads it.
+	SceneRenderer(ResourceLoader& loader, const SceneDescription& scene, const BodyStore& sceneBodies,
+		int offscreenWidth = 0, int offscreenHeight = 0)
+		: shaders(loader)
+		// Each body uses the cheapest shader variant it needs: emissive
+		// bodies give off their own light, so they skip the lighting math
+		, litShader(shaders.get("shaders/test.vert", "shaders/test.frag"))
+		, emissiveShader(shaders.get("shaders/test.vert", "shaders/test.frag", { "EMISSIVE" }))
+		, virtualShader(shaders.get("shaders/test.vert", "shaders/test.frag", { "VIRTUAL_TEXTURE" }))
+		, feedbackShader(shaders.get("shaders/test.vert", "shaders/test.frag", { "VIRTUAL_TEXTURE", "VT_FEEDBACK" }))
+		, textureStreamer(&loader)
+		, textureResidency(textureBudget)
+		, occlusionQueries(shaders)
+		, catalogPoints(shaders)
+		, shaderWatcher("shaders")
+	{
+		planets.reserve(scene.bodies.size());
+		for (const BodyDescription& body : scene.bodies) {
+			// Lit bodies page in only the tiles on screen through a fixed
+			// size atlas when the build produced a tile pyramid for them
+			VirtualTexture* surface = body.emissive || body.texture.empty() ? nullptr : loadVirtualTexture(virtualTextures, body.texture);
+			auto planet = std::make_unique<Planet>(body.radius, bodyTexture(body.texture, textureStreamer, surface));
+			planet->setProgram(body.emissive ? emissiveShader : surface ? virtualShader : litShader);
+			planet->setVirtualTexture(surface);
+
+			// Emissive bodies are the large occluders; everything else is
+			// tested against them
+			bodies.add(planet->getPosition(), planet->getRadius(), !body.emissive);
+			if (Texture* texture = planet->getTexture()) {
+				textureResidency.add(*texture);
+			}
+			planets.push_back(std::move(planet));
+		}
 
-	ShaderProgram shader("shaders/test.vert", "shaders/test.frag");
+		// Room for every body's packets up front, so a view that shows more
+		// bodies than the last one doesn't grow the queues mid-frame
+		renderQueue.reserve(planets.size() + 2);
+		feedbackQueue.reserve(planets.size());
 
-	lastUpdateTime = glfwGetTime();
+		// Catalog bodies don't move, so they are drawn as points uploaded once
+		catalogPoints.upload(sceneBodies, scene.bodies.size(), sceneBodies.size() - scene.bodies.size());
+
+		// A star catalog replaces the sky texture when the scene has one
+		if (!scene.stars.empty()) {
+			stars = std::make_unique<StarField>(shaders, scene.stars);
+		}
+		else {
+			sky = std::make_unique<Skybox>(shaders, "textures/2k_stars.jpg");
+		}
 
-	Planet sun(sunRadius, "textures/2k_sun.jpg", sunRotationSpeed);
-	Planet earth(earthRadius, "textures/2k_earth_daymap.jpg", earthRotationSpeed, earthOrbitSpeed, earthOrbitalInclination, earthAxialTilt, &sun, earthToSun);
-	Planet moon(moonRadius, "textures/2k_moon.jpg", moonRotationSpeed, moonOrbitSpeed, moonOrbitalInclination, moonAxialTilt, &earth, moonToEarth);
-	Planet starBackground(backgroundRadius, "textures/2k_stars.jpg");
+		if (offscreenWidth > 0 && offscreenHeight > 0) {
+			offscreen = std::make_unique<RenderTarget>(offscreenWidth, offscreenHeight);
+		}
 
-	// RENDER LOOP
-	while (!window.shouldClose()) {
-		glfwPollEvents();
+		// Creates the font texture before the UI thread builds its first frame
+		ImGui_ImplOpenGL3_CreateDeviceObjects();
+	}
+
+	// Blocks until every streamed texture is resident
+	void finishStreaming() {
+		while (textureStreamer.pending() > 0) {
+			textureStreamer.update();
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	}
+
+	// True while frames keep changing without a new snapshot: textures and
+	// shaders are still streaming in, or virtual texture feedback is still
+	// bringing in tiles for the current view
+	bool needsRedraw() const {
+		return textureStreamer.pending() > 0 || shaders.pendingBuilds() > 0 || settlingFrames > 0;
+	}
+
+	// Starts rebuilding edited shaders. Returns true if there were any.
+	bool pollShaders() {
+		bool edited = false;
+		for (const string& path : shaderWatcher.poll()) {
+			shaders.reload(path);
+			edited = true;
+		}
+		return edited;
+	}
+
+	void render(SceneSnapshot& scene) {
+		frameArena.reset();
+		{
+			ProfileScope scope("shaders");
+			pollShaders();
+			shaders.update();
+		}
+
+		// Counted from here: without inotify, polling the shader directory
+		// allocates every scan
+		const uint64_t allocationsBefore = AllocationCounter::thisThread();
+
+		{
+			GpuProfileScope scope("uploads");
+			textureStreamer.update();
+			virtualTextures.update();
+		}
+
+		if (offscreen) {
+			offscreen->bind();
+		}
+		else {
+			glViewport(0, 0, scene.width, scene.height);
+		}
 
 		glEnable(GL_LINE_SMOOTH);
 		glEnable(GL_FRAMEBUFFER_SRGB);
-		glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+		glClearColor(0.0f, 0.0f, 0.0f, 1.0f); // space between the stars
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 		glEnable(GL_DEPTH_TEST);
 		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL /*GL_LINE*/);
 
-		shader.use();
+		for (size_t i = 0; i < scene.bodies.size(); i++) {
+			planets[i]->update(scene.bodies[i]);
+		}
 
-		a4->viewPipeline(shader);
+		vec3 cameraPos = scene.cameraPos;
+		const mat4& V = scene.view;
+		const mat4& P = scene.projection;
 
-		if (restartAnimation) {
-			sun.resetOrientation();
-			earth.resetOrientation();
-			moon.resetOrientation();
-			restartAnimation = false;
+		{
+			// Only bodies that survive frustum culling reach the queue
+			ProfileScope scope("cull");
+			for (size_t i = 0; i < bodies.size(); i++) {
+				bodies.setBounds(i, planets[i]->getPosition(), planets[i]->getRadius());
+			}
+			cullBodies(Frustum::fromMatrix(P * V), bodies);
+			occlusionQueries.setEnabled(scene.occlusionCulling);
+		}
+
+		// The survivors, for the passes below
+		ArenaVector<uint32_t> visible{ ArenaAllocator<uint32_t>(frameArena) };
+		visible.reserve(bodies.size());
+		for (size_t i = 0; i < bodies.size(); i++) {
+			if (bodies.visible[i]) {
+				visible.push_back(uint32_t(i));
+			}
 		}
 
-		sun.draw(shader);
-		earth.draw(shader);
-		moon.draw(shader);
-		starBackground.draw(shader);
+		// A sphere's texture wraps its circumference, so that is the screen
+		// size its width spans
+		for (uint32_t i : visible) {
+			Texture* texture = planets[i]->getTexture();
+			if (texture != nullptr) {
+				float distance = std::max(length(planets[i]->getPosition() - cameraPos), planets[i]->getRadius());
+				float diameter = planets[i]->getRadius() / distance * P[1][1] * float(scene.height);
+				textureResidency.reportUsage(*texture, PI * diameter);
+			}
+		}
+		{
+			GpuProfileScope scope("residency");
+			textureResidency.update();
+		}
 
-		if (isAnimating) {
-			sun.animate();
-			earth.animate();
-			moon.animate();
+		// Feedback takes a few frames to come back, so a new view, or one
+		// whose tiles or mip levels are still arriving, is drawn a few more
+		// times before the renderer goes idle
+		if (scene.sequence != drawnSequence || virtualTextures.getStats().uploadedTiles > 0
+			|| textureResidency.getStats().reallocations > 0) {
+			settlingFrames = 4;
+		}
+		else if (settlingFrames > 0) {
+			settlingFrames--;
+		}
+		drawnSequence = scene.sequence;
+
+		{
+			// Bodies submit draw packets; the queue decides the actual draw order
+			ProfileScope scope("submit");
+			renderQueue.clear();
+			for (uint32_t i : visible) {
+				planets[i]->submit(renderQueue, cameraPos, occlusionQueries.getCondition(i));
+			}
+			catalogPoints.submit(renderQueue);
+			if (stars) {
+				stars->submit(renderQueue, scene.starMagnitudeLimit);
+			}
+			else {
+				sky->submit(renderQueue);
+			}
+
+			feedbackQueue.clear();
+			for (uint32_t i : visible) {
+				planets[i]->submitFeedback(feedbackQueue, feedbackShader, cameraPos);
+			}
+		}
+
+		// Low resolution pass recording the virtual texture tiles in view
+		if (feedbackQueue.size() > 0) {
+			GpuProfileScope scope("feedback");
+			virtualTextures.beginFeedback();
+			feedbackQueue.execute([&](GLuint program) {
+				viewPipeline(program, scene);
+				virtualTextures.setUniforms(program, true);
+			});
+			virtualTextures.endFeedback();
+		}
+
+		{
+			GpuProfileScope scope("draw");
+			renderQueue.execute([&](GLuint program) {
+				viewPipeline(program, scene);
+				virtualTextures.setUniforms(program, false);
+			});
+		}
+
+		{
+			// Test this frame's depth buffer for next frame's conditional draws
+			GpuProfileScope scope("occlusion");
+			occlusionQueries.issue(bodies, V, P, cameraPos);
 		}
 
 		glDisable(GL_FRAMEBUFFER_SRGB); // disable sRGB for things like imgui
 
-		// Starting the new ImGui frame
-		ImGui_ImplOpenGL3_NewFrame();
-		ImGui_ImplGlfw_NewFrame();
-		ImGui::NewFrame();
-		// Putting the text-containing window in the top-left of the screen.
-		ImGui::SetNextWindowPos(ImVec2(5, 5));
-
-		// Setting flags
-		ImGuiWindowFlags textWindowFlags =
-			ImGuiWindowFlags_NoMove |				// text "window" should not move
-			ImGuiWindowFlags_NoResize |				// should not resize
-			ImGuiWindowFlags_NoCollapse |			// should not collapse
-			ImGuiWindowFlags_NoSavedSettings |		// don't want saved settings mucking things up
-			ImGuiWindowFlags_AlwaysAutoResize |		// window should auto-resize to fit the text
-			ImGuiWindowFlags_NoBackground |			// window should be transparent; only the text should be visible
-			ImGuiWindowFlags_NoDecoration |			// no decoration; only the text should be visible
-			ImGuiWindowFlags_NoTitleBar;			// no title; only the text should be visible
-
-		// Begin a new window with these flags. (bool *)0 is the "default" value for its argument.
-		ImGui::Begin("scoreText", (bool*)0, textWindowFlags);
-
-		// Scale up text a little, and set its value
-		ImGui::SetWindowFontScale(2.5f);
+		if (ImDrawData* ui = scene.ui.getDrawData()) {
+			GpuProfileScope scope("imgui");
+			ImGui_ImplOpenGL3_NewFrame();
+			ImGui_ImplOpenGL3_RenderDrawData(ui);
+		}
+
+		checkAllocations(AllocationCounter::thisThread() - allocationsBefore);
+	}
+
+private:
+	ShaderCache shaders;
+	ShaderProgram& litShader;
+	ShaderProgram& emissiveShader;
+	ShaderProgram& virtualShader;
+	ShaderProgram& feedbackShader;
+
+	// Body textures decode in the background and are built on the loader
+	TextureStreamer textureStreamer;
+	VirtualTextureCache virtualTextures;
+
+	// One per scene body, in scene order
+	std::vector<std::unique_ptr<Planet>> planets;
+	std::unique_ptr<Skybox> sky;
+	std::unique_ptr<StarField> stars;
+
+	BodyStore bodies;
+	TextureResidency textureResidency;
+	RenderQueue renderQueue;
+	RenderQueue feedbackQueue;
+	OcclusionQueries occlusionQueries;
+
+	// Kept apart from bodies, which get an occlusion query each
+	CatalogPoints catalogPoints;
+
+	// Edited shaders are rebuilt in the background and swapped in once linked
+	ShaderWatcher shaderWatcher;
+
+	std::unique_ptr<RenderTarget> offscreen;
+
+	uint64_t drawnSequence = 0;
+	int settlingFrames = 0;
+
+	// Transient data of the frame being drawn, reset at the start of render()
+	Arena frameArena;
+
+	// Frames in a row that loaded nothing, see checkAllocations()
+	int steadyFrames = 0;
+
+	// Debug builds check that a frame with nothing loading or uploading
+	// doesn't touch the heap. Buffers that are reused every frame still grow
+	// during the first frames, so those are let through.
+	void checkAllocations(uint64_t allocations) {
+		constexpr int warmupFrames = 120;
+		bool steady = textureStreamer.pending() == 0 && shaders.pendingBuilds() == 0
+			&& virtualTextures.getStats().uploadedTiles == 0 && textureResidency.getStats().reallocations == 0;
+		if (!AllocationCounter::isEnabled() || !steady) {
+			steadyFrames = 0;
+			return;
+		}
+		if (++steadyFrames > warmupFrames && allocations > 0) {
+			Log::error("RENDERER steady frame made {} heap allocations", allocations);
+			assert(allocations == 0);
+		}
+	}
+};
+
+// Builds this frame's ImGui windows. Runs on the main thread, where GLFW
+// delivers the input ImGui reads.
+void buildUi(Profiler& profiler, MemoryPanel& memoryPanel) {
+	// Starting the new ImGui frame
+	ImGui_ImplGlfw_NewFrame();
+	ImGui::NewFrame();
+	// Putting the text-containing window in the top-left of the screen.
+	ImGui::SetNextWindowPos(ImVec2(5, 5));
+
+	// Setting flags
+	ImGuiWindowFlags textWindowFlags =
+		ImGuiWindowFlags_NoMove |				// text "window" should not move
+		ImGuiWindowFlags_NoResize |				// should not resize
+		ImGuiWindowFlags_NoCollapse |			// should not collapse
+		ImGuiWindowFlags_NoSavedSettings |		// don't want saved settings mucking things up
+		ImGuiWindowFlags_AlwaysAutoResize |		// window should auto-resize to fit the text
+		ImGuiWindowFlags_NoBackground |			// window should be transparent; only the text should be visible
+		ImGuiWindowFlags_NoDecoration |			// no decoration; only the text should be visible
+		ImGuiWindowFlags_NoTitleBar;			// no title; only the text should be visible
+
+	// Begin a new window with these flags. (bool *)0 is the "default" value for its argument.
+	ImGui::Begin("scoreText", (bool*)0, textWindowFlags);
+
+	// Scale up text a little, and set its value
+	ImGui::SetWindowFontScale(2.5f);
+
+	if (isAnimating) {
+		ImGui::Text("Animation is playing.");
+	}
+	else {
+		ImGui::Text("Animation is paused.");
+	}
+
+	ImGui::End();
+
+	if (showProfiler) {
+		profiler.drawOverlay();
+	}
+	if (showMemory) {
+		memoryPanel.draw(memoryReportPath);
+	}
+
+	ImGui::Render(); // Finish the ImGui frame; the renderer draws a copy of it
+}
+
+int main(int argc, char* argv[]) {
+	Log::debug("Starting main");
+
+	BenchmarkOptions benchmark = parseBenchmarkOptions(argc, argv);
+	FramePacingOptions pacing = parseFramePacingOptions(argc, argv);
+	GLStats::setLimits(GLStats::parseLimits(argc, argv));
+
+	// SCENE
+	argh::parser cmdl;
+	cmdl.add_params({ "--scene", "--memory-report" });
+	cmdl.parse(argc, argv);
+	string scenePath;
+	cmdl("--scene", "scenes/solar-system.scene") >> scenePath;
+	// --memory-report also writes the report on exit
+	const bool memoryReportOnExit = bool(cmdl("--memory-report"));
+	cmdl("--memory-report", memoryReportPath) >> memoryReportPath;
+	SceneDescription sceneDescription;
+	if (!loadSceneDescription(scenePath, sceneDescription)) {
+		throw std::runtime_error("Failed to load the scene!");
+	}
+	// the first body (the sun) is drawn with radius 0.5
+	modelScale = 0.5f / sceneDescription.bodies[0].radius;
+
+	// WINDOW
+	glfwInit();
+	if (benchmark.enabled) {
+		// nothing is presented, frames go to an offscreen target
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	}
+	Window window(benchmark.width, benchmark.height, "CPSC 453"); // can set callbacks at construction if desired
+
+
+	GLDebug::enable();
+
+	// Hidden shared context the renderer creates textures and programs on.
+	// Has to go before glfwTerminate, so it can release its context.
+	std::optional<ResourceLoader> loader;
+	loader.emplace(window.getGLFWwindow());
+
+	// CALLBACKS
+	//auto a4 = make_shared<Assignment4>(&earthOrbitalRotationIncrement, &moonOrbitalRotationIncrement);
+	auto a4 = make_shared<Assignment4>();
+	window.setCallbacks(a4);
+	a4->windowSizeCallback(window.getWidth(), window.getHeight());
+
+	lastUpdateTime = glfwGetTime();
+
+	Simulation simulation(sceneDescription);
+
+	// Every body that can be picked: the scene's bodies, moved each step,
+	// then its catalog bodies, placed once at the epoch
+	BodyStore sceneBodies;
+	for (const BodyDescription& body : sceneDescription.bodies) {
+		sceneBodies.add(vec3(0.0f), body.radius * modelScale);
+	}
+	simulation.place(sceneBodies);
+	{
+		auto start = std::chrono::steady_clock::now();
+		for (const string& path : sceneDescription.catalogs) {
+			BodyCatalog catalog;
+			if (catalog.open(path)) {
+				sceneBodies.append(catalog, 0.0, modelScale);
+			}
+		}
+		if (!sceneDescription.catalogs.empty()) {
+			double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			Log::info("SCENE loaded {} catalog bodies in {:.1f} ms", sceneBodies.size() - sceneDescription.bodies.size(), ms);
+		}
+	}
+
+	// Ray picking. The tree is built once; each step only refits the
+	// scene's bodies, the only ones that move.
+	BodyBvh bvh;
+	{
+		auto start = std::chrono::steady_clock::now();
+		bvh.build(sceneBodies);
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		Log::info("SCENE built picking tree over {} bodies in {:.1f} ms", bvh.size(), ms);
+	}
+	std::vector<size_t> movingBodies(sceneDescription.bodies.size());
+	for (size_t i = 0; i < movingBodies.size(); i++) {
+		movingBodies[i] = i;
+	}
+	size_t focusedBody = BodyBvh::none;
+	TripleBuffer<SceneSnapshot> snapshots;
+	uint64_t sequence = 0;
+
+	// Cheap enough to always run; P shows it, T dumps a trace
+	Profiler& profiler = Profiler::get();
+	MemoryPanel memoryPanel;
+
+	// Fills and publishes the next snapshot from the current main thread state
+	auto publish = [&]() {
+		SceneSnapshot& scene = snapshots.back();
+		scene.sequence = ++sequence;
+		simulation.fill(scene.bodies);
+		scene.cameraPos = a4->camera.getPos();
+		scene.view = a4->camera.getView();
+		scene.projection = a4->getProjection();
+		scene.width = a4->getWidth();
+		scene.height = a4->getHeight();
+		scene.occlusionCulling = occlusionCulling;
+		scene.starMagnitudeLimit = starMagnitudeLimit;
+		buildUi(profiler, memoryPanel);
+		scene.ui.capture(ImGui::GetDrawData());
+		snapshots.publish();
+	};
+
+	if (benchmark.enabled) {
+		// Lockstep on one thread: every step is drawn exactly once, so runs
+		// are comparable
+		{
+			SceneRenderer renderer(*loader, sceneDescription, sceneBodies, benchmark.width, benchmark.height);
+			renderer.finishStreaming();
+			Log::info("BENCHMARK {} frames after {} warmup at {}x{}, {:.4f} s per step",
+				benchmark.frames, benchmark.warmup, benchmark.width, benchmark.height, benchmark.timeStep);
+
+			FrameTimings frameTimings;
+			for (int frame = 0; frame < benchmark.warmup + benchmark.frames; frame++) {
+				if (frame == benchmark.warmup) {
+					GLStats::reset();
+				}
+				auto frameStart = std::chrono::steady_clock::now();
+				profiler.beginFrame();
+				glfwPollEvents();
+
+				BenchmarkCamera path = benchmarkCamera(std::max(0, frame - benchmark.warmup), benchmark.frames);
+				a4->camera.set(path.theta, path.phi, path.radius);
+				publish();
+				snapshots.acquire();
+				renderer.render(snapshots.front());
+				GLStats::endFrame();
+				if (isAnimating) {
+					simulation.advance(float(benchmark.timeStep));
+				}
+
+				// wait for the GPU, so the time covers the whole frame and not
+				// just command submission
+				glFinish();
+				std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - frameStart;
+				if (frame >= benchmark.warmup) {
+					frameTimings.add(elapsed.count());
+				}
+				profiler.endFrame();
+			}
+
+			frameTimings.printSummary("BENCHMARK");
+			profiler.printSummary();
+			GLStats::printSummary();
+			if (memoryReportOnExit) {
+				MemoryAccounting::writeJson(memoryReportPath);
+			}
+		}
+		GLDebug::printSummary();
+		loader.reset();
+		glfwTerminate();
+		// frames over a --gl-limits limit fail the run
+		return GLStats::getViolations() > 0 ? 1 : 0;
+	}
+
+	// RENDER THREAD
+	// Owns the context from here on: draws the newest snapshot and presents
+	// it. On demand, it only draws when a new snapshot arrived or its own
+	// streaming still changes the picture, and sleeps otherwise.
+	std::atomic<bool> rendererReady(false);
+	std::atomic<bool> stopRendering(false);
+	RedrawSignal redraw;
+	glfwMakeContextCurrent(nullptr);
+	std::thread renderThread([&]() {
+		window.makeContextCurrent();
+		applyVsync(pacing.vsync);
+		FrameLimiter limiter(pacing.maxFps);
+		{
+			SceneRenderer renderer(*loader, sceneDescription, sceneBodies);
+			rendererReady = true;
+
+			while (!stopRendering) {
+				bool fresh = snapshots.acquire();
+				SceneSnapshot& scene = snapshots.front();
+				if (scene.sequence == 0) {
+					std::this_thread::sleep_for(std::chrono::milliseconds(1));
+					continue;
+				}
+				if (pacing.onDemand && !fresh && !renderer.needsRedraw()) {
+					// wakes now and then to pick up edited shaders
+					if (!renderer.pollShaders()) {
+						redraw.waitFor(std::chrono::milliseconds(250));
+					}
+					continue;
+				}
+
+				limiter.wait();
+				profiler.beginFrame();
+				renderer.render(scene);
+				GLStats::endFrame();
+				{
+					ProfileScope scope("swap");
+					window.swapBuffers();
+				}
+				profiler.endFrame();
+
+				if (dumpTrace.exchange(false)) {
+					profiler.writeTrace("profile-trace.json");
+				}
+			}
+		}
+		glfwMakeContextCurrent(nullptr);
+	});
+	while (!rendererReady) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	// SIMULATION LOOP
+	// Input, simulation and UI at a fixed rate, waking early for input.
+	// While nothing changes it sleeps until the next event instead.
+	const double stepInterval = 1.0 / 120.0;
+	const double idleTimeout = 1.0;
+	// ImGui hides auto-resizing windows on their first frame, so a change is
+	// published for a couple more steps to let them appear
+	const int settleSteps = 2;
+	double nextStep = glfwGetTime();
+	bool idle = false;
+	int settling = 0;
+	while (!window.shouldClose()) {
+		glfwWaitEventsTimeout(idle ? idleTimeout : std::max(0.0, nextStep - glfwGetTime()));
+		if (idle) {
+			// whatever woke the loop is handled now, and time resumes from
+			// here instead of from when the loop went idle
+			nextStep = glfwGetTime();
+			lastUpdateTime = glfwGetTime();
+		}
+		else if (glfwGetTime() < nextStep) {
+			continue;
+		}
+		nextStep = std::max(nextStep + stepInterval, glfwGetTime());
+
+		// Input, animation or a resize since the last step
+		bool dirty = a4->takeDirty() || isAnimating || restartAnimation || !pacing.onDemand;
+
+		if (restartAnimation) {
+			simulation.resetOrientation();
+			restartAnimation = false;
+		}
 
 		if (isAnimating) {
-			ImGui::Text("Animation is playing.");
+			simulation.animate();
 		}
 		else {
-			ImGui::Text("Animation is paused.");
+			// resume where we paused instead of jumping ahead
+			lastUpdateTime = glfwGetTime();
+		}
+		simulation.place(sceneBodies);
+		bvh.refit(sceneBodies, movingBodies);
+
+		// A click focuses the camera on the body under the cursor, or on
+		// one within a few pixels of it
+		if (std::optional<dvec2> click = a4->takeClick()) {
+			vec3 origin, direction;
+			a4->cursorRay(*click, origin, direction);
+			float spread = 3.0f * radians(45.0f) / float(std::max(1, a4->getHeight()));
+			float distance;
+			size_t hit = bvh.intersect(sceneBodies, origin, direction, spread, distance);
+			if (hit != BodyBvh::none) {
+				focusedBody = hit;
+				a4->camera.setRadius(std::max(6.0f * sceneBodies.radius[hit], 0.1f));
+				const string& name = hit < sceneDescription.bodies.size() ? sceneDescription.bodies[hit].name : "catalog body";
+				Log::info("PICK {} ({}) at distance {:.3f}", name, hit, distance);
+			}
+		}
+		if (a4->recenter) {
+			focusedBody = BodyBvh::none;
+			a4->camera.setTarget(vec3(0.0f));
+			a4->camera.setRadius(3.0f);
+			a4->recenter = false;
+		}
+		if (focusedBody != BodyBvh::none) {
+			a4->camera.setTarget(sceneBodies.getPosition(focusedBody));
 		}
 
-		ImGui::End();
-		ImGui::Render(); // Render the ImGui window
-		ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+		if (dirty) {
+			settling = settleSteps;
+		}
+		else if (settling > 0) {
+			settling--;
+			dirty = true;
+		}
+		idle = !dirty;
+		if (dirty) {
+			publish();
+			redraw.notify();
+		}
+	}
 
-		window.swapBuffers();
+	// while the renderer still holds everything
+	if (memoryReportOnExit) {
+		MemoryAccounting::writeJson(memoryReportPath);
 	}
+	stopRendering = true;
+	redraw.notify();
+	renderThread.join();
+	GLStats::printSummary();
+	GLDebug::printSummary();
 
+	loader.reset();
 	glfwTerminate();
 	return 0;
 }
@@ -0,0 +1,8 @@
+#version 330 core
+
+// Only the depth test matters for occlusion queries; color writes are masked off.
+out vec4 color;
+
+void main() {
+	color = vec4(1.0);
+}
@@ -0,0 +1,10 @@
+#version 330 core
+layout (location = 0) in vec3 pos;
+
+uniform mat4 V;
+uniform mat4 P;
+uniform vec4 sphere; // xyz: center, w: radius
+
+void main() {
+	gl_Position = P * V * vec4(sphere.xyz + pos * sphere.w, 1.0);
+}
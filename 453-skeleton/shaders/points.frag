@@ -0,0 +1,8 @@
+#version 330 core
+
+// Catalog bodies are too small to shade, so they're drawn as flat grey dots.
+out vec4 color;
+
+void main() {
+	color = vec4(0.6, 0.6, 0.6, 1.0);
+}
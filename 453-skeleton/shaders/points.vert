@@ -0,0 +1,10 @@
+#version 330 core
+layout (location = 0) in vec3 pos;
+
+uniform mat4 V;
+uniform mat4 P;
+
+void main() {
+	gl_Position = P * V * vec4(pos, 1.0);
+	gl_PointSize = 2.0;
+}
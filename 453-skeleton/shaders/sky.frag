@@ -0,0 +1,11 @@
+#version 330 core
+
+in vec3 dir;
+
+uniform samplerCube sampler;
+
+out vec4 color;
+
+void main() {
+	color = texture(sampler, dir);
+}
@@ -0,0 +1,18 @@
+#version 330 core
+
+uniform mat4 V;
+uniform mat4 P;
+
+out vec3 dir;
+
+void main() {
+	// full-screen triangle: (-1,-1), (3,-1), (-1,3)
+	vec2 ndc = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2) * 2.0 - 1.0;
+
+	// unproject with the rotation-only view so the sky stays at infinity
+	vec4 world = inverse(P * mat4(mat3(V))) * vec4(ndc, 1.0, 1.0);
+	dir = world.xyz / world.w;
+
+	// z = w puts the triangle exactly on the far plane
+	gl_Position = vec4(ndc, 1.0, 1.0);
+}
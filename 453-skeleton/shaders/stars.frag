@@ -0,0 +1,13 @@
+#version 330 core
+
+in vec3 starColor;
+in float intensity;
+
+out vec4 color;
+
+void main() {
+	// round sprite with a soft edge
+	float r = length(gl_PointCoord * 2.0 - 1.0);
+	float alpha = intensity * (1.0 - smoothstep(0.5, 1.0, r));
+	color = vec4(starColor, alpha);
+}
@@ -0,0 +1,35 @@
+#version 330 core
+layout (location = 0) in vec3 direction;
+layout (location = 1) in float magnitude;
+layout (location = 2) in float colorIndex;
+
+uniform mat4 V;
+uniform mat4 P;
+uniform vec4 drawParameters; // x: magnitude limit
+
+out vec3 starColor;
+out float intensity;
+
+// Rough blackbody tint from the B-V color index
+vec3 tint(float bv) {
+	float t = clamp((bv + 0.4) / 2.4, 0.0, 1.0);
+	vec3 blue = vec3(0.6, 0.7, 1.0);
+	vec3 white = vec3(1.0, 0.97, 0.92);
+	vec3 red = vec3(1.0, 0.55, 0.3);
+	return t < 0.3 ? mix(blue, white, t / 0.3) : mix(white, red, (t - 0.3) / 0.7);
+}
+
+void main() {
+	// rotation-only view, so the stars stay at infinity
+	vec4 clip = P * mat4(mat3(V)) * vec4(direction, 1.0);
+
+	// z = w puts the star exactly on the far plane
+	gl_Position = clip.xyww;
+
+	// flux relative to a star at the limit: 1 at the limit, x100 five
+	// magnitudes brighter
+	float flux = pow(10.0, 0.4 * (drawParameters.x - magnitude));
+	gl_PointSize = clamp(sqrt(flux), 1.0, 12.0);
+	intensity = clamp(0.25 * sqrt(flux), 0.15, 1.0);
+	starColor = tint(colorIndex);
+}
@@ -1,5 +1,12 @@
 #version 330 core
 
+// Variants:
+//   UNLIT           - output the texture as is, no lighting
+//   EMISSIVE        - like UNLIT, scaled by emissiveStrength (light sources)
+//   VIRTUAL_TEXTURE - sampler is a virtual texture atlas, see VirtualTexture.h
+//   VT_FEEDBACK     - with VIRTUAL_TEXTURE, write the tile each pixel needs
+//                     instead of a color
+
 in vec3 fragPos;
 in vec2 tc;
 in vec3 n;
@@ -7,11 +14,77 @@ in vec3 n;
 uniform vec3 lightPos;
 uniform vec3 viewPos;
 uniform sampler2D sampler;
+uniform float emissiveStrength = 1.0;
+
+#if defined(VIRTUAL_TEXTURE)
+// Must match VirtualTextureFile
+const float VT_TILE_SIZE = 128.0;
+const float VT_TILE_BORDER = 4.0;
+
+uniform usampler2D indirection;
+uniform vec4 drawParameters; // width, height, levels, feedback id
+uniform float vtAtlasTiles;
+uniform float vtLodBias = 0.0;
+
+ivec2 vtLevelSize(int level) {
+	return max(ivec2(1), ivec2(drawParameters.xy) >> level);
+}
+
+// Tile holding uv at level, clamped like VirtualTexture::refresh
+ivec2 vtTile(vec2 uv, int level) {
+	ivec2 size = vtLevelSize(level);
+	return min(ivec2(uv * vec2(size) / VT_TILE_SIZE), (size - 1) / int(VT_TILE_SIZE));
+}
+
+int vtDesiredLevel(vec2 uv) {
+	vec2 texel = uv * drawParameters.xy;
+	vec2 dx = dFdx(texel);
+	vec2 dy = dFdy(texel);
+	float lod = 0.5 * log2(max(dot(dx, dx), dot(dy, dy))) + vtLodBias;
+	return int(clamp(floor(lod), 0.0, drawParameters.z - 1.0));
+}
+
+vec4 vtSample(vec2 uv) {
+	uv = clamp(uv, 0.0, 1.0);
+	int level = vtDesiredLevel(uv);
+	uvec4 entry = texelFetch(indirection, vtTile(uv, level), level);
+
+	// entry.b is the level actually resident, possibly a coarser ancestor
+	int resident = int(entry.b);
+	ivec2 tile = min(vtTile(uv, level) >> (resident - level), (vtLevelSize(resident) - 1) / int(VT_TILE_SIZE));
+	vec2 inTile = uv * vec2(vtLevelSize(resident)) - vec2(tile) * VT_TILE_SIZE;
+
+	float padded = VT_TILE_SIZE + 2.0 * VT_TILE_BORDER;
+	vec2 atlasTexel = vec2(entry.rg) * padded + VT_TILE_BORDER + inTile;
+	return textureLod(sampler, atlasTexel / (vtAtlasTiles * padded), 0.0);
+}
+#endif
 
+#if defined(VT_FEEDBACK)
+out uvec4 feedback;
+#else
 out vec4 color;
+#endif
 
 void main() {
+#if defined(VT_FEEDBACK)
+	vec2 uv = clamp(tc, 0.0, 1.0);
+	int level = vtDesiredLevel(uv);
+	feedback = uvec4(uvec2(vtTile(uv, level)), uint(level), uint(drawParameters.w));
+	return;
+#else
+
+#if defined(VIRTUAL_TEXTURE)
+	vec4 d = vtSample(tc);
+#else
 	vec4 d = texture(sampler, tc);
+#endif
+
+#if defined(EMISSIVE)
+	color = vec4(d.rgb * emissiveStrength, d.a);
+#elif defined(UNLIT)
+	color = d;
+#else
 	vec3 lightColor = vec3(1.0);
 	vec3 lightDir = normalize(fragPos - lightPos);
     vec3 normal = normalize(n);
@@ -29,4 +102,7 @@ void main() {
     vec3 ambient = ambientStrength * lightColor;
 
 	color = vec4((diffuse + specular + ambient), 1.0) * d;
+#endif
+
+#endif // VT_FEEDBACK
 }
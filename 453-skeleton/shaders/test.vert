@@ -17,6 +17,10 @@ out vec3 n;
 void main() {
 	fragPos = pos;
 	tc = texCoord;
+#if defined(UNLIT) || defined(EMISSIVE)
+	n = vec3(0.0); // unused without lighting
+#else
 	n = vec3(negRotationMatrix * vec4(normal, 1.0));
+#endif
 	gl_Position = P * V * M * transformationMatrix * rotationMatrix * vec4(pos, 1.0);
 }
@@ -0,0 +1,128 @@
+//------------------------------------------------------------------------------
+// body-catalog: writes a binary body catalog (.bcat) for scenes to refer to.
+//
+//	body-catalog --belt <count> [--seed <n>] <output>
+//	body-catalog --csv <input> <output>
+//
+//	--belt      generate an asteroid belt of count bodies between the orbits
+//	            the solar-system scene would give at 2.2 and 3.3 AU
+//	--seed      random seed for --belt, default 1
+//	--csv       import one body per line:
+//	            a (km), e (0 to below 1), i, node, periapsis, mean anomaly
+//	            (degrees), mean motion (degrees per day), radius (km)
+//
+// See BodyCatalog.h for the file layout.
+//------------------------------------------------------------------------------
+
+#include "BodyCatalog.h"
+#include "Log.h"
+
+#include <argh.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+
+namespace {
+	constexpr float PI = 3.14159265359f;
+	constexpr float degrees = PI / 180.0f;
+
+	// The solar-system scene's earth orbit (km) and orbital speed (radians
+	// per second); the belt follows Kepler's third law from there
+	constexpr float sceneAU = 1477200.0f;
+	constexpr float sceneEarthMeanMotion = 3.0f;
+
+	void addBody(BodyCatalogData& data, float a, float e, float inclination, float node, float periapsis,
+		float meanAnomaly, float meanMotion, float radius) {
+		data.semiMajorAxis.push_back(a);
+		data.eccentricity.push_back(e);
+		data.inclination.push_back(inclination);
+		data.ascendingNode.push_back(node);
+		data.argumentOfPeriapsis.push_back(periapsis);
+		data.meanAnomaly.push_back(meanAnomaly);
+		data.meanMotion.push_back(meanMotion);
+		data.radius.push_back(radius);
+		data.texture.push_back(BodyCatalog::noTexture);
+		data.parent.push_back(-1);
+	}
+
+	void generateBelt(BodyCatalogData& data, size_t count, unsigned seed) {
+		std::mt19937 random(seed);
+		std::uniform_real_distribution<float> distance(2.2f, 3.3f);
+		std::uniform_real_distribution<float> eccentricity(0.0f, 0.2f);
+		std::normal_distribution<float> inclination(0.0f, 7.0f * degrees);
+		std::uniform_real_distribution<float> angle(0.0f, 2.0f * PI);
+		std::uniform_real_distribution<float> radius(200.0f, 2000.0f);
+
+		for (size_t i = 0; i < count; i++) {
+			float au = distance(random);
+			addBody(data, au * sceneAU, eccentricity(random), inclination(random), angle(random), angle(random),
+				angle(random), sceneEarthMeanMotion * std::pow(au, -1.5f), radius(random));
+		}
+	}
+
+	bool importCsv(BodyCatalogData& data, const std::string& path) {
+		std::ifstream in(path);
+		if (!in) {
+			Log::error("BODY_CATALOG could not open {}", path);
+			return false;
+		}
+		std::string line;
+		for (int lineNumber = 1; std::getline(in, line); lineNumber++) {
+			if (line.empty() || line[0] == '#') {
+				continue;
+			}
+			float f[8];
+			if (std::sscanf(line.c_str(), "%f,%f,%f,%f,%f,%f,%f,%f", &f[0], &f[1], &f[2], &f[3], &f[4], &f[5], &f[6], &f[7]) != 8
+				|| !std::all_of(f, f + 8, [](float v) { return std::isfinite(v); })) {
+				Log::error("BODY_CATALOG {}:{} is not a body", path, lineNumber);
+				return false;
+			}
+			// hyperbolic and parabolic orbits have no Kepler solution here
+			if (!(f[1] >= 0.0f && f[1] < 1.0f)) {
+				Log::error("BODY_CATALOG {}:{} eccentricity {} is not in [0, 1)", path, lineNumber, f[1]);
+				return false;
+			}
+			addBody(data, f[0], f[1], f[2] * degrees, f[3] * degrees, f[4] * degrees, f[5] * degrees,
+				f[6] * degrees / 86400.0f, f[7]);
+		}
+		return true;
+	}
+}
+
+
+int main(int argc, char* argv[]) {
+	argh::parser cmdl;
+	cmdl.add_params({ "--belt", "--seed", "--csv" });
+	cmdl.parse(argc, argv);
+
+	std::string output, csv;
+	size_t count = 0;
+	unsigned seed = 1;
+	bool belt = bool(cmdl("--belt") >> count);
+	bool imported = bool(cmdl("--csv") >> csv);
+	cmdl("--seed", seed) >> seed;
+	if (!(cmdl(1) >> output) || belt == imported) {
+		Log::error("usage: body-catalog --belt <count> [--seed <n>] <output>");
+		Log::error("       body-catalog --csv <input> <output>");
+		return 1;
+	}
+
+	BodyCatalogData data;
+	if (belt) {
+		generateBelt(data, count, seed);
+	}
+	else if (!importCsv(data, csv)) {
+		return 1;
+	}
+
+	if (!writeBodyCatalog(output, data)) {
+		return 1;
+	}
+	Log::info("BODY_CATALOG {} bodies -> {}", data.size(), output);
+	return 0;
+}
@@ -0,0 +1,138 @@
+//------------------------------------------------------------------------------
+// star-catalog: converts a CSV star catalog into a binary star catalog
+// (.scat) for the star field.
+//
+//	star-catalog [--limit <magnitude>] <input.csv> <output>
+//
+//	--limit     drop stars fainter than this apparent magnitude
+//
+// The header row picks the columns. HYG style catalogs give ra (hours), dec
+// (degrees), mag and ci (B-V); Gaia exports give ra and dec (degrees),
+// phot_g_mean_mag and bp_rp. See StarCatalog.h for the file layout.
+//------------------------------------------------------------------------------
+
+#include "Log.h"
+#include "StarCatalog.h"
+
+#include <argh.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace {
+	constexpr float PI = 3.14159265359f;
+	constexpr float degrees = PI / 180.0f;
+
+	// Splits a CSV line, dropping the quotes around fields. Catalog fields
+	// never contain commas.
+	void splitFields(const std::string& line, std::vector<std::string>& fields) {
+		fields.clear();
+		size_t start = 0;
+		while (true) {
+			size_t end = line.find(',', start);
+			std::string field = line.substr(start, end == std::string::npos ? std::string::npos : end - start);
+			if (!field.empty() && field.back() == '\r') {
+				field.pop_back();
+			}
+			if (field.size() >= 2 && field.front() == '"' && field.back() == '"') {
+				field = field.substr(1, field.size() - 2);
+			}
+			fields.push_back(std::move(field));
+			if (end == std::string::npos) {
+				return;
+			}
+			start = end + 1;
+		}
+	}
+
+	int findColumn(const std::vector<std::string>& header, const char* name) {
+		for (size_t i = 0; i < header.size(); i++) {
+			if (header[i] == name) {
+				return int(i);
+			}
+		}
+		return -1;
+	}
+
+	bool parseFloat(const std::string& text, float& value) {
+		char* end = nullptr;
+		value = std::strtof(text.c_str(), &end);
+		return !text.empty() && end == text.c_str() + text.size();
+	}
+}
+
+
+int main(int argc, char* argv[]) {
+	argh::parser cmdl;
+	cmdl.add_params({ "--limit" });
+	cmdl.parse(argc, argv);
+
+	std::string input, output;
+	float limit = 100.0f;
+	cmdl("--limit", limit) >> limit;
+	if (!(cmdl(1) >> input) || !(cmdl(2) >> output)) {
+		Log::error("usage: star-catalog [--limit <magnitude>] <input.csv> <output>");
+		return 1;
+	}
+
+	std::ifstream in(input);
+	std::string line;
+	std::vector<std::string> fields;
+	if (!in || !std::getline(in, line)) {
+		Log::error("STAR_CATALOG could not read {}", input);
+		return 1;
+	}
+	splitFields(line, fields);
+
+	int ra = findColumn(fields, "ra");
+	int dec = findColumn(fields, "dec");
+	int magnitude = findColumn(fields, "mag");
+	int color = findColumn(fields, "ci");
+	float raUnit = 15.0f * degrees; // HYG gives hours
+	if (magnitude < 0) {
+		magnitude = findColumn(fields, "phot_g_mean_mag");
+		color = findColumn(fields, "bp_rp");
+		raUnit = degrees;
+	}
+	if (ra < 0 || dec < 0 || magnitude < 0) {
+		Log::error("STAR_CATALOG {} has no ra, dec and magnitude columns", input);
+		return 1;
+	}
+
+	std::vector<Star> stars;
+	size_t skipped = 0;
+	while (std::getline(in, line)) {
+		splitFields(line, fields);
+		Star star;
+		float r, d;
+		if (int(fields.size()) <= std::max({ ra, dec, magnitude })
+			|| !parseFloat(fields[ra], r) || !parseFloat(fields[dec], d) || !parseFloat(fields[magnitude], star.magnitude)) {
+			skipped++;
+			continue;
+		}
+		// HYG lists the sun too
+		if (star.magnitude < -5.0f || star.magnitude > limit) {
+			continue;
+		}
+		if (color < 0 || size_t(color) >= fields.size() || !parseFloat(fields[color], star.color)) {
+			star.color = 0.6f; // sun-like when unknown
+		}
+		star.direction = equatorialToScene(r * raUnit, d * degrees);
+		stars.push_back(star);
+	}
+	if (skipped > 0) {
+		Log::warning("STAR_CATALOG skipped {} rows without a position or magnitude", skipped);
+	}
+
+	if (!writeStarCatalog(output, std::move(stars))) {
+		return 1;
+	}
+	StarCatalog catalog;
+	catalog.open(output);
+	Log::info("STAR_CATALOG {} -> {} ({} stars, {} to magnitude 6.5)", input, output,
+		catalog.size(), catalog.countBrighterThan(6.5f));
+	return 0;
+}
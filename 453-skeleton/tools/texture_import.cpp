@@ -0,0 +1,75 @@
+//------------------------------------------------------------------------------
+// texture-import: converts a source image into a texture container (.txc),
+// or with --virtual into a virtual texture tile pyramid (.vtx).
+//
+//	texture-import [--bc1 | --bc7] [--linear] [--no-mips] <input> <output>
+//	texture-import --virtual <input> <output>
+//
+//	--bc1       block compress to BC1 (4 bpp, opaque color maps)
+//	--bc7       block compress to BC7 (8 bpp, higher quality, alpha)
+//	--linear    store data as linear (normal maps, masks); default is sRGB
+//	--no-mips   only store the full resolution level
+//	--virtual   write a tile pyramid, see VirtualTextureFile.h
+//
+// The build runs this over textures/ once, so the application never decodes
+// a JPEG at startup. See TextureContainer.h for the file layout.
+//------------------------------------------------------------------------------
+
+#include "Image.h"
+#include "Log.h"
+#include "TextureContainer.h"
+#include "VirtualTextureFile.h"
+
+#include <argh.h>
+
+#include <string>
+
+
+int main(int argc, char* argv[]) {
+	argh::parser cmdl(argc, argv);
+
+	std::string input, output;
+	if (!(cmdl(1) >> input) || !(cmdl(2) >> output) || (cmdl["--bc1"] && cmdl["--bc7"])) {
+		Log::error("usage: texture-import [--bc1 | --bc7] [--linear] [--no-mips] <input> <output>");
+		Log::error("       texture-import --virtual <input> <output>");
+		return 1;
+	}
+
+	// The whole source is decoded in memory, so survey sized maps need a
+	// machine with RAM to match; only the runtime is bounded by the atlas
+	if (cmdl["--virtual"]) {
+		Image image;
+		if (!loadImage(input, image, true)) {
+			return 1;
+		}
+		generateMipChain(image);
+		if (!writeVirtualTexture(output, image)) {
+			return 1;
+		}
+		std::vector<VirtualTextureLevel> levels = virtualTextureLevels(image.getWidth(), image.getHeight());
+		Log::info("TEXTURE_IMPORT {} -> {} ({}x{}, {} levels, {} tiles)", input, output,
+			image.getWidth(), image.getHeight(), levels.size(), levels.back().firstTile + 1);
+		return 0;
+	}
+
+	Image image;
+	if (!loadImage(input, image, !cmdl["--linear"])) {
+		return 1;
+	}
+	if (!cmdl["--no-mips"]) {
+		generateMipChain(image);
+	}
+	if (image.format == PixelFormat::RGBA8 && cmdl["--bc1"]) {
+		image = compressImage(image, PixelFormat::BC1);
+	}
+	else if (image.format == PixelFormat::RGBA8 && cmdl["--bc7"]) {
+		image = compressImage(image, PixelFormat::BC7);
+	}
+
+	if (!writeTextureContainer(output, image)) {
+		return 1;
+	}
+	Log::info("TEXTURE_IMPORT {} -> {} ({}x{}, {} levels, {} bytes)", input, output,
+		image.getWidth(), image.getHeight(), image.levels.size(), image.getSizeInBytes());
+	return 0;
+}